@@ -27,9 +27,12 @@ public:
   //! \param first_pass If this is the first iteration or not
   //! \param k_eff The latest estimate of k-eff
   //! \param k_eff_prev The previous estimate of k-eff
+  //! \param dk_dppm Sensitivity of k-eff to the boron concentration estimated in the
+  //! latest solve, or 0 if there is none.  If negative, it is used instead of the
+  //! finite difference between successive iterations.
   //! \return Boron concentration in [ppm]
   double solve_ppm(bool first_pass, UncertainDouble k_eff,
-                   UncertainDouble k_eff_prev);
+                   UncertainDouble k_eff_prev, double dk_dppm = 0.);
 
   //! Check convergence of the boron concentration
   //! for the current Picard iteration.
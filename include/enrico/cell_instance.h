@@ -22,6 +22,12 @@ public:
   //! \param position The coordinate for the desired cell
   explicit CellInstance(Position position);
 
+  //! Given a cell index and instance, find the material of the cell instance
+  //!
+  //! \param index Index in global cells array
+  //! \param instance Index of cell instance
+  CellInstance(int32_t index, int32_t instance);
+
   //! Get the corresponding cell
   openmc::Cell* cell() const;
 
@@ -73,6 +79,10 @@ public:
   int32_t instance_;       //!< Index of cell instance
   int32_t material_index_; //!< Index of material in this instance
   double volume_{0.0};     //!< volume of cell instance in [cm^3]
+
+private:
+  //! Determine the material and volume from index_ and instance_
+  void init_material();
 };
 
 } // namespace enrico
@@ -3,17 +3,111 @@
 #ifndef ENRICO_COMM_H
 #define ENRICO_COMM_H
 
+#include "enrico/comm_stats.h"
 #include "enrico/mpi_types.h"
 #include "xtensor/xtensor.hpp"
 
 #include <mpi.h>
 
+#include <chrono>
 #include <iostream>
 #include <string>
+#include <thread>  // for sleep_for
+#include <utility> // for move
 #include <vector>
 
 namespace enrico {
 
+//! Handle to one or more pending nonblocking operations started by Comm.
+//!
+//! The operations must be completed with wait() before the buffers involved are
+//! reused.  If the handle is destroyed while operations are pending, it waits for them.
+class CommRequest {
+public:
+  CommRequest() = default;
+  CommRequest(const CommRequest&) = delete;
+  CommRequest& operator=(const CommRequest&) = delete;
+  CommRequest(CommRequest&&) = default;
+  CommRequest& operator=(CommRequest&& other)
+  {
+    wait();
+    requests_ = std::move(other.requests_);
+    buffers_ = std::move(other.buffers_);
+    return *this;
+  }
+
+  ~CommRequest() { wait(); }
+
+  //! Block until all pending operations have completed
+  //!
+  //! Currently, a wrapper for MPI_Waitall.
+  //!
+  //! \return Error value
+  int wait()
+  {
+    int ierr = MPI_SUCCESS;
+    if (!requests_.empty()) {
+      CommStats::Call call(0, 0);
+      ierr = MPI_Waitall(requests_.size(), requests_.data(), MPI_STATUSES_IGNORE);
+    }
+    requests_.clear();
+    buffers_.clear();
+    return ierr;
+  }
+
+  //! Check whether all pending operations have completed, without blocking
+  //!
+  //! Currently, a wrapper for MPI_Testall.
+  //!
+  //! \return True if there are no more pending operations
+  bool test()
+  {
+    if (!requests_.empty()) {
+      int flag;
+      MPI_Testall(requests_.size(), requests_.data(), &flag, MPI_STATUSES_IGNORE);
+      if (flag) {
+        requests_.clear();
+        buffers_.clear();
+      }
+    }
+    return requests_.empty();
+  }
+
+  //! Block until all pending operations have completed, sleeping between checks
+  //!
+  //! Unlike wait(), which may spin in the MPI library, this leaves the core to other
+  //! threads on the node while the operations are pending.
+  //!
+  //! \param interval Time slept between checks
+  void wait_idle(std::chrono::microseconds interval = std::chrono::microseconds(100))
+  {
+    CommStats::Call call(0, 0);
+    while (!test()) {
+      std::this_thread::sleep_for(interval);
+    }
+  }
+
+  //! Queries whether there are any pending operations
+  //! \return True if no operations are pending
+  bool done() const { return requests_.empty(); }
+
+  //! Take over the pending operations of another handle
+  //! \param other Handle whose operations are added to this one
+  void merge(CommRequest&& other)
+  {
+    requests_.insert(requests_.end(), other.requests_.begin(), other.requests_.end());
+    for (auto& b : other.buffers_) {
+      buffers_.push_back(std::move(b));
+    }
+    other.requests_.clear();
+    other.buffers_.clear();
+  }
+
+  std::vector<MPI_Request> requests_; //!< Pending MPI requests
+  //! Auxiliary arrays (e.g., counts and displacements) that must outlive the requests
+  std::vector<std::vector<int>> buffers_;
+};
+
 //! Info and function wrappers for a specified MPI communicator.
 class Comm {
 public:
@@ -151,6 +245,334 @@ public:
       sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
   }
 
+  //! Gathers varying amounts of data from the processes in this comm onto a given root.
+  //!
+  //! Currently, a wrapper for MPI_Gatherv.
+  //!
+  //! \param[in] sendbuf Starting address of send buffer
+  //! \param[in] sendcount Number of elements in send buffer
+  //! \param[in] sendtype Data type of send buffer elements
+  //! \param[out] recvbuf Address of receive buffer
+  //! \param[in] recvcounts Number of elements received from each process
+  //! \param[in] displs Displacement in recvbuf at which to place data from each process
+  //! \param[in] recvtype Data type of recv buffer elements
+  //! \param[in] root Rank of receiving process
+  //! \return Error value
+  int Gatherv(const void* sendbuf,
+              int sendcount,
+              MPI_Datatype sendtype,
+              void* recvbuf,
+              const int* recvcounts,
+              const int* displs,
+              MPI_Datatype recvtype,
+              int root = 0) const
+  {
+    return MPI_Gatherv(
+      sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm);
+  }
+
+  //! Scatters varying amounts of data from a given root to the processes in this comm.
+  //!
+  //! Currently, a wrapper for MPI_Scatterv.
+  //!
+  //! \param[in] sendbuf Address of send buffer
+  //! \param[in] sendcounts Number of elements to send to each process
+  //! \param[in] displs Displacement in sendbuf from which to take data for each process
+  //! \param[in] sendtype Data type of send buffer elements
+  //! \param[out] recvbuf Starting address of receive buffer
+  //! \param[in] recvcount Number of elements in receive buffer
+  //! \param[in] recvtype Data type of recv buffer elements
+  //! \param[in] root Rank of sending process
+  //! \return Error value
+  int Scatterv(const void* sendbuf,
+               const int* sendcounts,
+               const int* displs,
+               MPI_Datatype sendtype,
+               void* recvbuf,
+               int recvcount,
+               MPI_Datatype recvtype,
+               int root = 0) const
+  {
+    return MPI_Scatterv(
+      sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount, recvtype, root, comm);
+  }
+
+  //! Gathers the number of values held by each rank onto a given root
+  //! \param count Number of values held by the calling rank
+  //! \param root Rank of receiving process
+  //! \return Number of values held by each rank (significant at root)
+  std::vector<int> gather_counts(int count, int root = 0) const
+  {
+    std::vector<int> counts;
+    if (this->active()) {
+      if (rank == root) {
+        counts.resize(size);
+      }
+      CommStats::Call call(sizeof(int) * (rank == root ? size + 1 : 1));
+      Gather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, root);
+    }
+    return counts;
+  }
+
+  //! Gather vectors of varying length from all ranks onto a given root, where they
+  //! are concatenated in rank order
+  //! \param sendbuf Values to send from the calling rank
+  //! \param recvbuf Concatenated values from all ranks, resized as needed (significant
+  //! at root)
+  //! \param counts Number of values sent by each rank (significant at root)
+  //! \param root Rank of receiving process
+  template<typename T>
+  void gatherv(const std::vector<T>& sendbuf,
+               std::vector<T>& recvbuf,
+               const std::vector<int>& counts,
+               int root = 0) const;
+
+  //! Gather 1D xtensors of varying length from all ranks onto a given root, where they
+  //! are concatenated in rank order
+  //! \param sendbuf Values to send from the calling rank
+  //! \param recvbuf Concatenated values from all ranks, resized as needed (significant
+  //! at root)
+  //! \param counts Number of values sent by each rank (significant at root)
+  //! \param root Rank of receiving process
+  template<typename T>
+  void gatherv(const xt::xtensor<T, 1>& sendbuf,
+               xt::xtensor<T, 1>& recvbuf,
+               const std::vector<int>& counts,
+               int root = 0) const;
+
+  //! Scatter consecutive pieces of a vector on a given root to all ranks
+  //! \param sendbuf Concatenated values for all ranks (significant at root)
+  //! \param recvbuf Values for the calling rank. Must already be sized to the number of
+  //! values the calling rank receives.
+  //! \param counts Number of values sent to each rank (significant at root)
+  //! \param root Rank of sending process
+  template<typename T>
+  void scatterv(const std::vector<T>& sendbuf,
+                std::vector<T>& recvbuf,
+                const std::vector<int>& counts,
+                int root = 0) const;
+
+  //! Scatter consecutive pieces of a 1D xtensor on a given root to all ranks
+  //! \param sendbuf Concatenated values for all ranks (significant at root)
+  //! \param recvbuf Values for the calling rank. Must already be sized to the number of
+  //! values the calling rank receives.
+  //! \param counts Number of values sent to each rank (significant at root)
+  //! \param root Rank of sending process
+  template<typename T>
+  void scatterv(const xt::xtensor<T, 1>& sendbuf,
+                xt::xtensor<T, 1>& recvbuf,
+                const std::vector<int>& counts,
+                int root = 0) const;
+
+  //! Starts a nonblocking send.
+  //!
+  //! Currently, a wrapper for MPI_Isend.
+  //!
+  //! \param[in] buf Initial address of send buffer
+  //! \param[in] count Number of elements in send buffer
+  //! \param[in] datatype Data type of each send buffer element
+  //! \param[in] dest Rank of destination
+  //! \param[in] tag Message tag
+  //! \param[out] request Communication request
+  //! \return Error value
+  int Isend(const void* buf,
+            int count,
+            MPI_Datatype datatype,
+            int dest,
+            int tag,
+            MPI_Request* request) const
+  {
+    return MPI_Isend(buf, count, datatype, dest, tag, comm, request);
+  }
+
+  //! Starts a nonblocking receive.
+  //!
+  //! Currently, a wrapper for MPI_Irecv.
+  //!
+  //! \param[out] buf Initial address of receive buffer
+  //! \param[in] count Number of elements in receive buffer
+  //! \param[in] datatype Data type of each receive buffer element
+  //! \param[in] source Rank of source
+  //! \param[in] tag Message tag
+  //! \param[out] request Communication request
+  //! \return Error value
+  int Irecv(void* buf,
+            int count,
+            MPI_Datatype datatype,
+            int source,
+            int tag,
+            MPI_Request* request) const
+  {
+    return MPI_Irecv(buf, count, datatype, source, tag, comm, request);
+  }
+
+  //! Starts a nonblocking broadcast.
+  //!
+  //! Currently, a wrapper for MPI_Ibcast.
+  //!
+  //! \param[in,out] buffer Starting address of buffer
+  //! \param[in] count Number of entries in buffer
+  //! \param[in] datatype Data type of buffer
+  //! \param[in] root Rank of broadcast root
+  //! \param[out] request Communication request
+  //! \return Error value
+  int Ibcast(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Request* request)
+    const
+  {
+    return MPI_Ibcast(buffer, count, datatype, root, comm, request);
+  }
+
+  //! Starts a nonblocking gather of varying amounts of data.
+  //!
+  //! Currently, a wrapper for MPI_Igatherv.  Arguments are as for Gatherv, plus:
+  //!
+  //! \param[out] request Communication request
+  //! \return Error value
+  int Igatherv(const void* sendbuf,
+               int sendcount,
+               MPI_Datatype sendtype,
+               void* recvbuf,
+               const int* recvcounts,
+               const int* displs,
+               MPI_Datatype recvtype,
+               int root,
+               MPI_Request* request) const
+  {
+    return MPI_Igatherv(sendbuf,
+                        sendcount,
+                        sendtype,
+                        recvbuf,
+                        recvcounts,
+                        displs,
+                        recvtype,
+                        root,
+                        comm,
+                        request);
+  }
+
+  //! Starts a nonblocking scatter of varying amounts of data.
+  //!
+  //! Currently, a wrapper for MPI_Iscatterv.  Arguments are as for Scatterv, plus:
+  //!
+  //! \param[out] request Communication request
+  //! \return Error value
+  int Iscatterv(const void* sendbuf,
+                const int* sendcounts,
+                const int* displs,
+                MPI_Datatype sendtype,
+                void* recvbuf,
+                int recvcount,
+                MPI_Datatype recvtype,
+                int root,
+                MPI_Request* request) const
+  {
+    return MPI_Iscatterv(sendbuf,
+                         sendcounts,
+                         displs,
+                         sendtype,
+                         recvbuf,
+                         recvcount,
+                         recvtype,
+                         root,
+                         comm,
+                         request);
+  }
+
+  //! Start a barrier without blocking
+  //! \return Handle to the pending barrier
+  CommRequest ibarrier() const
+  {
+    CommRequest request;
+    if (this->active()) {
+      request.requests_.resize(1);
+      MPI_Ibarrier(comm, request.requests_.data());
+    }
+    return request;
+  }
+
+  //! Start sending a vector to another rank without blocking.  The vector must not be
+  //! modified until the request has completed.
+  //! \param values Values to send
+  //! \param dest Destination rank
+  //! \param tag Message tag
+  //! \return Handle to the pending send
+  template<typename T>
+  CommRequest isend(const std::vector<T>& values, int dest, int tag = 0) const;
+
+  //! Start sending an xtensor to another rank without blocking.  The xtensor must not
+  //! be modified until the request has completed.
+  //! \param values Values to send
+  //! \param dest Destination rank
+  //! \param tag Message tag
+  //! \return Handle to the pending send
+  template<typename T, size_t N>
+  CommRequest isend(const xt::xtensor<T, N>& values, int dest, int tag = 0) const;
+
+  //! Start receiving a vector from another rank without blocking.  Unlike
+  //! send_and_recv, there is no size handshake: the vector must already be sized to
+  //! the number of values sent.
+  //! \param values Buffer for received values
+  //! \param source Source rank
+  //! \param tag Message tag
+  //! \return Handle to the pending receive
+  template<typename T>
+  CommRequest irecv(std::vector<T>& values, int source, int tag = 0) const;
+
+  //! Start receiving an xtensor from another rank without blocking.  The xtensor must
+  //! already have the shape of the xtensor that is sent.
+  //! \param values Buffer for received values
+  //! \param source Source rank
+  //! \param tag Message tag
+  //! \return Handle to the pending receive
+  template<typename T, size_t N>
+  CommRequest irecv(xt::xtensor<T, N>& values, int source, int tag = 0) const;
+
+  //! Start broadcasting a vector without blocking.  The vector must already have the
+  //! same size on all ranks.
+  //! \param values Values to broadcast (significant at root)
+  //! \param root Rank of broadcast root
+  //! \return Handle to the pending broadcast
+  template<typename T>
+  CommRequest ibroadcast(std::vector<T>& values, int root = 0) const;
+
+  //! Start broadcasting an xtensor without blocking.  The xtensor must already have the
+  //! same shape on all ranks.
+  //! \param values Values to broadcast (significant at root)
+  //! \param root Rank of broadcast root
+  //! \return Handle to the pending broadcast
+  template<typename T, size_t N>
+  CommRequest ibroadcast(xt::xtensor<T, N>& values, int root = 0) const;
+
+  //! Start a gatherv (see gatherv) without blocking.  recvbuf is resized on the root
+  //! before the operation starts.
+  template<typename T>
+  CommRequest igatherv(const std::vector<T>& sendbuf,
+                       std::vector<T>& recvbuf,
+                       const std::vector<int>& counts,
+                       int root = 0) const;
+
+  //! Start a gatherv (see gatherv) without blocking.  recvbuf is resized on the root
+  //! before the operation starts.
+  template<typename T>
+  CommRequest igatherv(const xt::xtensor<T, 1>& sendbuf,
+                       xt::xtensor<T, 1>& recvbuf,
+                       const std::vector<int>& counts,
+                       int root = 0) const;
+
+  //! Start a scatterv (see scatterv) without blocking.
+  template<typename T>
+  CommRequest iscatterv(const std::vector<T>& sendbuf,
+                        std::vector<T>& recvbuf,
+                        const std::vector<int>& counts,
+                        int root = 0) const;
+
+  //! Start a scatterv (see scatterv) without blocking.
+  template<typename T>
+  CommRequest iscatterv(const xt::xtensor<T, 1>& sendbuf,
+                        xt::xtensor<T, 1>& recvbuf,
+                        const std::vector<int>& counts,
+                        int root = 0) const;
+
   //! Gathers data from all tasks and distribute the combined data to all tasks.
   //!
   //! Currently, a wrapper for MPI_Allgather
@@ -196,8 +618,10 @@ Comm::send_and_recv(T& value, int dest, int source) const
   if (this->active() && dest != source) {
     int tag = source;
     if (rank == source) {
+      CommStats::Call call(sizeof(T));
       MPI_Send(&value, 1, get_mpi_type<T>(), dest, tag, comm);
     } else if (rank == dest) {
+      CommStats::Call call(sizeof(T));
       MPI_Recv(&value, 1, get_mpi_type<T>(), source, tag, comm, MPI_STATUS_IGNORE);
     }
   }
@@ -218,8 +642,10 @@ void Comm::send_and_recv(std::vector<T>& values, int dest, int source) const
     // Send the vector
     int tag = source;
     if (rank == source) {
+      CommStats::Call call(n * sizeof(T));
       MPI_Send(values.data(), n, get_mpi_type<T>(), dest, tag, comm);
     } else if (rank == dest) {
+      CommStats::Call call(n * sizeof(T));
       MPI_Recv(values.data(), n, get_mpi_type<T>(), source, tag, comm, MPI_STATUS_IGNORE);
     }
   }
@@ -241,8 +667,10 @@ void Comm::send_and_recv(xt::xtensor<T, N>& values, int dest, int source) const
     // Finally, send data
     int tag = source;
     if (rank == source) {
+      CommStats::Call call(values.size() * sizeof(T));
       MPI_Send(values.data(), values.size(), get_mpi_type<T>(), dest, tag, comm);
     } else if (rank == dest) {
+      CommStats::Call call(values.size() * sizeof(T));
       MPI_Recv(values.data(),
                values.size(),
                get_mpi_type<T>(),
@@ -262,8 +690,10 @@ Comm::send_and_recv(T& recvbuf, int dest, T& sendbuf, int source) const
     if (dest != source) {
       int tag = source;
       if (rank == source) {
+        CommStats::Call call(sizeof(T));
         MPI_Send(&sendbuf, 1, get_mpi_type<T>(), dest, tag, comm);
       } else if (rank == dest) {
+        CommStats::Call call(sizeof(T));
         MPI_Recv(&recvbuf, 1, get_mpi_type<T>(), source, tag, comm, MPI_STATUS_IGNORE);
       }
     } else { // dest == source
@@ -291,8 +721,10 @@ void Comm::send_and_recv(std::vector<T>& recvbuf,
       // Send the vector
       int tag = source;
       if (rank == source) {
+        CommStats::Call call(n * sizeof(T));
         MPI_Send(sendbuf.data(), n, get_mpi_type<T>(), dest, tag, comm);
       } else if (rank == dest) {
+        CommStats::Call call(n * sizeof(T));
         MPI_Recv(
           recvbuf.data(), n, get_mpi_type<T>(), source, tag, comm, MPI_STATUS_IGNORE);
       }
@@ -324,8 +756,10 @@ void Comm::send_and_recv(xt::xtensor<T, N>& recvbuf,
       // Finally, send data
       int tag = source;
       if (rank == source) {
+        CommStats::Call call(sendbuf.size() * sizeof(T));
         MPI_Send(sendbuf.data(), sendbuf.size(), get_mpi_type<T>(), dest, tag, comm);
       } else if (rank == dest) {
+        CommStats::Call call(recvbuf.size() * sizeof(T));
         MPI_Recv(recvbuf.data(),
                  recvbuf.size(),
                  get_mpi_type<T>(),
@@ -341,11 +775,332 @@ void Comm::send_and_recv(xt::xtensor<T, N>& recvbuf,
   }
 }
 
+//! Compute the displacements (exclusive prefix sum) corresponding to a set of counts
+//! \param counts Number of values for each rank
+//! \return Offset of the first value for each rank
+inline std::vector<int> displacements(const std::vector<int>& counts)
+{
+  std::vector<int> displs(counts.size(), 0);
+  for (std::size_t i = 1; i < counts.size(); ++i) {
+    displs[i] = displs[i - 1] + counts[i - 1];
+  }
+  return displs;
+}
+
+//! Compute the counts for splitting a number of values as evenly as possible into
+//! consecutive pieces, one per rank
+//! \param n Total number of values
+//! \param n_parts Number of ranks
+//! \return Number of values for each rank
+inline std::vector<int> partition_counts(std::size_t n, int n_parts)
+{
+  std::vector<int> counts(n_parts, n / n_parts);
+  for (std::size_t i = 0; i < n % n_parts; ++i) {
+    ++counts[i];
+  }
+  return counts;
+}
+
+template<typename T>
+void Comm::gatherv(const std::vector<T>& sendbuf,
+                   std::vector<T>& recvbuf,
+                   const std::vector<int>& counts,
+                   int root) const
+{
+  if (this->active()) {
+    std::vector<int> displs;
+    if (rank == root) {
+      displs = displacements(counts);
+      recvbuf.resize(displs.empty() ? 0 : displs.back() + counts.back());
+    }
+    std::size_t n_values = sendbuf.size() + (rank == root ? recvbuf.size() : 0);
+    CommStats::Call call(n_values * sizeof(T));
+    Gatherv(sendbuf.data(),
+            sendbuf.size(),
+            get_mpi_type<T>(),
+            recvbuf.data(),
+            counts.data(),
+            displs.data(),
+            get_mpi_type<T>(),
+            root);
+  }
+}
+
+template<typename T>
+void Comm::gatherv(const xt::xtensor<T, 1>& sendbuf,
+                   xt::xtensor<T, 1>& recvbuf,
+                   const std::vector<int>& counts,
+                   int root) const
+{
+  if (this->active()) {
+    std::vector<int> displs;
+    if (rank == root) {
+      displs = displacements(counts);
+      std::size_t n = displs.empty() ? 0 : displs.back() + counts.back();
+      recvbuf.resize({n});
+    }
+    std::size_t n_values = sendbuf.size() + (rank == root ? recvbuf.size() : 0);
+    CommStats::Call call(n_values * sizeof(T));
+    Gatherv(sendbuf.data(),
+            sendbuf.size(),
+            get_mpi_type<T>(),
+            recvbuf.data(),
+            counts.data(),
+            displs.data(),
+            get_mpi_type<T>(),
+            root);
+  }
+}
+
+template<typename T>
+void Comm::scatterv(const std::vector<T>& sendbuf,
+                    std::vector<T>& recvbuf,
+                    const std::vector<int>& counts,
+                    int root) const
+{
+  if (this->active()) {
+    std::vector<int> displs;
+    if (rank == root) {
+      displs = displacements(counts);
+    }
+    std::size_t n_values = recvbuf.size() + (rank == root ? sendbuf.size() : 0);
+    CommStats::Call call(n_values * sizeof(T));
+    Scatterv(sendbuf.data(),
+             counts.data(),
+             displs.data(),
+             get_mpi_type<T>(),
+             recvbuf.data(),
+             recvbuf.size(),
+             get_mpi_type<T>(),
+             root);
+  }
+}
+
+template<typename T>
+void Comm::scatterv(const xt::xtensor<T, 1>& sendbuf,
+                    xt::xtensor<T, 1>& recvbuf,
+                    const std::vector<int>& counts,
+                    int root) const
+{
+  if (this->active()) {
+    std::vector<int> displs;
+    if (rank == root) {
+      displs = displacements(counts);
+    }
+    std::size_t n_values = recvbuf.size() + (rank == root ? sendbuf.size() : 0);
+    CommStats::Call call(n_values * sizeof(T));
+    Scatterv(sendbuf.data(),
+             counts.data(),
+             displs.data(),
+             get_mpi_type<T>(),
+             recvbuf.data(),
+             recvbuf.size(),
+             get_mpi_type<T>(),
+             root);
+  }
+}
+
+template<typename T>
+CommRequest Comm::isend(const std::vector<T>& values, int dest, int tag) const
+{
+  CommRequest request;
+  if (this->active()) {
+    request.requests_.resize(1);
+    CommStats::Call call(values.size() * sizeof(T));
+    Isend(values.data(), values.size(), get_mpi_type<T>(), dest, tag, request.requests_.data());
+  }
+  return request;
+}
+
+template<typename T, size_t N>
+CommRequest Comm::isend(const xt::xtensor<T, N>& values, int dest, int tag) const
+{
+  CommRequest request;
+  if (this->active()) {
+    request.requests_.resize(1);
+    CommStats::Call call(values.size() * sizeof(T));
+    Isend(values.data(), values.size(), get_mpi_type<T>(), dest, tag, request.requests_.data());
+  }
+  return request;
+}
+
+template<typename T>
+CommRequest Comm::irecv(std::vector<T>& values, int source, int tag) const
+{
+  CommRequest request;
+  if (this->active()) {
+    request.requests_.resize(1);
+    CommStats::Call call(values.size() * sizeof(T));
+    Irecv(values.data(), values.size(), get_mpi_type<T>(), source, tag, request.requests_.data());
+  }
+  return request;
+}
+
+template<typename T, size_t N>
+CommRequest Comm::irecv(xt::xtensor<T, N>& values, int source, int tag) const
+{
+  CommRequest request;
+  if (this->active()) {
+    request.requests_.resize(1);
+    CommStats::Call call(values.size() * sizeof(T));
+    Irecv(values.data(), values.size(), get_mpi_type<T>(), source, tag, request.requests_.data());
+  }
+  return request;
+}
+
+template<typename T>
+CommRequest Comm::ibroadcast(std::vector<T>& values, int root) const
+{
+  CommRequest request;
+  if (this->active()) {
+    request.requests_.resize(1);
+    CommStats::Call call(values.size() * sizeof(T));
+    Ibcast(values.data(), values.size(), get_mpi_type<T>(), root, request.requests_.data());
+  }
+  return request;
+}
+
+template<typename T, size_t N>
+CommRequest Comm::ibroadcast(xt::xtensor<T, N>& values, int root) const
+{
+  CommRequest request;
+  if (this->active()) {
+    request.requests_.resize(1);
+    CommStats::Call call(values.size() * sizeof(T));
+    Ibcast(values.data(), values.size(), get_mpi_type<T>(), root, request.requests_.data());
+  }
+  return request;
+}
+
+template<typename T>
+CommRequest Comm::igatherv(const std::vector<T>& sendbuf,
+                           std::vector<T>& recvbuf,
+                           const std::vector<int>& counts,
+                           int root) const
+{
+  CommRequest request;
+  if (this->active()) {
+    std::vector<int> displs;
+    if (rank == root) {
+      displs = displacements(counts);
+      recvbuf.resize(displs.empty() ? 0 : displs.back() + counts.back());
+    }
+    request.buffers_.push_back(counts);
+    request.buffers_.push_back(std::move(displs));
+    request.requests_.resize(1);
+    std::size_t n_values = sendbuf.size() + (rank == root ? recvbuf.size() : 0);
+    CommStats::Call call(n_values * sizeof(T));
+    Igatherv(sendbuf.data(),
+             sendbuf.size(),
+             get_mpi_type<T>(),
+             recvbuf.data(),
+             request.buffers_[0].data(),
+             request.buffers_[1].data(),
+             get_mpi_type<T>(),
+             root,
+             request.requests_.data());
+  }
+  return request;
+}
+
+template<typename T>
+CommRequest Comm::igatherv(const xt::xtensor<T, 1>& sendbuf,
+                           xt::xtensor<T, 1>& recvbuf,
+                           const std::vector<int>& counts,
+                           int root) const
+{
+  CommRequest request;
+  if (this->active()) {
+    std::vector<int> displs;
+    if (rank == root) {
+      displs = displacements(counts);
+      std::size_t n = displs.empty() ? 0 : displs.back() + counts.back();
+      recvbuf.resize({n});
+    }
+    request.buffers_.push_back(counts);
+    request.buffers_.push_back(std::move(displs));
+    request.requests_.resize(1);
+    std::size_t n_values = sendbuf.size() + (rank == root ? recvbuf.size() : 0);
+    CommStats::Call call(n_values * sizeof(T));
+    Igatherv(sendbuf.data(),
+             sendbuf.size(),
+             get_mpi_type<T>(),
+             recvbuf.data(),
+             request.buffers_[0].data(),
+             request.buffers_[1].data(),
+             get_mpi_type<T>(),
+             root,
+             request.requests_.data());
+  }
+  return request;
+}
+
+template<typename T>
+CommRequest Comm::iscatterv(const std::vector<T>& sendbuf,
+                            std::vector<T>& recvbuf,
+                            const std::vector<int>& counts,
+                            int root) const
+{
+  CommRequest request;
+  if (this->active()) {
+    std::vector<int> displs;
+    if (rank == root) {
+      displs = displacements(counts);
+    }
+    request.buffers_.push_back(counts);
+    request.buffers_.push_back(std::move(displs));
+    request.requests_.resize(1);
+    std::size_t n_values = recvbuf.size() + (rank == root ? sendbuf.size() : 0);
+    CommStats::Call call(n_values * sizeof(T));
+    Iscatterv(sendbuf.data(),
+              request.buffers_[0].data(),
+              request.buffers_[1].data(),
+              get_mpi_type<T>(),
+              recvbuf.data(),
+              recvbuf.size(),
+              get_mpi_type<T>(),
+              root,
+              request.requests_.data());
+  }
+  return request;
+}
+
+template<typename T>
+CommRequest Comm::iscatterv(const xt::xtensor<T, 1>& sendbuf,
+                            xt::xtensor<T, 1>& recvbuf,
+                            const std::vector<int>& counts,
+                            int root) const
+{
+  CommRequest request;
+  if (this->active()) {
+    std::vector<int> displs;
+    if (rank == root) {
+      displs = displacements(counts);
+    }
+    request.buffers_.push_back(counts);
+    request.buffers_.push_back(std::move(displs));
+    request.requests_.resize(1);
+    std::size_t n_values = recvbuf.size() + (rank == root ? sendbuf.size() : 0);
+    CommStats::Call call(n_values * sizeof(T));
+    Iscatterv(sendbuf.data(),
+              request.buffers_[0].data(),
+              request.buffers_[1].data(),
+              get_mpi_type<T>(),
+              recvbuf.data(),
+              recvbuf.size(),
+              get_mpi_type<T>(),
+              root,
+              request.requests_.data());
+  }
+  return request;
+}
+
 template<typename T>
 std::enable_if_t<std::is_scalar<std::decay_t<T>>::value> Comm::broadcast(T& value,
                                                                          int root) const
 {
   if (this->active()) {
+    CommStats::Call call(sizeof(T));
     Bcast(&value, 1, get_mpi_type<T>(), root);
   }
 }
@@ -361,6 +1116,7 @@ void Comm::broadcast(std::vector<T>& values, int root) const
     // Resize vector (for rank != 0) and broacast data
     if (values.size() != n)
       values.resize(n);
+    CommStats::Call call(n * sizeof(T));
     Bcast(values.data(), n, get_mpi_type<T>(), root);
   }
 }
@@ -383,6 +1139,7 @@ void Comm::broadcast(xt::xtensor<T, N>& values, int root) const
     auto n = values.size();
 
     // Finally, broadcast data
+    CommStats::Call call(n * sizeof(T));
     Bcast(values.data(), n, get_mpi_type<T>(), root);
   }
 }
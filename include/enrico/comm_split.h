@@ -5,6 +5,8 @@
 
 #include <array>
 #include <mpi.h>
+#include <utility> // for pair
+#include <vector>
 
 namespace enrico {
 
@@ -29,6 +31,60 @@ void get_driver_comms(Comm super_comm,
                       Comm& intranode_comm,
                       Comm& coupling_comm);
 
+//! Counts the nodes (shared memory regions) spanned by a communicator
+//!
+//! \param[in] super_comm An existing communicator
+//! \param[out] total_nodes The number of nodes that super_comm spans
+//! \param[out] node_size The largest number of procs of super_comm on a node
+void get_node_layout(Comm super_comm, int& total_nodes, int& node_size);
+
+//! Layout of the single-physics drivers' communicators over the nodes, as given to
+//! get_driver_comms
+struct CommLayout {
+  std::array<int, 2> num_nodes;      //!< Number of nodes of each driver
+  std::array<int, 2> procs_per_node; //!< Number of procs/node of each driver
+  double time = 0.0;                 //!< Predicted time of both solves [s]
+};
+
+//! Replaces the values <= 0 of a layout with the ones get_driver_comms uses for them
+//!
+//! \param[in] layout A layout as given to get_driver_comms
+//! \param[in] total_nodes The number of nodes available
+//! \param[in] node_size The number of procs on each node
+//! \return The layout with the number of nodes and procs/node of each driver
+CommLayout resolve_layout(const CommLayout& layout, int total_nodes, int node_size);
+
+//! Fits the strong scaling of a driver's solve time to t = c n^(-s)
+//!
+//! \param[in] samples Pairs of a number of nodes and the solve time measured with it
+//! \return The exponent s, restricted to [0, 1].  Ideal scaling (1) is assumed if
+//!         the samples have fewer than two distinct numbers of nodes.
+double fit_strong_scaling(const std::vector<std::pair<int, double>>& samples);
+
+//! Plans the layout of the driver communicators that balances their solve times
+//!
+//! The solve time of driver i on n nodes, with its procs/node unchanged, is
+//! predicted as t_i (n_i / n)^s_i from the time t_i it took on n_i nodes.  The
+//! candidates are the layouts that get_driver_comms creates: drivers on disjoint
+//! sets of nodes, and both drivers on all nodes.  In the latter case, the drivers
+//! share ranks so their solves never overlap.
+//!
+//! \param[in] total_nodes The number of nodes available
+//! \param[in] node_size The number of procs on each node
+//! \param[in] current The layout the solve times were measured with.  Values <= 0
+//!            have the same meaning as in get_driver_comms.
+//! \param[in] solve_times The measured solve time of each driver [s]
+//! \param[in] scaling The strong scaling exponent s of each driver
+//! \param[in] concurrent Whether drivers on disjoint nodes solve at the same time
+//! \return The layout with the smallest predicted time.  The current layout is
+//!         returned if no other layout is predicted to be faster.
+CommLayout plan_driver_comms(int total_nodes,
+                             int node_size,
+                             const CommLayout& current,
+                             std::array<double, 2> solve_times,
+                             std::array<double, 2> scaling,
+                             bool concurrent);
+
 //! Gathers the ranks (wrt super) that are also in sub
 std::vector<int> gather_subcomm_ranks(const Comm& super, const Comm& sub);
 }
@@ -0,0 +1,100 @@
+//! \file comm_stats.h
+//! Optional counts of the communication done through Comm, by call site
+#ifndef ENRICO_COMM_STATS_H
+#define ENRICO_COMM_STATS_H
+
+#include <mpi.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace enrico {
+
+//! Communication of the calling rank at one call site
+struct CommCounts {
+  std::int64_t messages = 0; //!< Number of point-to-point messages and collectives
+  std::int64_t bytes = 0;    //!< Number of bytes sent and received
+  double wait = 0.0;         //!< Time spent in blocking calls and in waits, in seconds
+};
+
+//! Process-wide counts of the communication done through Comm, grouped by the call
+//! site that was current when it happened.
+//!
+//! Counting is off unless enabled; when it is on, each counted call costs two calls
+//! to MPI_Wtime.  Communication outside of any call site is counted under "".
+class CommStats {
+public:
+  //! Names the call site of the communication done while it exists.  Sites nest, and
+  //! the innermost one is current.
+  class Site {
+  public:
+    //! \param name Name of the call site, which must outlive the Site
+    explicit Site(const char* name)
+      : previous_(current_)
+    {
+      current_ = name;
+    }
+
+    ~Site() { current_ = previous_; }
+
+    Site(const Site&) = delete;
+    Site& operator=(const Site&) = delete;
+
+  private:
+    const char* previous_; //!< Call site that was current before this one
+  };
+
+  //! Counts one MPI call at the current call site, with the time until it is destroyed
+  class Call {
+  public:
+    //! \param bytes Number of bytes sent and received by the calling rank
+    //! \param messages Number of messages or collectives started by the call
+    explicit Call(std::int64_t bytes, std::int64_t messages = 1)
+      : bytes_(bytes)
+      , messages_(messages)
+      , start_(enabled_ ? MPI_Wtime() : 0.0)
+    {}
+
+    ~Call()
+    {
+      if (enabled_) {
+        record(messages_, bytes_, MPI_Wtime() - start_);
+      }
+    }
+
+    Call(const Call&) = delete;
+    Call& operator=(const Call&) = delete;
+
+  private:
+    std::int64_t bytes_;    //!< Number of bytes sent and received
+    std::int64_t messages_; //!< Number of messages or collectives
+    double start_;          //!< Time at which the call started
+  };
+
+  //! Turn counting on or off
+  static void enable(bool enabled) { enabled_ = enabled; }
+
+  //! Whether communication is counted
+  static bool enabled() { return enabled_; }
+
+  //! Communication of the calling rank at a call site so far
+  //! \param site Name of the call site
+  //! \return Counts, which are zero if nothing was counted at the site
+  static CommCounts counts(const std::string& site);
+
+  //! Discard all counts
+  static void reset();
+
+private:
+  //! Add one call to the counts of the current call site
+  static void record(std::int64_t messages, std::int64_t bytes, double wait);
+
+  static bool enabled_;                            //!< Whether counting is on
+  static const char* current_;                     //!< Current call site, or nullptr
+  static std::map<std::string, CommCounts> counts_; //!< Counts by call site
+};
+
+} // namespace enrico
+
+#endif // ENRICO_COMM_STATS_H
@@ -5,16 +5,24 @@
 #define ENRICO_COUPLED_DRIVER_H
 
 #include "enrico/boron_driver.h"
+#include "enrico/comm_split.h"
 #include "enrico/driver.h"
 #include "enrico/heat_fluids_driver.h"
 #include "enrico/neutronics_driver.h"
+#include "enrico/relaxation.h"
+#include "enrico/shared_window.h"
+#include "enrico/thermal_state.h"
 #include "enrico/timer.h"
 
 #include <pugixml.hpp>
 #include <xtensor/xtensor.hpp>
 
-#include <map>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <memory> // for unique_ptr
+#include <string>
 #include <vector>
 
 namespace enrico {
@@ -31,6 +39,17 @@ public:
   //! while 'heat' sets temperature based on a thermal-fluids input (or restart) file.
   enum class Initial { neutronics, heat };
 
+  //! Enumeration of available coupling schemes.  With 'gauss_seidel', the
+  //! heat/fluids solver uses the heat source from the neutronics solve of the same
+  //! Picard iteration.  With 'jacobi', both solvers run at the same time using the
+  //! fields of the previous Picard iteration.
+  enum class CouplingScheme { gauss_seidel, jacobi };
+
+  //! Enumeration of available timestep predictors.  With 'linear' or 'quadratic',
+  //! each timestep starts from the cell-averaged fields extrapolated from the
+  //! converged fields of the last two or three timesteps.
+  enum class Predictor { none, linear, quadratic };
+
   //! Initializes coupled neutron transport and thermal-hydraulics solver with
   //! the given MPI communicator
   //!
@@ -38,6 +57,29 @@ public:
   //! \param node XML node containing settings
   CoupledDriver(MPI_Comm comm, pugi::xml_node node);
 
+  //! Creates a neutronics driver on the neutronics communicator from the
+  //! <neutronics> node
+  using NeutronicsFactory =
+    std::function<std::unique_ptr<NeutronicsDriver>(MPI_Comm, pugi::xml_node)>;
+
+  //! Creates a heat/fluids driver on the heat/fluids communicator from the
+  //! <heat_fluids> node
+  using HeatFluidsFactory =
+    std::function<std::unique_ptr<HeatFluidsDriver>(MPI_Comm, pugi::xml_node)>;
+
+  //! Initializes the coupled solver with drivers created by the given factories
+  //! instead of the ones named by <driver> in the XML nodes, e.g. synthetic drivers
+  //! for benchmarks of the coupling
+  //!
+  //! \param comm The MPI communicator used for the coupled driver
+  //! \param node XML node containing settings
+  //! \param make_neutronics Creates the neutronics driver, if not empty
+  //! \param make_heat Creates the heat/fluids driver, if not empty
+  CoupledDriver(MPI_Comm comm,
+                pugi::xml_node node,
+                NeutronicsFactory make_neutronics,
+                HeatFluidsFactory make_heat);
+
   ~CoupledDriver() = default;
 
   //! Execute the coupled driver
@@ -64,6 +106,13 @@ public:
   //! \param relax Apply relaxation to density before updating neutronics solver
   void update_density(bool relax);
 
+  //! Update both the temperature and the density for the neutronics solver, moving
+  //! them from the heat/fluids ranks in a single exchange
+  //!
+  //! \param relax Apply relaxation to temperature and density before updating
+  //! neutronics solver
+  void update_thermal_state(bool relax);
+
   //! Check convergence of the coupled solve for the current Picard iteration.
   bool is_converged();
 
@@ -110,22 +159,58 @@ public:
 
   bool boron_search_{false};  //!< Flag to set if a Boron search is performed
 
+  //! Whether the boron search uses the sensitivity of k-eff to the boron
+  //! concentration estimated by the neutronics solver in the same solve
+  bool boron_sensitivity_{false};
+
   int max_picard_iter_; //!< Maximum number of Picard iterations
 
+  //! Path to a file caching the mapping of heat/fluids elements to neutronics cells.
+  //! Empty if the mapping is not cached.
+  std::string mapping_cache_;
+
+  //! Number of element centroids sent to the neutronics root at a time when the
+  //! mapping of heat/fluids elements to neutronics cells is built
+  std::int64_t mapping_chunk_size_{1 << 20};
+
+  //! Path of the checkpoint file written every checkpoint_interval_ Picard
+  //! iterations.  Empty if no checkpoint is written.
+  std::string checkpoint_;
+
+  //! Number of Picard iterations between checkpoints, defaults to 1 if not set
+  int checkpoint_interval_{1};
+
+  //! Path of a checkpoint file the run resumes from.  Empty if the run starts from
+  //! the initial conditions.
+  std::string restart_;
+
+  //! Path to a file the communicator layout planned from the solve times of the
+  //! first Picard iteration is written to.  If the file holds a plan for the same
+  //! nodes, it is used instead of <nodes> and <procs_per_node>.  Empty if the layout
+  //! is not planned.
+  std::string comm_plan_;
+
+  //! Path to a JSON file in the Chrome trace format that the intervals of all timers
+  //! on all ranks are written to at the end of the run.  Empty if no trace is written.
+  std::string timing_trace_;
+
+  //! Time at which all ranks entered the constructor, the origin of the trace
+  double trace_origin_;
+
   //! Picard iteration convergence tolerance, defaults to 1e-3 if not set
   double epsilon_{1e-3};
 
-  //! Constant relaxation factor for the heat source,
-  //! defaults to 1.0 (standard Picard) if not set
-  double alpha_{1.0};
+  //! Relaxation of the heat source, defaults to none (standard Picard) if not set
+  std::unique_ptr<Relaxation> heat_source_relaxation_;
+
+  //! Relaxation of the temperature, defaults to none if not set
+  std::unique_ptr<Relaxation> temperature_relaxation_;
 
-  //! Constant relaxation factor for the temperature, defaults to the
-  //! relaxation aplied to the heat source if not set
-  double alpha_T_{alpha_};
+  //! Relaxation of the density, defaults to none if not set
+  std::unique_ptr<Relaxation> density_relaxation_;
 
-  //! Constant relaxation factor for the density, defaults to the
-  //! relaxation applied to the heat source if not set
-  double alpha_rho_{alpha_};
+  //! Number of previous iterates combined by Anderson mixing, defaults to 5 if not set
+  int anderson_depth_{5};
 
   //! Where to obtain the temperature initial condition from. Defaults to the
   //! temperatures in the neutronics input file.
@@ -135,9 +220,55 @@ public:
   //! in the neutronics input file.
   Initial density_ic_{Initial::neutronics};
 
+  //! Fewest particles per batch for the neutronics solver in a Picard iteration.  If
+  //! positive, the number of particles grows from this value as the temperature
+  //! converges, up to the value in the neutronics input.  Defaults to 0 (disabled).
+  std::int64_t min_particles_{0};
+
+  //! Most particles per batch for the neutronics solver in a Picard iteration, taken
+  //! from the neutronics input.  Set only on neutronics ranks.
+  std::int64_t max_particles_{0};
+
+  //! Temperature norm from the latest convergence check, or negative if there was none
+  double temperature_norm_{-1.0};
+
+  //! Smallest change in the temperature [K] of a cell for it to be sent to the
+  //! neutronics solver.  If either this or density_update_tol_ is positive, only the
+  //! cells that changed are sent.  Defaults to 0 (every cell is sent).
+  double temperature_update_tol_{0.0};
+
+  //! Smallest change in the density [g/cm^3] of a fluid cell for it to be sent to
+  //! the neutronics solver.  Defaults to 0.
+  double density_update_tol_{0.0};
+
+  //! Whether only the cells whose temperature or density changed are sent
+  bool incremental_update() const
+  {
+    return temperature_update_tol_ > 0.0 || density_update_tol_ > 0.0;
+  }
+
+  //! How the solvers are ordered within a Picard iteration.  Defaults to Gauss-Seidel.
+  CouplingScheme coupling_scheme_{CouplingScheme::gauss_seidel};
+
+  //! How the fields at the start of a timestep are predicted from the previous
+  //! timesteps.  Defaults to none (the last iterate is used).
+  Predictor predictor_{Predictor::none};
+
+  //! Whether the temperature and density are shared by the neutronics ranks of each
+  //! node through an MPI-3 shared memory window.  Defaults to false.
+  bool shared_memory_{false};
+
+  //! Whether the ranks that are idle while a driver runs lend their OpenMP threads
+  //! to the ranks of the driver on the same node.  Defaults to false.
+  bool thread_lending_{false};
+
   //! Report cumulative times for CoupledDriver member functions
   void timer_report();
 
+  //! Write the intervals of all timers on all ranks to timing_trace_.  Collective on
+  //! comm_.
+  void write_timing_trace();
+
   Timer timer_init_comms;         //!< For initialzing subcommunicators, etc.
   Timer timer_init_mapping;       //!< For the init_mapping() member function
   Timer timer_init_tallies;       //!< For the init_tallies() member function
@@ -149,17 +280,105 @@ public:
   Timer timer_update_density;     //!< For the update_density() member function
   Timer timer_update_heat_source; //!< For the update_heat_source() member function
   Timer timer_update_temperature; //!< For the update_temperature() member function
+  Timer timer_update_thermal_state; //!< For the update_thermal_state() member function
 
 private:
+  //! A timer of one of the drivers with its label
+  struct TimedRegion {
+    std::string driver; //!< Name of the driver the timer belongs to
+    std::string name;   //!< Name of the timed member function
+    Timer* timer;
+  };
+
+  //! Timers of the coupled driver and the single-physics drivers, in report order
+  std::vector<TimedRegion> timed_regions();
+
+  //! Report the communication counted by CommStats for each CoupledDriver member
+  //! function: the mean and maximum over the ranks, and the neutronics root's counts.
+  //! Collective on comm_.
+  //! \param regions Timers of the drivers, from timed_regions()
+  void comm_stats_report(const std::vector<TimedRegion>& regions);
+
   //! Parse coupled driver's runtime parameters from enrico.xml
   void parse_xml_params(const pugi::xml_node& node);
 
-  //! Create subcommunicators for single-physics drivers
-  void init_comms(const pugi::xml_node& node);
+  //! Create subcommunicators for single-physics drivers, and the drivers on them
+  //!
+  //! \param node XML node containing settings
+  //! \param make_neutronics Creates the neutronics driver, if not empty
+  //! \param make_heat Creates the heat/fluids driver, if not empty
+  void init_comms(const pugi::xml_node& node,
+                  const NeutronicsFactory& make_neutronics,
+                  const HeatFluidsFactory& make_heat);
+
+  //! Write the coupled fields, k-effective, boron concentration, iteration indices
+  //! and neutronics fission source to checkpoint_ with MPI-IO.  Collective on comm_.
+  //! \param converged Whether the current Picard iteration converged
+  void write_checkpoint(bool converged);
+
+  //! Read the state written by write_checkpoint() from restart_ and set up the run
+  //! to resume after the checkpointed Picard iteration.  Collective on comm_.
+  void read_checkpoint();
+
+  //! Read the layout of the driver communicators and the solve times measured by
+  //! earlier launches from comm_plan_
+  //! \param layout Layout from <nodes> and <procs_per_node>, replaced by the planned
+  //! one if the plan was made for the same nodes
+  void read_comm_plan(CommLayout& layout);
+
+  //! Plan the layout of the driver communicators that balances the solve times of
+  //! the first Picard iteration, report it and write it to comm_plan_
+  void plan_comms();
 
   //! Create mappings between neutronics cell instances and heat/fluids elements
   void init_mapping();
 
+  //! Create the comm of the node leaders and the shared array that the temperature
+  //! and density are distributed through
+  void init_shared_memory();
+
+  //! Make the stores of the heat/fluids ranks to the shared array visible and start
+  //! the exchange of the cells of each node between the node leaders.  Collective
+  //! over comm_.
+  //!
+  //! \return Handle to the pending exchange
+  CommRequest exchange_shared_thermal_state();
+
+  //! Stream the element centroids of the heat/fluids ranks to the neutronics root in
+  //! chunks of mapping_chunk_size_, in rank order, and process each chunk.  The next
+  //! chunk is gathered, and the cells found for the previous one scattered back, while
+  //! a chunk is processed, so the memory on the root is bounded by two chunks.
+  //! Collective over comm_.
+  //! \param centroids Centroids of the local elements
+  //! \param elem_counts Number of elements of each rank (significant at the neutronics
+  //! root)
+  //! \param process Called on every rank of comm_ with each chunk of centroids, which
+  //! is significant at the neutronics root, and returns the cell of each of them at
+  //! the neutronics root
+  //! \return Cell of each local element
+  std::vector<CellHandle> stream_centroids(
+    const std::vector<Position>& centroids,
+    const std::vector<int>& elem_counts,
+    const std::function<std::vector<CellHandle>(const std::vector<Position>&)>& process);
+
+  //! Read the mapping of heat/fluids elements to neutronics cells from mapping_cache_
+  //! \param key Hash of the element centroids and the neutronics geometry
+  //! \param n_elems Number of heat/fluids elements over all ranks
+  //! \param elem_to_cell Cell handle of each element, in the order of the gathered
+  //! centroids
+  //! \return Whether a complete mapping of n_elems elements with a matching key was
+  //! read
+  bool read_mapping_cache(std::uint64_t key,
+                          std::size_t n_elems,
+                          std::vector<CellHandle>& elem_to_cell) const;
+
+  //! Write the mapping of heat/fluids elements to neutronics cells to mapping_cache_
+  //! \param key Hash of the element centroids and the neutronics geometry
+  //! \param elem_to_cell Cell handle of each element, in the order of the gathered
+  //! centroids
+  void write_mapping_cache(std::uint64_t key,
+                           const std::vector<CellHandle>& elem_to_cell) const;
+
   //! Initialize the Monte Carlo tallies for all cells
   void init_tallies();
 
@@ -189,11 +408,193 @@ private:
   //! this member function does not set any initial values.
   void init_heat_source();
 
+  //! Start updating the heat source for the thermal-hydraulics solver.  The heat
+  //! source is computed on the neutronics ranks and a nonblocking scatter to the
+  //! heat/fluids ranks is started.
+  //!
+  //! \param relax Copy the current heat source to the previous iterate for relaxation
+  //! \return Handle to the pending scatter, to be passed to end_heat_source_update()
+  CommRequest begin_heat_source_update(bool relax);
+
+  //! Complete an update started by begin_heat_source_update() and set the heat source
+  //! in the thermal-hydraulics solver
+  //!
+  //! \param request Handle returned by begin_heat_source_update()
+  //! \param relax Apply relaxation to heat source before updating heat solver
+  void end_heat_source_update(CommRequest& request, bool relax);
+
+  //! Start updating the temperature and density for the neutronics solver.  The
+  //! local cell-averaged fields are computed on the heat/fluids ranks and a
+  //! nonblocking gather to the neutronics root is started.
+  //!
+  //! \param relax Apply relaxation to temperature and density
+  //! \return Handle to the pending gather, to be passed to end_thermal_state_update()
+  CommRequest begin_thermal_state_update(bool relax);
+
+  //! Start the nonblocking gather of the local cell-averaged temperature and density
+  //! of the heat/fluids ranks to the neutronics root, without recomputing them.  With
+  //! shared memory, the heat/fluids ranks store them in the shared array instead.
+  //!
+  //! \return Handle to the pending gather, to be passed to end_thermal_state_update()
+  CommRequest send_thermal_state();
+
+  //! Set the heat source of the local elements of the heat/fluids driver from the
+  //! local cell-averaged heat source
+  void set_elem_heat_source();
+
+  //! Keep the converged local cell-averaged fields of the current timestep for the
+  //! predictor, dropping the ones no longer needed.  Only on heat/fluids ranks.
+  void store_timestep_state();
+
+  //! Extrapolate the local cell-averaged fields of the next timestep from the stored
+  //! ones and set the heat source of the heat/fluids driver.  Only on heat/fluids
+  //! ranks.
+  //!
+  //! \param order Order of the extrapolation, at most the number of stored
+  //! timesteps minus one
+  void predict_timestep_state(int order);
+
+  //! Complete an update started by begin_thermal_state_update() and set the
+  //! temperature and density in the neutronics solver.  Does nothing if there is no
+  //! pending update.
+  //!
+  //! \param request Handle returned by begin_thermal_state_update()
+  void end_thermal_state_update(CommRequest& request);
+
+  //! Send the temperature and density of every cell to the neutronics ranks, which
+  //! keep them as the starting point of incremental updates
+  void init_incremental_update();
+
+  //! Compute the local cell-averaged temperature from the heat/fluids solution,
+  //! optionally applying relaxation.  Called only on heat/fluids ranks.
+  //!
+  //! \param elem_temperatures Temperature of each local element
+  //! \param relax Apply relaxation to the cell-averaged temperature
+  void compute_cell_temperature(gsl::span<const double> elem_temperatures, bool relax);
+
+  //! Compute the local cell-averaged density of fluid cells from the heat/fluids
+  //! solution, optionally applying relaxation.  Called only on heat/fluids ranks.
+  //!
+  //! \param elem_densities Density of each local element
+  //! \param relax Apply relaxation to the cell-averaged density
+  void compute_cell_density(gsl::span<const double> elem_densities, bool relax);
+
+  //! Set cell temperatures in the neutronics solver from the local cell temperatures
+  //! of all heat/fluids ranks.  Called only on neutronics ranks.
+  //!
+  //! \param T Temperatures of the cells in coupled_cells_
+  void set_neutronics_temperature(const xt::xtensor<double, 1>& T);
+
+  //! Set fluid cell densities in the neutronics solver from the local cell densities
+  //! of all heat/fluids ranks.  Called only on neutronics ranks.
+  //!
+  //! \param rho Densities of the cells in coupled_cells_
+  void set_neutronics_density(const xt::xtensor<double, 1>& rho);
+
+  //! Volume-average a field given on the cells in coupled_cells_ over each neutronics
+  //! cell, storing the averages in neutronics_values_.  Called only on neutronics ranks.
+  //!
+  //! \param values Field value of each cell in coupled_cells_
+  //! \param cells Neutronics cell indices to compute averages for
+  //! \param volumes Total volume of each neutronics cell over the included cells
+  //! \param fluid_only Include only fluid cells of coupled_cells_
+  void average_over_neutronics_cells(const xt::xtensor<double, 1>& values,
+                                     const std::vector<gsl::index>& cells,
+                                     const std::vector<double>& volumes,
+                                     bool fluid_only);
+
+  //! Number of particles per batch for the next neutronics solve.  Since the
+  //! statistical error falls as the inverse square root of the number of particles,
+  //! the number grows as the inverse square of the latest temperature norm, reaching
+  //! max_particles_ when the norm reaches the convergence tolerance.
+  //! \return Number of particles per batch
+  std::int64_t scheduled_particles() const;
+
+  //! Apply a relaxation to a local cell field and report the residual.  Called only
+  //! on heat/fluids ranks.
+  //!
+  //! \param relaxation The relaxation to apply
+  //! \param label Name of the field, for the report
+  //! \param x On input, next estimate of the field; on output, relaxed field
+  //! \param x_prev Field at the previous Picard iteration
+  void apply_relaxation(Relaxation& relaxation,
+                        const std::string& label,
+                        xt::xtensor<double, 1>& x,
+                        const xt::xtensor<double, 1>& x_prev);
+
+  //! Set the number of OpenMP threads to the one used by a single-physics driver
+  //! \param driver The driver about to run
+  //! \param lent_threads Threads lent by idle ranks on the same node, added to the
+  //! driver's own threads
+  void set_driver_threads(const Driver& driver, int lent_threads = 0) const;
+
+  //! Set the OpenMP threads of the ranks about to run a driver.  Collective on comm_.
+  //! \param driver The driver about to run
+  //! \param lend Whether the ranks on the same node that don't run the driver lend
+  //! their threads to the ones that do
+  void begin_driver_run(const Driver& driver, bool lend) const;
+
+  //! Wait until every rank has finished running a driver, with the ranks that lent
+  //! their threads sleeping meanwhile.  Collective on comm_; does nothing if the
+  //! threads were not lent.
+  //! \param driver The driver that ran
+  //! \param lend Whether threads were lent by begin_driver_run
+  void end_driver_run(const Driver& driver, bool lend) const;
+
   //! Print report of communicator layout if high verbosity is set
   void comm_report();
 
-  //! Special alpha value indicating use of Robbins-Monro relaxation
-  constexpr static double ROBBINS_MONRO = -1.0;
+  //! Solve time of a driver measured in the first Picard iteration of a launch
+  struct CommSample {
+    int nodes;          //!< Number of nodes of the driver
+    int procs_per_node; //!< Number of procs/node of the driver
+    double time;        //!< Solve time [s]
+  };
+
+  //! Whether the state was read from restart_ and the first Picard iteration after
+  //! it has not finished
+  bool resumed_{false};
+
+  int resume_timestep_{0}; //!< Index of the time step the run starts at
+  int resume_picard_{0};   //!< Index of the Picard iteration the run starts at
+
+  Comm intranode_comm_; //!< The ranks of comm_ on the same node as this rank
+
+  //! The root of intranode_comm_ on each node.  Set only on those ranks with shared
+  //! memory.
+  Comm node_leader_comm_;
+
+  //! Temperature and density of all coupled cells, shared by the ranks of a node.
+  //! The cells of the heat/fluids ranks of each node are contiguous, in rank order,
+  //! and the nodes are in the order of node_leader_comm_.  Set with shared memory.
+  SharedWindow<ThermalState> shared_thermal_state_;
+
+  //! Index in shared_thermal_state_ of the first local cell.  Set only on
+  //! heat/fluids ranks with shared memory.
+  std::size_t shared_offset_{0};
+
+  //! Index in shared_thermal_state_ of each cell in coupled_cells_.  Set only on
+  //! neutronics ranks with shared memory.
+  std::vector<std::size_t> shared_positions_;
+
+  //! Number of cells of the heat/fluids ranks of each node in shared_thermal_state_.
+  //! Set only on node leaders with shared memory.
+  std::vector<int> node_cell_counts_;
+
+  //! Index in shared_thermal_state_ of the first cell of each node.  Set only on node
+  //! leaders with shared memory.
+  std::vector<int> node_cell_displs_;
+
+  int total_nodes_; //!< Number of nodes spanned by comm_
+  int node_size_;   //!< Largest number of procs of comm_ on a node
+
+  //! Layout of the neutronics and heat/fluids communicators over the nodes, with
+  //! every value resolved
+  CommLayout comm_layout_;
+
+  //! Solve times of the neutronics and heat/fluids drivers, including the ones
+  //! measured by earlier launches with the same comm_plan_
+  std::array<std::vector<CommSample>, 2> comm_samples_;
 
   int i_timestep_; //!< Index pertaining to current timestep
 
@@ -229,6 +630,55 @@ private:
   //! Local cell heat source at previous Picard iteration. Set only on heat/fluids ranks.
   xt::xtensor<double, 1> cell_heat_source_prev_;
 
+  //! Converged local cell-averaged fields of a timestep
+  struct CellState {
+    xt::xtensor<double, 1> temperature; //!< Temperature in [K]
+    xt::xtensor<double, 1> density;     //!< Density in [g/cm^3]
+    xt::xtensor<double, 1> heat_source; //!< Heat source in [W/cm^3]
+  };
+
+  //! Converged fields of the latest timesteps, oldest first, used by the timestep
+  //! predictor.  Set only on heat/fluids ranks.
+  std::deque<CellState> timestep_states_;
+
+  //! Heat source of the cells in coupled_cells_, being scattered to the heat/fluids
+  //! ranks.  Set only on the neutronics root.
+  xt::xtensor<double, 1> coupled_heat_source_;
+
+  //! Packed local cell temperature and density being sent to the neutronics root.
+  //! Set only on heat/fluids ranks.
+  std::vector<ThermalState> thermal_state_send_;
+
+  //! Temperature and density of the cells in coupled_cells_, received from the
+  //! heat/fluids ranks.  Set only on neutronics ranks.
+  std::vector<ThermalState> coupled_thermal_state_;
+
+  //! Whether a transfer started by begin_thermal_state_update() has not been completed
+  bool thermal_state_pending_{false};
+
+  //! Local cell temperatures last sent to the neutronics ranks.  Set only on
+  //! heat/fluids ranks when the updates are incremental.
+  xt::xtensor<double, 1> cell_temperature_sent_;
+
+  //! Local cell densities last sent to the neutronics ranks.  Set only on
+  //! heat/fluids ranks when the updates are incremental.
+  xt::xtensor<double, 1> cell_density_sent_;
+
+  //! Local cells whose temperature or density changed by more than the tolerance.
+  //! Set only on heat/fluids ranks.
+  std::vector<int> changed_cells_;
+
+  //! Number of changed cells on each rank of comm_.  Set only on the neutronics root.
+  std::vector<int> changed_cell_counts_;
+
+  //! Indices in coupled_cells_ of the changed cells of all heat/fluids ranks.  Set
+  //! only on neutronics ranks.
+  std::vector<int> coupled_changed_cells_;
+
+  //! Temperature and density of the cells in coupled_changed_cells_.  Set only on
+  //! neutronics ranks.
+  std::vector<ThermalState> coupled_changed_thermal_state_;
+
   std::unique_ptr<NeutronicsDriver> neutronics_driver_;  //!< The neutronics driver
   std::unique_ptr<HeatFluidsDriver> heat_fluids_driver_; //!< The heat-fluids driver
   std::unique_ptr<BoronDriver> boron_driver_;            //!< The boron search driver
@@ -236,14 +686,24 @@ private:
   //! 1 if local cell is in fluid, 0 if in solid. Set only on heat/fluids ranks.
   std::vector<int> cell_fluid_mask_;
 
-  //! Maps heat/fluids element index to global cell handle.  Set only on heat/fluids ranks.
-  std::vector<CellHandle> elem_to_glob_cell_;
+  //! Consecutive local elements [first, last) that belong to the same local cell
+  struct ElemRun {
+    int32_t first; //!< First element of the run
+    int32_t last;  //!< One past the last element of the run
+  };
 
   //! Maps local cell index to global cell handle.  Set only on heat/fluid ranks.
   std::vector<CellHandle> cell_to_glob_cell_;
 
-  //! Maps global cell handle to local element index.  Set only on heat/fluids ranks.
-  std::map<CellHandle, std::vector<int32_t>> glob_cell_to_elem_;
+  //! CSR offsets into cell_elem_runs_: the elements of local cell i are the runs in
+  //! [cell_run_offsets_[i], cell_run_offsets_[i+1]).  Has one more entry than the
+  //! number of local cells.  Set only on heat/fluids ranks.
+  std::vector<int32_t> cell_run_offsets_;
+
+  //! Runs of local elements, grouped by local cell and in ascending order within a
+  //! cell.  Consecutive elements usually belong to the same cell, so there are far
+  //! fewer runs than elements.  Set only on heat/fluids ranks.
+  std::vector<ElemRun> cell_elem_runs_;
 
   //! Local cell volumes.  Set only on heat/fluids ranks.
   std::vector<double> cell_volume_;
@@ -251,6 +711,56 @@ private:
   //! Local element volumes.  Set only on heat/fluids ranks.
   std::vector<double> elem_volume_;
 
+  //! Local element field (temperature, density or heat source) exchanged with the
+  //! heat/fluids driver each iteration; kept so that the buffer is reused.  Set only
+  //! on heat/fluids ranks.
+  std::vector<double> elem_field_;
+
+  //! Local element densities, filled together with the temperatures in elem_field_
+  //! when both are updated at once.  Set only on heat/fluids ranks.
+  std::vector<double> elem_density_;
+
+  //! Number of local cells on each rank of comm_ (zero for ranks that are not
+  //! heat/fluids ranks).  Used for the gather/scatter of cell fields.  Set only on the
+  //! neutronics root.
+  std::vector<int> coupled_cell_counts_;
+
+  //! Global cell handles of the local cells of all heat/fluids ranks, concatenated in
+  //! rank order.  Set only on neutronics ranks.
+  std::vector<CellHandle> coupled_cells_;
+
+  //! Volumes of the local cells in coupled_cells_.  Set only on neutronics ranks.
+  std::vector<double> coupled_cell_volumes_;
+
+  //! Fluid mask of the local cells in coupled_cells_.  Set only on neutronics ranks.
+  std::vector<int> coupled_cell_fluid_mask_;
+
+  //! Index of each cell in coupled_cells_ in the neutronics driver's cell ordering
+  //! (see NeutronicsDriver::cell_index).  Set only on neutronics ranks.
+  std::vector<gsl::index> coupled_cell_indices_;
+
+  //! Distinct indices in coupled_cell_indices_, in ascending order.  Set only on
+  //! neutronics ranks.
+  std::vector<gsl::index> neutronics_cells_;
+
+  //! Distinct indices in coupled_cell_indices_ of fluid cells, in ascending order.
+  //! Set only on neutronics ranks.
+  std::vector<gsl::index> neutronics_fluid_cells_;
+
+  //! Total volume of the heat/fluids cells mapped to each neutronics cell, indexed by
+  //! neutronics cell index.  Set only on neutronics ranks.
+  std::vector<double> neutronics_cell_volume_;
+
+  //! Total volume of the heat/fluids fluid cells mapped to each neutronics cell,
+  //! indexed by neutronics cell index.  Set only on neutronics ranks.
+  std::vector<double> neutronics_fluid_volume_;
+
+  //! Scratch array for volume-weighted sums, indexed by neutronics cell index
+  std::vector<double> neutronics_sum_;
+
+  //! Scratch array of volume-averaged values passed to the neutronics driver
+  std::vector<double> neutronics_values_;
+
   // Norm to use for convergence checks
   Norm norm_{Norm::LINF};
 
@@ -258,6 +768,45 @@ private:
   bool verbose_ = false;
 };
 
+//! Time step and Picard iteration a run resumes at from a checkpoint
+struct ResumePoint {
+  int i_timestep; //!< Index of the time step
+  int i_picard;   //!< Index of the Picard iteration within the time step
+};
+
+//! Find where a run resumes after a checkpointed Picard iteration.  A time step
+//! ends once it converged or ran its last Picard iteration, and the run resumes at
+//! the start of the next one.
+//!
+//! \param i_timestep Time step of the checkpoint
+//! \param i_picard Picard iteration of the checkpoint
+//! \param converged Whether the checkpointed iteration converged
+//! \param max_picard_iter Maximum number of Picard iterations per time step
+//! \return Time step and Picard iteration of the first iteration to run
+ResumePoint
+resume_point(int i_timestep, int i_picard, bool converged, int max_picard_iter);
+
+//! Work done by a Picard iteration
+struct PicardStep {
+  bool jacobi;            //!< Whether both solvers run at the same time
+  bool solve_heat;        //!< Whether the heat/fluids solver runs
+  bool check_convergence; //!< Whether the temperature iterates are compared
+};
+
+//! Plan a Picard iteration.  With the Jacobi scheme, the heat/fluids solver runs with
+//! the heat source of the previous iteration.  After a Gauss-Seidel iteration, it
+//! already ran with that heat source, and its solve would only reproduce the previous
+//! temperature and density.  That solve is skipped, and so is the convergence check,
+//! whose iterates would be the same.
+//!
+//! \param jacobi_scheme Whether the Jacobi coupling scheme is used
+//! \param gauss_seidel Whether the iteration must be Gauss-Seidel, as when the
+//! heat/fluids solver has not been given a heat source yet
+//! \param heat_source_solved Whether the heat/fluids solver already ran with its
+//! current heat source
+//! \return Work done by the iteration
+PicardStep picard_step(bool jacobi_scheme, bool gauss_seidel, bool heat_source_solved);
+
 } // namespace enrico
 
 #endif // ENRICO_COUPLED_DRIVER_H
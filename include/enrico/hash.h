@@ -0,0 +1,35 @@
+//! \file hash.h
+//! Hashing of raw bytes, used to key cached data
+#ifndef ENRICO_HASH_H
+#define ENRICO_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace enrico {
+
+//! Seed for hash_bytes
+constexpr std::uint64_t HASH_SEED{14695981039346656037ULL};
+
+//! Hash a contiguous range of bytes with the 64-bit FNV-1a function.
+//!
+//! The result does not depend on the platform's std::hash, so it can be stored in
+//! files and compared in later runs.
+//!
+//! \param data Start of the bytes to hash
+//! \param n Number of bytes
+//! \param h Hash to continue from, which allows hashing several ranges in turn
+//! \return The hash
+inline std::uint64_t hash_bytes(const void* data, std::size_t n, std::uint64_t h = HASH_SEED)
+{
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < n; ++i) {
+    h ^= bytes[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+} // namespace enrico
+
+#endif // ENRICO_HASH_H
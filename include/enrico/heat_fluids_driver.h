@@ -6,10 +6,14 @@
 #include "enrico/driver.h"
 #include "enrico/geom.h"
 #include "enrico/mpi_types.h"
+#include "enrico/property_table.h"
 #include "pugixml.hpp"
 #include "xtensor/xtensor.hpp"
+#include <gsl/gsl-lite.hpp>
 
 #include <cstddef> // for size_t
+#include <memory>  // for shared_ptr
+#include <vector>
 
 namespace enrico {
 
@@ -27,6 +31,12 @@ public:
 
   virtual int set_heat_source_at(int32_t local_elem, double heat) = 0;
 
+  //! Set the heat sources of all local elements in one call.  The default calls
+  //! set_heat_source_at for each element.
+  //!
+  //! \param heat Heat source for each local element
+  virtual void set_heat_sources(gsl::span<const double> heat);
+
   //! Return true if a local element is in the fluid region
   //! \param local_elem  A local element ID
   //! \return 1 if the local element is in fluid; 0 otherwise
@@ -42,25 +52,74 @@ public:
 
   double pressure_bc_; //! System pressure in [MPa]
 
+  //! Relative tolerance of the tabulated water properties; 0 if the exact IAPWS
+  //! correlations are used
+  double property_table_tol_ = 0.0;
+
+  // The field accessors come in two forms. The ones taking a span fill a buffer of
+  // n_local_elem() values provided by the caller and are implemented by each solver;
+  // the ones returning a vector allocate it and call them.
+
   //! Get temperature of local mesh elements
   //! \return Temperature of local mesh elements in [K]
-  virtual std::vector<double> temperature() const = 0;
+  std::vector<double> temperature() const;
+
+  //! Get temperature of local mesh elements
+  //! \param T Temperature of local mesh elements in [K]
+  virtual void temperature(gsl::span<double> T) const = 0;
 
   //! Get density of local mesh elements
   //! \return Density of local mesh elements in [g/cm^3]
-  virtual std::vector<double> density() const = 0;
+  std::vector<double> density() const;
+
+  //! Get density of local mesh elements
+  //! \param rho Density of local mesh elements in [g/cm^3]
+  virtual void density(gsl::span<double> rho) const = 0;
+
+  //! Get temperature and density of local mesh elements together.  The default calls
+  //! temperature() and density(); solvers that find the density from the element
+  //! temperature override it to do both in one pass.
+  //! \param T Temperature of local mesh elements in [K]
+  //! \param rho Density of local mesh elements in [g/cm^3]
+  virtual void thermal_state(gsl::span<double> T, gsl::span<double> rho) const;
 
   //! States whether each local region is in fluid
   //! \return For each local region, 1 if region is in fluid and 0 otherwise
-  virtual std::vector<int> fluid_mask() const = 0;
+  std::vector<int> fluid_mask() const;
+
+  //! States whether each local region is in fluid
+  //! \param mask For each local region, 1 if region is in fluid and 0 otherwise
+  virtual void fluid_mask(gsl::span<int> mask) const = 0;
 
   //! Get centroids of local mesh elements
   //! \return Centroids of local mesh elements
-  virtual std::vector<Position> centroid() const = 0;
+  std::vector<Position> centroid() const;
+
+  //! Get centroids of local mesh elements
+  //! \param centroids Centroids of local mesh elements
+  virtual void centroid(gsl::span<Position> centroids) const = 0;
 
   //! Get volumes of local mesh elements
   //! \return Volumes of local mesh elements
-  virtual std::vector<double> volume() const = 0;
+  std::vector<double> volume() const;
+
+  //! Get volumes of local mesh elements
+  //! \param volumes Volumes of local mesh elements
+  virtual void volume(gsl::span<double> volumes) const = 0;
+
+protected:
+  //! Tabulate the specific volume of water at the system pressure, if property
+  //! tables are requested
+  void init_specific_volume_table();
+
+  //! Specific volume of water at the system pressure
+  //! \param T Temperature in [K]
+  //! \return Specific volume in [m^3/kg]
+  double specific_volume(double T) const;
+
+private:
+  //! Specific volume as a function of pressure [MPa] and temperature [K]
+  std::shared_ptr<const PropertyTable> specific_volume_table_;
 };
 
 } // namespace enrico
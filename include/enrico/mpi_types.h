@@ -13,12 +13,13 @@ namespace enrico {
 //==============================================================================
 
 extern MPI_Datatype position_mpi_datatype;
+extern MPI_Datatype thermal_state_mpi_datatype;
 
 //==============================================================================
 // Functions
 //==============================================================================
 
-//! Create MPI datatype for Position struct
+//! Create MPI datatypes for Position and ThermalState structs
 void init_mpi_datatypes();
 
 //! Free any MPI datatypes
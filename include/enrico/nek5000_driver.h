@@ -91,6 +91,10 @@ public:
   //! \return Error code
   int set_heat_source_at(int32_t local_elem, double heat) override;
 
+  //! Set the heat sources of all local elements
+  //! \param heat Heat source for each local element
+  void set_heat_sources(gsl::span<const double> heat) override;
+
   //! Get the number of local mesh elements
   //! \return Number of local mesh elements
   int n_local_elem() const override { return active() ? nelt_ : 0; }
@@ -108,24 +112,29 @@ public:
 
 private:
   //! Get temperature of local mesh elements
-  //! \return Temperature of local mesh elements in [K]
-  std::vector<double> temperature() const override;
+  //! \param T Temperature of local mesh elements in [K]
+  void temperature(gsl::span<double> T) const override;
 
   //! Get density of local mesh elements
-  //! \return Density of local mesh elements in [g/cm^3]
-  std::vector<double> density() const override;
+  //! \param rho Density of local mesh elements in [g/cm^3]
+  void density(gsl::span<double> rho) const override;
+
+  //! Get temperature and density of local mesh elements in one pass
+  //! \param T Temperature of local mesh elements in [K]
+  //! \param rho Density of local mesh elements in [g/cm^3]
+  void thermal_state(gsl::span<double> T, gsl::span<double> rho) const override;
 
   //! States whether each local region is in fluid
-  //! \return For each local region, 1 if region is in fluid and 0 otherwise
-  std::vector<int> fluid_mask() const override;
+  //! \param mask For each local region, 1 if region is in fluid and 0 otherwise
+  void fluid_mask(gsl::span<int> mask) const override;
 
   //! Get centroids of local mesh elements
-  //! \return Centroids of local mesh elements
-  std::vector<Position> centroid() const override;
+  //! \param centroids Centroids of local mesh elements
+  void centroid(gsl::span<Position> centroids) const override;
 
   //! Get volumes on local mesh elements
-  //! \return Volumes on local mesh elements
-  std::vector<double> volume() const override;
+  //! \param volumes Volumes on local mesh elements
+  void volume(gsl::span<double> volumes) const override;
 
   int32_t nelgt_; //!< total number of mesh elements
   int32_t nelt_;  //!< number of local mesh elements
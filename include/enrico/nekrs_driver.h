@@ -22,23 +22,41 @@ public:
 
   Position centroid_at(int32_t local_elem) const;
   double volume_at(int32_t local_elem) const;
-  double temperature_at(int32_t local_elem) const;
   int in_fluid_at(int32_t local_elem) const;
 
   bool has_coupling_data() const final { return comm_.rank == 0; }
 
+  //! Set the heat source of a local element, constant over its GLL points.  With a
+  //! device-resident heat source, the value is copied to the device with the other
+  //! staged ones before the next solve.
   int set_heat_source_at(int32_t local_elem, double heat) override;
 
+  //! Set the heat sources of all local elements, constant over each element's GLL
+  //! points
+  //! \param heat Heat source for each local element
+  void set_heat_sources(gsl::span<const double> heat) override;
+
 private:
-  std::vector<Position> centroid() const override;
-  std::vector<double> volume() const override;
-  std::vector<double> temperature() const override;
-  std::vector<double> density() const override;
-  std::vector<int> fluid_mask() const override;
+  void centroid(gsl::span<Position> c) const override;
+  void volume(gsl::span<double> v) const override;
+  void temperature(gsl::span<double> t) const override;
+  void density(gsl::span<double> rho) const override;
+  void thermal_state(gsl::span<double> T, gsl::span<double> rho) const override;
+  void fluid_mask(gsl::span<int> mask) const override;
+
+  //! Copy the element heat sources staged on the host to the device-resident heat
+  //! source, if any were staged
+  void flush_heat_sources();
 
   void open_lib_udf();
   void close_lib_udf();
 
+  //! Compare the element temperatures to those of the previous check, which they
+  //! then replace
+  //! \return Whether no element temperature changed by more than steady_state_tol_ on
+  //! any rank
+  bool temperature_is_steady();
+
   std::string setup_file_;
   std::string thread_model_;
   std::string device_number_;
@@ -54,14 +72,25 @@ private:
   const double* x_;
   const double* y_;
   const double* z_;
-  const double* temperature_;
   const int* element_info_;
-  std::vector<double> rho_cp_; 
   std::vector<double> mass_matrix_;
 
   //! Output heat source to separate .fld file
   bool output_heat_source_ = false;
 
+  //! Number of time steps between steady-state checks; 0 disables them
+  int steady_state_interval_ = 0;
+
+  //! Largest change in element temperature [K] between checks for a steady state
+  double steady_state_tol_ = 0.0;
+
+  //! Element temperatures at the latest steady-state check
+  std::vector<double> temperature_check_;
+
+  //! Element temperatures of the current steady-state check, kept between checks so
+  //! that they are not reallocated
+  std::vector<double> temperature_latest_;
+
   //! Handle to host when needed for occa::memory.
   occa::device host_;
 
@@ -71,6 +100,25 @@ private:
   // TODO: Get cache dir from env.  See udfLoadFunction in nekrs/udf/udf.cpp
   const std::string lib_udf_name_ = ".cache/udf/libUDF.so";
   std::vector<double>* localq_;
+
+  //! Heat source on the device, if the UDF defines one as o_localq; otherwise null
+  //! and localq_ is used
+  occa::memory* o_localq_ = nullptr;
+
+  //! Kernel for rho*cp-weighted element averages on the device
+  occa::kernel element_average_;
+
+  //! Kernel that writes one value per element to all of its GLL points on the device
+  occa::kernel element_broadcast_;
+
+  //! One value per local element on the device
+  occa::memory o_elem_;
+
+  //! One value per local element on the host, for the copies to and from o_elem_
+  mutable std::vector<dfloat> elem_host_;
+
+  //! Whether elem_host_ holds element heat sources not yet copied to o_localq_
+  bool heat_staged_ = false;
 };
 
 }
@@ -11,6 +11,7 @@
 #include <gsl/gsl-lite.hpp>
 #include <xtensor/xtensor.hpp>
 
+#include <cstdint>
 #include <vector>
 
 namespace enrico {
@@ -29,6 +30,25 @@ public:
   //! \return Heat source in each material as [W/cm3]
   virtual xt::xtensor<double, 1> heat_source(double power) const = 0;
 
+  //! Get the heat source of some cells normalized to a given power, on the root only.
+  //! Collective over the neutronics comm.
+  //! \param power User-specified power in [W]
+  //! \param indices Indices of cells in the cells_ ordered mapping (see cell_index())
+  //! (significant at root)
+  //! \param heat Heat source of each cell in [W/cm3] (significant at root)
+  virtual void get_heat_sources(double power,
+                                gsl::span<const gsl::index> indices,
+                                gsl::span<double> heat) const
+  {
+    auto all_heat = this->heat_source(power);
+    if (comm_.is_root()) {
+      Expects(indices.size() == heat.size());
+      for (gsl::index k = 0; k < indices.size(); ++k) {
+        heat[k] = all_heat(indices[k]);
+      }
+    }
+  }
+
   //! Get the k-effective of a run
   virtual UncertainDouble get_k_effective() const = 0;
 
@@ -42,9 +62,30 @@ public:
   virtual void set_boron_ppm(const std::vector<CellHandle>& fluid_cell_handles,
                              double ppm, double B10_iso_abund) const = 0;
 
+  //! Create the tallies used by boron_sensitivity()
+  //! \return Whether the driver can estimate the sensitivity
+  virtual bool create_boron_tallies() { return false; }
+
+  //! Estimate the sensitivity of k-effective to the boron concentration of the fluid
+  //! cells from the tallies of the last solve.  Collective over the neutronics comm.
+  //! \param ppm Boron concentration used in the last solve [ppm]
+  //! \param k_eff k-effective of the last solve
+  //! \return dk/dppm, or 0 if it can't be estimated
+  virtual double boron_sensitivity(double ppm, double k_eff) const { return 0.0; }
+
+  //! Inform the driver which cells contain fluid, so that it can prepare for repeated
+  //! calls to set_boron_ppm() on them
+  //! \param fluid_cell_handles The CellHandle objects that contain fluids
+  virtual void set_fluid_cells(const std::vector<CellHandle>& fluid_cell_handles) {}
+
   //! Find cells corresponding to a vector of positions
-  //! \param positions (x,y,z) coordinates to search for
-  //! \return Handles to cells
+  //!
+  //! This is collective over the neutronics comm.  The work may be divided among
+  //! the neutronics ranks, but the cells that are found are known to every rank
+  //! afterwards.
+  //!
+  //! \param positions (x,y,z) coordinates to search for (significant at root)
+  //! \return Handles to cells (significant at root)
   virtual std::vector<CellHandle> find(const std::vector<Position>& positions) = 0;
 
   //! Set the density of the material in a cell
@@ -67,6 +108,30 @@ public:
   //! \return Temperature in [K]
   virtual double get_temperature(CellHandle cell) const = 0;
 
+  //! Set the temperatures of several cells in one call
+  //! \param indices Indices of cells in the cells_ ordered mapping (see cell_index())
+  //! \param T Temperature of each cell in [K]
+  virtual void set_temperatures(gsl::span<const gsl::index> indices,
+                                gsl::span<const double> T) const = 0;
+
+  //! Set the densities of the materials in several cells in one call
+  //! \param indices Indices of cells in the cells_ ordered mapping (see cell_index())
+  //! \param rho Density of each cell in [g/cm^3]
+  virtual void set_densities(gsl::span<const gsl::index> indices,
+                             gsl::span<const double> rho) const = 0;
+
+  //! Get the temperatures of several cells in one call
+  //! \param indices Indices of cells in the cells_ ordered mapping (see cell_index())
+  //! \param T Temperature of each cell in [K]
+  virtual void get_temperatures(gsl::span<const gsl::index> indices,
+                                gsl::span<double> T) const = 0;
+
+  //! Get the densities of the materials in several cells in one call
+  //! \param indices Indices of cells in the cells_ ordered mapping (see cell_index())
+  //! \param rho Density of each cell in [g/cm^3]
+  virtual void get_densities(gsl::span<const gsl::index> indices,
+                             gsl::span<double> rho) const = 0;
+
   //! Get the volume of a cell
   //! \param cell Handle to a cell
   //! \return Volume in [cm^3]
@@ -97,6 +162,42 @@ public:
   //! \param cell An existing cell handle
   //! \return The index of the handle in the cells_ ordered mapping
   virtual gsl::index cell_index(CellHandle cell) const = 0;
+
+  //! Get a hash of the geometry model, used to detect whether a cached mapping of
+  //! positions to cells is still valid
+  //! \return Hash of the geometry, or 0 if it can't be determined
+  virtual std::uint64_t geometry_hash() const { return 0; }
+
+  //! Get the number of particles per batch used in a solve
+  //! \return Number of particles, or 0 if the driver can't change it
+  virtual std::int64_t get_particles() const { return 0; }
+
+  //! Set the number of particles per batch used from the next init_step() on
+  //! \param n Number of particles
+  virtual void set_particles(std::int64_t n) {}
+
+  //! Get the size of a fission source site, used to checkpoint the fission source
+  //! \return Size of a site in bytes, or 0 if the driver can't save its source
+  virtual std::size_t source_site_size() const { return 0; }
+
+  //! Get the fission source sites of this rank from the last solve
+  //! \return Sites packed as source_site_size() bytes each
+  virtual std::vector<char> get_source_sites() const { return {}; }
+
+  //! Set the fission source sites the next solve starts from
+  //! \param sites Sites packed as source_site_size() bytes each
+  virtual void set_source_sites(const std::vector<char>& sites) {}
+
+  //! Whether init_step() depends on the cell temperatures and densities.  If not,
+  //! the transfer of temperature and density can be completed after init_step().
+  //! \return Whether temperatures and densities must be set before init_step()
+  virtual bool init_step_needs_state() const { return true; }
+
+  //! Write output for a Picard iteration once it is known to have converged, after
+  //! its finalize_step()
+  //! \param timestep timestep index
+  //! \param iteration iteration index
+  virtual void write_converged_step(int timestep, int iteration) {}
 };
 
 } // namespace enrico
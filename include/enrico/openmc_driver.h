@@ -8,11 +8,15 @@
 #include "enrico/neutronics_driver.h"
 
 #include "openmc/cell.h"
+#include "openmc/particle.h"
 #include "openmc/tallies/filter_cell_instance.h"
 #include "openmc/tallies/tally.h"
 #include <gsl/gsl-lite.hpp>
 #include <mpi.h>
+#include <pugixml.hpp>
 
+#include <future>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -23,7 +27,8 @@ class OpenmcDriver : public NeutronicsDriver {
 public:
   //! One-time initalization of OpenMC and member variables
   //! \param comm An existing MPI communicator used to inialize OpenMC
-  explicit OpenmcDriver(MPI_Comm comm);
+  //! \param node XML node containing settings for the neutronics driver
+  explicit OpenmcDriver(MPI_Comm comm, pugi::xml_node node = {});
 
   //! One-time finalization of OpenMC
   ~OpenmcDriver();
@@ -31,6 +36,10 @@ public:
   //////////////////////////////////////////////////////////////////////////////
   // NeutronicsDriver interface
 
+  //! Cache the non-boron nuclides of each distinct material in the fluid cells
+  //! \param fluid_cell_handles The CellHandle objects that contain fluids
+  void set_fluid_cells(const std::vector<CellHandle>& fluid_cell_handles) override;
+
   //! Find cells corresponding to a vector of positions
   //! \param positions (x,y,z) coordinates to search for
   //! \return Handles to cells
@@ -49,6 +58,14 @@ public:
   void set_boron_ppm(const std::vector<CellHandle>& fluid_cell_handles,
                      double ppm, double B10_iso_abund) const override;
 
+  //! Create a tally of the B10 absorption rate in the fluid materials and of the
+  //! total nu-fission rate
+  //! \return False if B10 is not in the model
+  bool create_boron_tallies() override;
+
+  //! Estimate dk/dppm by first-order perturbation, with the flux of the last solve
+  double boron_sensitivity(double ppm, double k_eff) const override;
+
   //! Set the density of the material in a cell
   //! \param cell Handle to a cell
   //! \param rho Density in [g/cm^3]
@@ -69,6 +86,18 @@ public:
   //! \return Temperature in [K]
   double get_temperature(CellHandle cell) const override;
 
+  void set_temperatures(gsl::span<const gsl::index> indices,
+                        gsl::span<const double> T) const override;
+
+  void set_densities(gsl::span<const gsl::index> indices,
+                     gsl::span<const double> rho) const override;
+
+  void get_temperatures(gsl::span<const gsl::index> indices,
+                        gsl::span<double> T) const override;
+
+  void get_densities(gsl::span<const gsl::index> indices,
+                     gsl::span<double> rho) const override;
+
   //! Get the volume of a cell
   //! \param cell Handle to a cell
   //! \return Volume in [cm^3]
@@ -88,10 +117,35 @@ public:
   //! \return Number of cells
   xt::xtensor<double, 1> heat_source(double power) const final;
 
+  //! The tally results are only complete on the root, so only the root computes the
+  //! heat source of the requested cells; the other ranks return at once
+  void get_heat_sources(double power,
+                        gsl::span<const gsl::index> indices,
+                        gsl::span<double> heat) const final;
+
   std::string cell_label(CellHandle cell) const;
 
   gsl::index cell_index(CellHandle cell) const override;
 
+  std::int64_t get_particles() const override;
+
+  void set_particles(std::int64_t n) override;
+
+  std::size_t source_site_size() const override { return sizeof(openmc::SourceSite); }
+
+  std::vector<char> get_source_sites() const override;
+
+  //! The sites are used by the next init_step() as a warm-started source, even if
+  //! <warm_source> is not set
+  void set_source_sites(const std::vector<char>& sites) override;
+
+  //! Hash the geometry input file
+  std::uint64_t geometry_hash() const override;
+
+  //! Temperatures and densities are not consumed by openmc_simulation_init(), so
+  //! they can be set after init_step()
+  bool init_step_needs_state() const override { return false; }
+
   //////////////////////////////////////////////////////////////////////////////
   // Driver interface
 
@@ -101,11 +155,20 @@ public:
   //! Runs OpenMC for one Picard iteration
   void solve_step() final;
 
-  //! Writes OpenMC output for given timestep and iteration
+  //! Writes OpenMC output for given timestep and iteration, depending on the
+  //! <output_iterations> and <output_interval> settings.  With <output_async>, the
+  //! output of a Picard iteration is written in the background once finalize_step()
+  //! has run.
   //! \param timestep timestep index
-  //! \param iteration iteration index
+  //! \param iteration iteration index, negative for the output after the last one
   void write_step(int timestep, int iteration) final;
 
+  //! Writes OpenMC output for a converged Picard iteration with <output_iterations>
+  //! set to "converged"
+  //! \param timestep timestep index
+  //! \param iteration iteration index
+  void write_converged_step(int timestep, int iteration) override;
+
   //! Finalization required in each Picard iteration
   void finalize_step() final;
 
@@ -116,10 +179,67 @@ private:
   // Data members
   openmc::Tally* tally_;               //!< Fission energy deposition tally
   openmc::CellInstanceFilter* filter_; //!< Cell instance filter
+  openmc::Tally* boron_tally_{nullptr}; //!< B10 absorption tally in fluid materials
+  openmc::Tally* production_tally_{nullptr}; //!< Total nu-fission tally
   std::vector<CellInstance> cells_;    //!< Array of cell instances
   std::unordered_map<CellHandle, gsl::index>
     cell_index_;            //!< Map handles to index in cells_
   int n_fissionable_cells_; //!< Number of fissionable cells in model
+
+  //! Whether the fission source of each Picard iteration starts from the source of
+  //! the previous one
+  bool warm_source_{false};
+
+  //! Number of inactive batches when the fission source is warm-started
+  int32_t warm_source_inactive_{1};
+
+  int32_t n_inactive_; //!< Number of inactive batches from the OpenMC settings
+  int32_t n_batches_;  //!< Number of batches from the OpenMC settings
+
+  //! Write the statepoint and properties files with the given suffix, in the
+  //! background with <output_async>
+  void write_files(const std::string& suffix);
+
+  //! Wait for the background write, if any, and rethrow its error.  OpenMC's state is
+  //! the snapshot that a background write reads, so this is called before anything
+  //! changes it.
+  void wait_for_output() const;
+
+  //! Picard iterations that write output: "all", "converged", "final" or "none"
+  std::string output_iterations_{"all"};
+
+  //! Number of Picard iterations between outputs with "all"
+  int output_interval_{1};
+
+  //! Number of write_step() calls for Picard iterations so far
+  int n_output_calls_{0};
+
+  //! Whether the statepoint and properties files are written by a background thread
+  bool output_async_{false};
+
+  //! Suffix of the files of the latest solve, written in the background by
+  //! finalize_step(), or empty
+  std::string pending_suffix_;
+
+  //! Background write of the latest statepoint and properties files
+  mutable std::future<void> output_;
+
+  //! Duplicate of the neutronics communicator for OpenMC with <output_async>, so that
+  //! a background write never makes MPI calls on a communicator of the coupling
+  MPI_Comm openmc_comm_{MPI_COMM_NULL};
+
+  //! Fission source sites of this rank at the end of the previous Picard iteration
+  std::vector<openmc::SourceSite> source_sites_;
+
+  //! Whether source_sites_ were set by set_source_sites() and not used yet
+  bool source_restored_{false};
+
+  //! Distinct materials in the fluid cells, as indices in the global materials array
+  std::vector<int32_t> fluid_materials_;
+
+  //! Nuclides of each material in fluid_materials_ for a boron update: the non-boron
+  //! nuclides, which come first in the material, followed by B10 and B11
+  std::vector<std::vector<std::string>> fluid_material_nuclides_;
 };
 
 } // namespace enrico
@@ -0,0 +1,108 @@
+//! \file property_table.h
+//! Tabulated fluid properties with a fallback to the exact correlations
+#ifndef ENRICO_PROPERTY_TABLE_H
+#define ENRICO_PROPERTY_TABLE_H
+
+#include <cmath>
+#include <cstddef> // for size_t
+#include <vector>
+
+namespace enrico {
+
+//! A property of two variables, f(x, y), tabulated on a uniform grid and evaluated by
+//! bilinear interpolation.
+//!
+//! The table is built for a box [x_min, x_max] x [y_min, y_max] and refined until the
+//! relative interpolation error, measured at the cell centers and edge midpoints, is
+//! below a tolerance.  Points outside the box are evaluated with the exact function,
+//! so the table never extrapolates.  A degenerate range (x_min == x_max) tabulates
+//! f(x_min, y) as a function of y alone; any other x then uses the exact function.
+class PropertyTable {
+public:
+  //! Signature of the exact property function, such as iapws::T_from_p_h
+  using Function = double (*)(double, double);
+
+  //! Tabulate a property to within a relative tolerance
+  //!
+  //! \param f Exact property function
+  //! \param x_min Lower bound of the first variable
+  //! \param x_max Upper bound of the first variable
+  //! \param y_min Lower bound of the second variable
+  //! \param y_max Upper bound of the second variable
+  //! \param tol Relative tolerance on the interpolation error
+  //! \throw std::runtime_error if the tolerance is not met by the largest table
+  PropertyTable(Function f,
+                double x_min,
+                double x_max,
+                double y_min,
+                double y_max,
+                double tol);
+
+  //! Evaluate the property at one point
+  double operator()(double x, double y) const
+  {
+    if (!(x >= x_min_ && x <= x_max_ && y >= y_min_ && y <= y_max_)) {
+      return f_(x, y);
+    }
+    return this->interpolate(x, y);
+  }
+
+  //! Evaluate the property at many points
+  //!
+  //! The points inside the table are interpolated in a loop without branches that
+  //! can be vectorized; the others are then evaluated with the exact function.
+  //!
+  //! \param n Number of points
+  //! \param x Values of the first variable
+  //! \param y Values of the second variable
+  //! \param out Property values
+  void evaluate(std::size_t n, const double* x, const double* y, double* out) const;
+
+  //! Largest relative interpolation error found while building the table
+  double max_error() const { return max_error_; }
+
+  //! Number of tabulated points in each variable
+  std::size_t n_x() const { return n_x_; }
+  std::size_t n_y() const { return n_y_; }
+
+private:
+  //! Fill the table and return the largest relative error at the test points
+  double build();
+
+  //! Bilinear interpolation; the point must be inside the table
+  double interpolate(double x, double y) const
+  {
+    // Clamping the cell index keeps the upper bounds in the last cell
+    double s = (x - x_min_) * inv_dx_;
+    double t = (y - y_min_) * inv_dy_;
+    std::size_t i = static_cast<std::size_t>(s);
+    std::size_t j = static_cast<std::size_t>(t);
+    i = i < i_max_ ? i : i_max_;
+    j = j < n_y_ - 2 ? j : n_y_ - 2;
+    double wx = s - i;
+    double wy = t - j;
+
+    const double* v = values_.data() + i * n_y_ + j;
+    double lo = v[0] + wy * (v[1] - v[0]);
+    double hi = v[stride_x_] + wy * (v[stride_x_ + 1] - v[stride_x_]);
+    return lo + wx * (hi - lo);
+  }
+
+  Function f_;       //!< Exact property function
+  double x_min_;     //!< Lower bound of the first variable
+  double x_max_;     //!< Upper bound of the first variable
+  double y_min_;     //!< Lower bound of the second variable
+  double y_max_;     //!< Upper bound of the second variable
+  std::size_t n_x_;  //!< Number of points in the first variable
+  std::size_t n_y_;  //!< Number of points in the second variable
+  std::size_t i_max_;     //!< Largest cell index in the first variable
+  std::size_t stride_x_;  //!< Offset between rows in x; 0 for a degenerate range
+  double inv_dx_;    //!< Inverse of the grid spacing in x; 0 for a degenerate range
+  double inv_dy_;    //!< Inverse of the grid spacing in y
+  double max_error_; //!< Largest relative error at the test points
+  std::vector<double> values_; //!< Tabulated values, y varying fastest
+};
+
+} // namespace enrico
+
+#endif // ENRICO_PROPERTY_TABLE_H
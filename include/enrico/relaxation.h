@@ -0,0 +1,208 @@
+//! \file relaxation.h
+//! Relaxation and acceleration of the fields exchanged in Picard iterations
+#ifndef ENRICO_RELAXATION_H
+#define ENRICO_RELAXATION_H
+
+#include "enrico/comm.h"
+
+#include <pugixml.hpp>
+#include <xtensor/xtensor.hpp>
+
+#include <deque>
+#include <memory> // for unique_ptr
+#include <string>
+
+namespace enrico {
+
+//! Base class for relaxing a field between Picard iterations.
+//!
+//! The field is distributed over the ranks of a communicator (the heat/fluids ranks),
+//! and all of them must call relax() together.  A rank may hold no values of the
+//! field, so the collectives done by relax() depend only on results of collectives
+//! and on state that is the same on all ranks, never on the local size of the field.
+//! Let \f$x_i\f$ be the field at iteration \f$i\f$ and \f$\tilde{x}_{i+1}\f$ be the
+//! next estimate of the field from a single-physics solver.  The field for iteration
+//! \f$i+1\f$ is formed from these and possibly earlier iterates.
+class Relaxation {
+public:
+  //! Initializes the relaxation for a field distributed over a given communicator
+  //! \param comm The MPI communicator over which the field is distributed
+  explicit Relaxation(const Comm& comm)
+    : comm_(comm)
+  {}
+
+  virtual ~Relaxation() = default;
+
+  //! Relax the next estimate of a field in place
+  //!
+  //! \param x On input, next estimate \f$\tilde{x}_{i+1}\f$; on output, relaxed
+  //! field \f$x_{i+1}\f$
+  //! \param x_prev Field at the previous iteration, \f$x_i\f$
+  //! \param iteration Index of the Picard iteration within the timestep.  Any
+  //! history is discarded when it is 0.
+  void relax(xt::xtensor<double, 1>& x, const xt::xtensor<double, 1>& x_prev, int iteration);
+
+  //! L2 norm of the residual \f$\tilde{x}_{i+1} - x_i\f$ of the latest call to relax()
+  double residual() const { return residual_; }
+
+  //! Relaxation factor applied to the residual by the latest call to relax()
+  double factor() const { return factor_; }
+
+  //! Name of the relaxation method, for reports
+  virtual std::string name() const = 0;
+
+protected:
+  //! Compute the relaxed field from the residual
+  //!
+  //! \param x On input, next estimate; on output, relaxed field
+  //! \param x_prev Field at the previous iteration
+  //! \param r Residual, x - x_prev
+  //! \param iteration Index of the Picard iteration within the timestep
+  virtual void update(xt::xtensor<double, 1>& x,
+                      const xt::xtensor<double, 1>& x_prev,
+                      const xt::xtensor<double, 1>& r,
+                      int iteration) = 0;
+
+  //! Discard any history from earlier iterations
+  virtual void reset() {}
+
+  //! Dot product of two fields over all ranks of comm_
+  double dot(const xt::xtensor<double, 1>& a, const xt::xtensor<double, 1>& b) const;
+
+  //! Sum of a value over all ranks of comm_.  Collective over comm_.
+  //! \param local Value on the calling rank
+  //! \return Sum over all ranks
+  virtual double sum(double local) const;
+
+  //! Whether a condition holds on any rank of comm_.  Collective over comm_.
+  //! \param local Condition on the calling rank
+  //! \return Whether the condition holds on any rank
+  virtual bool any(bool local) const;
+
+  //! Whether a relaxed field has negative values where both the previous field and
+  //! the next estimate are non-negative.  Collective over comm_.
+  //! \param x_new Relaxed field
+  //! \param x_prev Field at the previous iteration
+  //! \param x Next estimate of the field
+  bool leaves_range(const xt::xtensor<double, 1>& x_new,
+                    const xt::xtensor<double, 1>& x_prev,
+                    const xt::xtensor<double, 1>& x) const;
+
+  Comm comm_;           //!< The MPI communicator over which the field is distributed
+  double residual_{0.}; //!< L2 norm of the latest residual
+  double factor_{1.};   //!< Latest relaxation factor
+};
+
+//! Underrelaxation with a constant factor:
+//! \f$x_{i+1} = (1 - \alpha) x_i + \alpha \tilde{x}_{i+1}\f$
+class ConstantRelaxation : public Relaxation {
+public:
+  //! \param comm The MPI communicator over which the field is distributed
+  //! \param alpha Relaxation factor in (0, 1]
+  ConstantRelaxation(const Comm& comm, double alpha);
+
+  std::string name() const override { return "constant"; }
+
+protected:
+  void update(xt::xtensor<double, 1>& x,
+              const xt::xtensor<double, 1>& x_prev,
+              const xt::xtensor<double, 1>& r,
+              int iteration) override;
+
+private:
+  double alpha_; //!< Relaxation factor
+};
+
+//! Robbins-Monro relaxation, which averages all iterates of a timestep:
+//! \f$x_{i+1} = \frac{i}{i+1} x_i + \frac{1}{i+1} \tilde{x}_{i+1}\f$
+class RobbinsMonroRelaxation : public Relaxation {
+public:
+  using Relaxation::Relaxation;
+
+  std::string name() const override { return "robbins-monro"; }
+
+protected:
+  void update(xt::xtensor<double, 1>& x,
+              const xt::xtensor<double, 1>& x_prev,
+              const xt::xtensor<double, 1>& r,
+              int iteration) override;
+};
+
+//! Aitken's dynamic relaxation, which updates the factor from consecutive residuals:
+//! \f$\omega_{i+1} = -\omega_i \frac{r_i \cdot (r_{i+1} - r_i)}{\lVert r_{i+1} -
+//! r_i \rVert^2}\f$.  The factor may exceed 1 (over-relaxation) as long as the
+//! field stays non-negative.
+class AitkenRelaxation : public Relaxation {
+public:
+  //! \param comm The MPI communicator over which the field is distributed
+  //! \param alpha Relaxation factor for the first iteration of a timestep
+  AitkenRelaxation(const Comm& comm, double alpha);
+
+  std::string name() const override { return "aitken"; }
+
+protected:
+  void update(xt::xtensor<double, 1>& x,
+              const xt::xtensor<double, 1>& x_prev,
+              const xt::xtensor<double, 1>& r,
+              int iteration) override;
+
+  void reset() override
+  {
+    r_prev_ = xt::xtensor<double, 1>{};
+    has_r_prev_ = false;
+  }
+
+private:
+  double alpha_;                   //!< Initial relaxation factor
+  double omega_;                   //!< Current relaxation factor
+  xt::xtensor<double, 1> r_prev_;  //!< Residual of the previous iteration
+  bool has_r_prev_{false};         //!< Whether r_prev_ is from this timestep
+};
+
+//! Anderson mixing, which combines up to a given number of previous iterates to
+//! minimize the linearized residual
+class AndersonRelaxation : public Relaxation {
+public:
+  //! \param comm The MPI communicator over which the field is distributed
+  //! \param alpha Mixing factor applied to the residual
+  //! \param depth Largest number of previous iterates that are combined
+  AndersonRelaxation(const Comm& comm, double alpha, int depth);
+
+  std::string name() const override { return "anderson"; }
+
+protected:
+  void update(xt::xtensor<double, 1>& x,
+              const xt::xtensor<double, 1>& x_prev,
+              const xt::xtensor<double, 1>& r,
+              int iteration) override;
+
+  void reset() override;
+
+private:
+  double alpha_; //!< Mixing factor
+  int depth_;    //!< Largest number of previous iterates that are combined
+
+  xt::xtensor<double, 1> x_last_; //!< Field of the previous iteration
+  xt::xtensor<double, 1> r_last_; //!< Residual of the previous iteration
+  bool has_last_{false};          //!< Whether x_last_ and r_last_ are from this timestep
+  std::deque<xt::xtensor<double, 1>> dx_; //!< Differences of consecutive fields
+  std::deque<xt::xtensor<double, 1>> dr_; //!< Differences of consecutive residuals
+};
+
+//! Create the relaxation given by an XML element such as <alpha>
+//!
+//! The element's value is either a number (constant relaxation), "robbins-monro",
+//! "aitken" or "anderson".
+//!
+//! \param node XML element describing the relaxation; if empty, no relaxation
+//! (a constant factor of 1) is used
+//! \param anderson_depth Number of previous iterates combined by Anderson mixing
+//! \param comm The MPI communicator over which the field is distributed
+//! \return The relaxation
+std::unique_ptr<Relaxation> make_relaxation(pugi::xml_node node,
+                                            int anderson_depth,
+                                            const Comm& comm);
+
+} // namespace enrico
+
+#endif // ENRICO_RELAXATION_H
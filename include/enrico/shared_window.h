@@ -0,0 +1,99 @@
+//! \file shared_window.h
+//! Arrays in memory shared by the ranks of a node
+#ifndef ENRICO_SHARED_WINDOW_H
+#define ENRICO_SHARED_WINDOW_H
+
+#include "enrico/comm.h"
+
+#include <mpi.h>
+
+#include <cstddef>
+#include <utility> // for swap
+
+namespace enrico {
+
+//! An array in memory shared by the ranks of a node, backed by an MPI-3 shared
+//! memory window
+//!
+//! The array is allocated by the root of the comm and every rank loads and stores
+//! to it in place.  Stores become visible to the other ranks after sync().
+template<typename T>
+class SharedWindow {
+public:
+  SharedWindow() = default;
+
+  //! Allocate a shared array.  Collective on comm.
+  //! \param comm Ranks sharing the array, which must all be on the same node (e.g.,
+  //! a subset of an MPI_COMM_TYPE_SHARED comm)
+  //! \param n Number of values
+  SharedWindow(const Comm& comm, std::size_t n)
+    : comm_(comm)
+    , size_(n)
+  {
+    MPI_Aint bytes = comm_.is_root() ? n * sizeof(T) : 0;
+    void* base;
+    MPI_Win_allocate_shared(bytes, sizeof(T), MPI_INFO_NULL, comm_.comm, &base, &win_);
+
+    // Every rank addresses the root's segment
+    MPI_Aint root_bytes;
+    int disp_unit;
+    MPI_Win_shared_query(win_, 0, &root_bytes, &disp_unit, &data_);
+
+    // A passive-target epoch lasts for the lifetime of the window, so that the
+    // array is accessed with plain loads and stores
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win_);
+  }
+
+  SharedWindow(const SharedWindow&) = delete;
+  SharedWindow& operator=(const SharedWindow&) = delete;
+
+  SharedWindow(SharedWindow&& other) { swap(other); }
+  SharedWindow& operator=(SharedWindow&& other)
+  {
+    SharedWindow tmp(std::move(other));
+    swap(tmp);
+    return *this;
+  }
+
+  //! Frees the window.  Collective on the comm it was allocated on.
+  ~SharedWindow()
+  {
+    if (win_ != MPI_WIN_NULL) {
+      MPI_Win_unlock_all(win_);
+      MPI_Win_free(&win_);
+    }
+  }
+
+  //! Make the stores of every rank visible to every rank.  Collective.
+  void sync() const
+  {
+    MPI_Win_sync(win_);
+    comm_.Barrier();
+    MPI_Win_sync(win_);
+  }
+
+  T* data() { return data_; }
+  const T* data() const { return data_; }
+  std::size_t size() const { return size_; }
+
+  T& operator[](std::size_t i) { return data_[i]; }
+  const T& operator[](std::size_t i) const { return data_[i]; }
+
+private:
+  void swap(SharedWindow& other)
+  {
+    std::swap(comm_, other.comm_);
+    std::swap(win_, other.win_);
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+  }
+
+  Comm comm_;                 //!< Ranks sharing the array
+  MPI_Win win_{MPI_WIN_NULL}; //!< The shared memory window
+  T* data_{nullptr};          //!< Start of the array in this rank's address space
+  std::size_t size_{0};       //!< Number of values
+};
+
+} // namespace enrico
+
+#endif // ENRICO_SHARED_WINDOW_H
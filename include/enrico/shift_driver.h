@@ -74,6 +74,18 @@ public:
   //! \return Temperature in [K]
   double get_temperature(CellHandle handle) const override;
 
+  void set_temperatures(gsl::span<const gsl::index> indices,
+                        gsl::span<const double> T) const override;
+
+  void set_densities(gsl::span<const gsl::index> indices,
+                     gsl::span<const double> rho) const override;
+
+  void get_temperatures(gsl::span<const gsl::index> indices,
+                        gsl::span<double> T) const override;
+
+  void get_densities(gsl::span<const gsl::index> indices,
+                     gsl::span<double> rho) const override;
+
   //! Get the volume of a cell
   //! \param handle Handle to a cell
   //! \return Volume in [cm^3]
@@ -111,6 +123,7 @@ private:
 
   std::vector<cell_type> cells_;                         //!< Shift cells
   std::unordered_map<cell_type, CellHandle> cell_index_; //!< Map cells to handles
+  std::vector<double> inv_volume_;                       //!< Inverse volume of cells_
   int num_cells_; //!< Total number of Shift cells (not size of cells_)
 };
 
@@ -5,6 +5,8 @@
 
 #include "enrico/geom.h"
 #include "enrico/heat_fluids_driver.h"
+#include "enrico/property_table.h"
+#include "iapws/iapws.h"
 
 #include <gsl/gsl-lite.hpp>
 #include <mpi.h>
@@ -12,9 +14,13 @@
 #include <xtensor/xtensor.hpp>
 
 #include <cstddef>
+#include <future>
+#include <memory> // for shared_ptr, unique_ptr
 
 namespace enrico {
 
+class SurrogateVtkWriter;
+
 //! Struct containing geometric information for a flow channel
 struct Channel {
   //! Channel index
@@ -154,10 +160,28 @@ public:
   //! Verbosity options for printing simulation results
   enum class verbose { NONE, LOW, HIGH };
 
+  //! Solve the conduction equation in each (pin, axial segment). After the first
+  //! solve, each one starts from the previous solid temperatures.
   void solve_heat();
 
   void solve_fluid();
 
+  //! Compare the heat source of each pin to the source of its latest solve and mark
+  //! what solve_fluid() and solve_heat() must solve again: the channels next to a pin
+  //! whose source changed by more than source_change_tol_, and every pin next to one
+  //! of those channels. Everything else keeps its previous solution.
+  void mark_changed_pins();
+
+  //! Returns whether a pin is solved again by the next solve_heat()
+  bool pin_solved(std::size_t pin) const { return pin_solve_[pin]; }
+
+  //! Returns number of nonlinear iterations of the latest conduction solve for a
+  //! given pin and axial segment
+  int heat_iterations(std::size_t pin, std::size_t axial) const
+  {
+    return heat_iterations_(pin, axial);
+  }
+
   //! Returns Number of rings in fuel and clad
   std::size_t n_rings() const { return n_fuel_rings_ + n_clad_rings_; }
 
@@ -193,6 +217,17 @@ public:
   //!< solid temperature in [K] for each (pin, axial segment, ring)
   xt::xtensor<double, 3> solid_temperature_;
 
+  //! Nonlinear iterations of the latest conduction solve for each (pin, axial segment)
+  xt::xtensor<int, 2> heat_iterations_;
+
+  //! Whether solid_temperature_ holds a previous solution to start from
+  bool has_solid_solution_ = false;
+
+  //! Largest relative change in the heat source of a pin, measured against the source
+  //! of its latest solve, for which the pin keeps its previous solution. The default
+  //! of zero solves every pin in every step.
+  double source_change_tol_ = 0.0;
+
   //! Fluid temperature in a rod-centered basis indexed by rod ID and axial ID
   xt::xtensor<double, 2> fluid_temperature_;
 
@@ -247,10 +282,48 @@ public:
   //! Cross-sectional areas of rings in fuel and cladding
   xt::xtensor<double, 1> solid_areas_;
 
+  //! Radii of each fuel and clad ring in [m], as expected by the conduction solver
+  xt::xtensor<double, 1> r_grid_fuel_m_;
+  xt::xtensor<double, 1> r_grid_clad_m_;
+
+  //! Ring-averaged heat source in [W/m^3] for each (pin, axial segment, ring)
+  xt::xtensor<double, 3> ring_source_;
+
+  //! Tabulated temperature [K] as a function of pressure [MPa] and enthalpy [kJ/kg];
+  //! if null, the exact IAPWS correlation is used
+  std::shared_ptr<const PropertyTable> T_table_;
+
+  //! Tabulated density [kg/m^3] as a function of pressure [MPa] and enthalpy [kJ/kg];
+  //! if null, the exact IAPWS correlation is used
+  std::shared_ptr<const PropertyTable> rho_table_;
+
 private:
   //! Create internal arrays used for heat equation solver
   void generate_arrays();
 
+  //! Fluid temperature [K] from pressure [MPa] and enthalpy [kJ/kg] at many states
+  //! \param n   number of states
+  //! \param p   pressures
+  //! \param h   enthalpies
+  //! \param T   temperatures
+  void T_from_p_h(std::size_t n, const double* p, const double* h, double* T) const;
+
+  //! Fluid density [kg/m^3] from pressure [MPa] and enthalpy [kJ/kg] at many states
+  //! \param n   number of states
+  //! \param p   pressures
+  //! \param h   enthalpies
+  //! \param rho densities
+  void rho_from_p_h(std::size_t n, const double* p, const double* h, double* rho) const;
+
+  //! March the enthalpy up and the pressure down a consecutive range of channels for
+  //! one subchannel iteration, with the channels in the inner loops
+  //! \param first index of the first channel
+  //! \param last  index one past the last channel
+  void march_channels(gsl::index first, gsl::index last);
+
+  //! Number of channels marched together by march_channels in one task
+  static constexpr gsl::index channel_block = 64;
+
   //! Rod power at a given node in a given pin, computed by integrating the heat source
   //! (assumed constant in each ring) over the pin.
   //! \param pin   pin index
@@ -317,6 +390,32 @@ private:
   //! Verbosity setting for printing simulation results; defaults to NONE
   verbose verbosity_ = verbose::NONE;
 
+  //! Flow area of each channel
+  xt::xtensor<double, 1> channel_areas_;
+
+  // Scratch arrays for the subchannel solver, allocated once per assembly. Face
+  // values are indexed by (axial face, channel) and cell values by (axial cell,
+  // channel), so that the channel index varies fastest.
+  xt::xtensor<double, 2> channel_powers_; //!< channel powers in [W]
+  xt::xtensor<double, 2> h_;              //!< face enthalpy in [kJ/kg]
+  xt::xtensor<double, 2> p_;              //!< face pressure in [MPa]
+  xt::xtensor<double, 2> u_;              //!< face velocity in [m/s]
+  xt::xtensor<double, 2> h_old_;          //!< face enthalpy of previous iteration
+  xt::xtensor<double, 2> p_old_;          //!< face pressure of previous iteration
+  xt::xtensor<double, 1> rho_high_;       //!< density at upper face of a cell
+  xt::xtensor<double, 1> rho_low_;        //!< density at lower face of a cell
+  xt::xtensor<double, 2> h_cell_;         //!< cell enthalpy in [kJ/kg]
+  xt::xtensor<double, 2> p_cell_;         //!< cell pressure in [MPa]
+  xt::xtensor<double, 2> T_cell_;         //!< cell temperature in [K]
+  xt::xtensor<double, 2> rho_cell_;       //!< cell density in [kg/m^3]
+
+  // Change tracking for incremental solves; the flags are stored as char rather than
+  // bool so that tasks can read them concurrently
+  xt::xtensor<double, 4> source_solved_; //!< heat source of the latest solve of a pin
+  std::vector<char> pin_solve_;          //!< whether each pin is solved again
+  std::vector<char> channel_solve_;      //!< whether each channel is solved again
+  std::vector<char> block_solve_;        //!< whether each channel block is solved again
+
 }; // end SurrogateHeatDriverAssembly
 
 /**
@@ -343,10 +442,14 @@ public:
   //! \param node  XML node containing settings for surrogate
   SurrogateHeatDriver(MPI_Comm comm, pugi::xml_node node);
 
+  //! Waits for visualization files that are still being written
+  ~SurrogateHeatDriver();
+
   //! Verbosity options for printing simulation results
   enum class verbose { NONE, LOW, HIGH };
 
-  bool has_coupling_data() const final { return comm_.rank == 0; }
+  //! Whether the calling rank owns any assemblies
+  bool has_coupling_data() const final { return !local_assemblies_.empty(); }
 
   //! Get the number of local mesh elements
   //! \return Number of local mesh elements
@@ -365,6 +468,12 @@ public:
   //! \return Error code
   int set_heat_source_at(int32_t local_elem, double heat) override;
 
+  //! Set the heat sources of all local elements. The solid elements of each owned
+  //! assembly are numbered in the same order as its source array, so each
+  //! assembly's sources are copied in one block; fluid elements have no source.
+  //! \param heat Heat source for each local element
+  void set_heat_sources(gsl::span<const double> heat) override;
+
   //! Solves the heat-fluids surrogate solver
   void solve_step() final;
 
@@ -441,6 +550,17 @@ public:
   std::size_t n_skip_;                  //! number of assemblies skipped
   std::vector<SurrogateHeatDriverAssembly> assembly_drivers_;
 
+  //! Indices in assembly_drivers_ of the assemblies owned by this rank, in the order
+  //! in which their local elements are numbered
+  std::vector<gsl::index> local_assemblies_;
+
+  //! VTK writer for each owned assembly, created at the first write; each one caches
+  //! the geometry of its assembly, which never changes
+  std::vector<std::unique_ptr<SurrogateVtkWriter>> vtk_writers_;
+
+  //! Visualization files of the latest write_step() being written in the background
+  std::future<void> viz_output_;
+
   //! Returns number of solid elements per assembly
   std::size_t n_solid_;
 
@@ -454,28 +574,29 @@ public:
     "none"};                    //!< visualization iterations to write (none, all, final)
   std::string viz_data_{"all"}; //!< visualization data to write
   std::string viz_regions_{"all"}; //!< visualization regions to write
+  std::string viz_format_{"vtk"};  //!< visualization file format (vtk, vtu)
   size_t vtk_radial_res_{20};      //!< radial resolution of resulting vtk files
 
 private:
   //! Get temperature of local mesh elements
-  //! \return Temperature of local mesh elements in [K]
-  std::vector<double> temperature() const override;
+  //! \param T Temperature of local mesh elements in [K]
+  void temperature(gsl::span<double> T) const override;
 
   //! Get density of local mesh elements
-  //! \return Density of local mesh elements in [g/cm^3]
-  std::vector<double> density() const override;
+  //! \param rho Density of local mesh elements in [g/cm^3]
+  void density(gsl::span<double> rho) const override;
 
   //! States whether each local region is in fluid
-  //! \return For each local region, 1 if region is in fluid and 0 otherwise
-  std::vector<int> fluid_mask() const override;
+  //! \param mask For each local region, 1 if region is in fluid and 0 otherwise
+  void fluid_mask(gsl::span<int> mask) const override;
 
   //! Get centroids of local mesh elements
-  //! \return Centroids of local mesh elements
-  std::vector<Position> centroid() const override;
+  //! \param centroids Centroids of local mesh elements
+  void centroid(gsl::span<Position> centroids) const override;
 
   //! Get volumes of local mesh elements
-  //! \return Volumes of local mesh elements
-  std::vector<double> volume() const override;
+  //! \param volumes Volumes of local mesh elements
+  void volume(gsl::span<double> volumes) const override;
 
   //! Channel index in terms of row, column index
   int channel_index(int row, int col) const { return row * (n_pins_x_ + 1) + col; }
@@ -0,0 +1,178 @@
+//! \file surrogate_neutronics_driver.h
+//! Lightweight neutronics driver with an analytic power shape and k-eff model
+#ifndef ENRICO_SURROGATE_NEUTRONICS_DRIVER_H
+#define ENRICO_SURROGATE_NEUTRONICS_DRIVER_H
+
+#include "enrico/geom.h"
+#include "enrico/neutronics_driver.h"
+
+#include <gsl/gsl-lite.hpp>
+#include <mpi.h>
+#include <pugixml.hpp>
+#include <xtensor/xtensor.hpp>
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace enrico {
+
+//! Neutronics driver that replaces particle transport by an analytic model, so that
+//! the Picard iterations can be run at scale in seconds.
+//!
+//! The geometry is the pin lattice of the surrogate heat-fluids driver, read from the
+//! <heat_fluids> node: each pin and axial segment is split into a fuel cell (inside
+//! the clad inner radius), a clad cell and a coolant cell (the rest of the pin cell).
+//! The power of a fuel cell follows a cosine or tabulated shape, scaled by a linear
+//! Doppler feedback on its temperature, and k-effective is a linear function of the
+//! average fuel temperature, the average coolant density and the boron concentration.
+class SurrogateNeutronicsDriver : public NeutronicsDriver {
+public:
+  //! Region of a pin cell
+  enum class Region { fuel, clad, coolant };
+
+  //! Read the model parameters and the pin lattice
+  //! \param comm MPI communicator of the neutronics ranks
+  //! \param node XML node containing settings for the neutronics driver
+  //! \param heat_node XML node of the surrogate heat-fluids driver
+  SurrogateNeutronicsDriver(MPI_Comm comm, pugi::xml_node node, pugi::xml_node heat_node);
+
+  //////////////////////////////////////////////////////////////////////////////
+  // NeutronicsDriver interface
+
+  //! Heat source of the fuel cells from the latest solve_step()
+  //! \param power User-specified power in [W]
+  //! \return Heat source in each cell in [W/cm^3]
+  xt::xtensor<double, 1> heat_source(double power) const final;
+
+  //! k-effective of the latest solve_step(), without uncertainty
+  UncertainDouble get_k_effective() const override { return {k_eff_, 0.0}; }
+
+  double get_boron_ppm(const std::vector<CellHandle>& fluid_cell_handles) const override
+  {
+    return ppm_;
+  }
+
+  void set_boron_ppm(const std::vector<CellHandle>& fluid_cell_handles,
+                     double ppm,
+                     double B10_iso_abund) const override
+  {
+    ppm_ = ppm;
+  }
+
+  //! The sensitivity is known without tallies
+  bool create_boron_tallies() override { return true; }
+
+  //! The sensitivity is the boron coefficient of the k-eff model
+  double boron_sensitivity(double ppm, double k_eff) const override
+  {
+    return boron_coefficient_;
+  }
+
+  //! Find the cells of positions in the pin lattice.  The root locates every
+  //! position and broadcasts only the handles of the new cells, which every rank
+  //! registers in the same order.
+  //! \param positions (x,y,z) coordinates to search for (significant at root)
+  //! \return Handles to cells
+  //! \throw std::runtime_error if a position is outside of the lattice
+  std::vector<CellHandle> find(const std::vector<Position>& positions) override;
+
+  void set_density(CellHandle cell, double rho) const override;
+
+  void set_temperature(CellHandle cell, double T) const override;
+
+  double get_density(CellHandle cell) const override;
+
+  double get_temperature(CellHandle cell) const override;
+
+  void set_temperatures(gsl::span<const gsl::index> indices,
+                        gsl::span<const double> T) const override;
+
+  void set_densities(gsl::span<const gsl::index> indices,
+                     gsl::span<const double> rho) const override;
+
+  void get_temperatures(gsl::span<const gsl::index> indices,
+                        gsl::span<double> T) const override;
+
+  void get_densities(gsl::span<const gsl::index> indices,
+                     gsl::span<double> rho) const override;
+
+  double get_volume(CellHandle cell) const override;
+
+  //! Only the fuel cells are fissionable
+  bool is_fissionable(CellHandle cell) const override;
+
+  std::size_t n_cells() const override { return cells_.size(); }
+
+  //! There are no tallies; the heat source is computed by solve_step()
+  void create_tallies() override {}
+
+  std::string cell_label(CellHandle cell) const override;
+
+  gsl::index cell_index(CellHandle cell) const override;
+
+  //! The state is only used by solve_step()
+  bool init_step_needs_state() const override { return false; }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Driver interface
+
+  //! Evaluate the power shape and k-effective with the current temperatures,
+  //! densities and boron concentration
+  void solve_step() final;
+
+private:
+  //! A cell found in the lattice
+  struct Cell {
+    CellHandle handle; //!< Handle of the cell
+    Region region;     //!< Region of the pin cell
+    Position center;   //!< Center of the pin at the middle of the axial segment
+    double volume;     //!< Volume in [cm^3]
+  };
+
+  //! Handle of the cell that contains a position
+  CellHandle locate(const Position& r) const;
+
+  //! Build the cell with a given handle
+  Cell make_cell(CellHandle handle) const;
+
+  //! Relative power shape at the center of a fuel cell, before feedback
+  double shape(const Cell& cell) const;
+
+  // Pin lattice, as in SurrogateHeatDriver
+  double clad_inner_radius_; //!< Clad inner radius in [cm]
+  double clad_outer_radius_; //!< Clad outer radius in [cm]
+  double pin_pitch_;         //!< Pin pitch in [cm]
+  std::size_t n_pins_x_;     //!< Number of pins along x in each assembly
+  std::size_t n_pins_y_;     //!< Number of pins along y in each assembly
+  std::size_t n_assem_x_;    //!< Number of assemblies along x
+  std::size_t n_assem_y_;    //!< Number of assemblies along y
+  double assembly_width_x_;  //!< Width of an assembly along x in [cm]
+  double assembly_width_y_;  //!< Width of an assembly along y in [cm]
+  xt::xtensor<double, 1> z_; //!< Bounds of the axial segments in [cm]
+  double inlet_temperature_; //!< Initial coolant temperature in [K]
+
+  // Model parameters
+  std::string power_shape_{"cosine"};   //!< Power shape, "cosine" or "flat"
+  std::vector<double> axial_power_;     //!< Relative power of each axial segment, if set
+  double k_ref_{1.0};                   //!< k-effective at the reference state
+  double doppler_coefficient_{-2.0e-5}; //!< dk/dT of the fuel in [1/K]
+  double density_coefficient_{0.3};     //!< dk/drho of the coolant in [cm^3/g]
+  double boron_coefficient_{-1.0e-4};   //!< dk/dppm in [1/ppm]
+  double reference_temperature_{900.0}; //!< Reference fuel temperature in [K]
+  double reference_density_{0.7};       //!< Reference coolant density in [g/cm^3]
+
+  // State
+  std::vector<Cell> cells_; //!< Cells found so far
+  std::unordered_map<CellHandle, gsl::index> cell_index_; //!< Index of handles in cells_
+  mutable std::vector<double> temperature_; //!< Temperature of each cell in [K]
+  mutable std::vector<double> density_;     //!< Density of each cell in [g/cm^3]
+  mutable double ppm_{0.0};                 //!< Boron concentration in [ppm]
+  std::vector<double> power_;               //!< Relative power density of each cell
+  double k_eff_{1.0};                       //!< k-effective of the latest solve
+};
+
+} // namespace enrico
+
+#endif // ENRICO_SURROGATE_NEUTRONICS_DRIVER_H
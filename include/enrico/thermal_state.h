@@ -0,0 +1,16 @@
+//! \file thermal_state.h
+//! Thermal-fluids state exchanged between the coupled physics drivers
+#ifndef ENRICO_THERMAL_STATE_H
+#define ENRICO_THERMAL_STATE_H
+
+namespace enrico {
+
+//! Describes the cell-averaged thermal-fluids state of a neutronics cell
+struct ThermalState {
+  double temperature; //!< Temperature in [K]
+  double density;     //!< Density in [g/cm^3]; only meaningful for fluid cells
+};
+
+} // namespace enrico
+
+#endif // ENRICO_THERMAL_STATE_H
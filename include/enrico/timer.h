@@ -4,12 +4,24 @@
 #include "comm.h"
 #include <iomanip>
 #include <string>
+#include <vector>
 
 namespace enrico {
 
 //! Class for measuring and collecting time on a given MPI communicator
 class Timer {
 public:
+  //! Times of one interval between start() and stop()
+  //!
+  //! Both start() and stop() wait for all ranks of the communicator, so the start
+  //! and stop times are the same on all ranks. The time at which the calling rank
+  //! reached stop() shows how long it was busy before waiting on the others.
+  struct Sample {
+    double start; //!< Time when start() returned
+    double busy;  //!< Time when the calling rank reached stop()
+    double stop;  //!< Time when stop() returned
+  };
+
   //! Initializes timer for a given MPI communicator
   //! \param comm The MPI communicator for which time is measured
   explicit Timer(const Comm& comm)
@@ -38,14 +50,31 @@ public:
   //! \return Elapsed time in seconds.
   double elapsed();
 
-  //! Reset the elapsed time to 0.
+  //! Reset the elapsed time to 0 and discard the samples.
   void reset();
 
+  //! Intervals between all consecutive calls to start() and stop(), if samples are
+  //! recorded
+  const std::vector<Sample>& samples() const { return samples_; }
+
+  //! Time the calling rank was busy in the intervals, without the time it waited on
+  //! the other ranks in stop()
+  //! \return Busy time in seconds.
+  double busy() const { return busy_; }
+
+  //! Turn the recording of samples by all timers on or off.  Samples are not
+  //! recorded unless turned on, since they grow with the number of intervals.
+  static void record_samples(bool record) { record_samples_ = record; }
+
 private:
   const Comm comm_;      //!< MPI comm for which this instance measures time
   double start_ = 0.0;   //!< Start time at most recent call to start()
   double elapsed_ = 0.0; //!< Time accumulated between all consecutive start/stops
+  double busy_ = 0.0;    //!< Busy time accumulated between all consecutive start/stops
   bool running_ = false; //!< True if started; false if stopped
+  std::vector<Sample> samples_; //!< Intervals between start/stops
+
+  static bool record_samples_; //!< Whether stop() records a sample
 };
 
 //! Class for storing times associated with an arbitrary label
@@ -1,6 +1,9 @@
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <utility> // for pair
+#include <vector>
 
 #include "enrico/surrogate_heat_driver.h"
 
@@ -24,10 +27,40 @@ public:
   //! (the fuel and cladding), fluid, and all of the above.
   enum class VizRegionType { solid = 1, fluid = 2, all = 3 };
 
+  //! Name and values, one for each element, of each field written
+  using Fields = std::vector<std::pair<std::string, std::vector<double>>>;
+
 public:
   //! Write the surrogate model to VTK
   void write(std::string filename = "magnolia.vtk");
 
+  //! Write the surrogate model to VTK with previously gathered cell data. Only the
+  //! cached geometry is used, so this may run concurrently with the solver.
+  //! \param filename Name of the .vtk file
+  //! \param fields   Cell data returned by cell_fields()
+  void write(const std::string& filename, const Fields& fields) const;
+
+  //! Write the surrogate model to an XML VTK unstructured grid file with the arrays
+  //! stored as raw binary appended data
+  //! \param filename Name of the .vtu file
+  void write_vtu(const std::string& filename);
+
+  //! Write the surrogate model to a .vtu file with previously gathered cell data
+  //! \param filename Name of the .vtu file
+  //! \param fields   Cell data returned by cell_fields()
+  void write_vtu(const std::string& filename, const Fields& fields) const;
+
+  //! Return the requested cell data of the current solution
+  //! \return Name and values, one for each element, of each requested field
+  Fields cell_fields() const;
+
+  //! Write a parallel VTK index that ties together .vtu files written for other
+  //! assemblies with the same settings as this writer
+  //! \param filename Name of the .pvtu file
+  //! \param pieces   Names of the .vtu files, relative to the .pvtu file
+  void write_pvtu(const std::string& filename,
+                  const std::vector<std::string>& pieces) const;
+
 private:
   //! Initializes the surrogate to VTK writer with a surrogate model.
   //! Can only be called within the SurrogateHeatDriver.
@@ -59,19 +92,32 @@ private:
   void set_number_of_entries();
 
   //! Write a vtk header for an unstructured grid
-  void write_header(ofstream& vtk_file);
+  void write_header(ofstream& vtk_file) const;
 
   //! Write points to the vtk file
-  void write_points(ofstream& vtk_file);
+  void write_points(ofstream& vtk_file) const;
 
   //! Write the wedge/hex element connectivity to the vtk file
-  void write_element_connectivity(ofstream& vtk_file);
+  void write_element_connectivity(ofstream& vtk_file) const;
 
   //! Write the wedge/hex element types to the vtk file
-  void write_element_types(ofstream& vtk_file);
+  void write_element_types(ofstream& vtk_file) const;
 
   //! Write requested data to the vtk file
-  void write_data(ofstream& vtk_file);
+  //! \param fields Cell data returned by cell_fields()
+  void write_data(ofstream& vtk_file, const Fields& fields) const;
+
+  //! Return the values of one field for each element (ordered as the elements)
+  //! \param field Field to return; any but source, temp, and density gives zeros
+  //! \return Value of the field in each element
+  std::vector<double> cell_field(VizDataType field) const;
+
+  //! Gather the connectivity of all pins, without the number of points that precedes
+  //! the points of each element in the legacy format
+  //! \param connectivity Points of each element
+  //! \param offsets      End of the points of each element in connectivity
+  void element_connectivity(std::vector<std::int32_t>& connectivity,
+                            std::vector<std::int32_t>& offsets);
 
   //! Generate fuel mesh points
   //! \return fuel points (axial, radial_rings, xyz)
@@ -164,6 +210,18 @@ private:
   //!< template of mesh element types for a single pin
   xtensor<int, 1> types_;
 
+  //! xyz values of the points of all pins in the assembly
+  std::vector<double> assembly_points_;
+
+  //! points of each element in the assembly
+  std::vector<std::int32_t> connectivity_;
+
+  //! end of the points of each element in connectivity_
+  std::vector<std::int32_t> offsets_;
+
+  //! VTK type of each element in the assembly
+  std::vector<std::uint8_t> cell_types_;
+
   //! number of axial sections for a single rod
   size_t n_axial_sections_;
 
@@ -49,11 +49,15 @@ BoronDriver::BoronDriver(MPI_Comm comm, pugi::xml_node node)
 }
 
 double BoronDriver::solve_ppm(bool first_pass, UncertainDouble k_eff,
-                              UncertainDouble k_eff_prev)
+                              UncertainDouble k_eff_prev, double dk_dppm)
 {
   // The estimation is performed using the Newton-Raphson method
   double new_ppm;
-  if (first_pass) {
+  if (dk_dppm < 0.) {
+    // The derivative from the latest solve needs no second point, including on
+    // the first pass
+    new_ppm = ppm_ + (target_k_eff_ - k_eff.mean) / dk_dppm;
+  } else if (first_pass) {
     // Make a reasonable update so we can get two points to compute a derivative
     if (k_eff.mean > target_k_eff_) {
       new_ppm = ppm_prev_ + 1000.;
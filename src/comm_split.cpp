@@ -1,6 +1,9 @@
 #include "enrico/comm_split.h"
 #include <gsl/gsl-lite.hpp>
 
+#include <algorithm> // for max, min
+#include <cmath>     // for log, pow
+
 namespace enrico {
 
 void get_driver_comms(Comm super_comm,
@@ -62,6 +65,108 @@ void get_driver_comms(Comm super_comm,
   }
 }
 
+void get_node_layout(Comm super_comm, int& total_nodes, int& node_size)
+{
+  MPI_Comm temp_comm;
+  MPI_Comm_split_type(
+    super_comm.comm, MPI_COMM_TYPE_SHARED, super_comm.rank, MPI_INFO_NULL, &temp_comm);
+  Comm intranode_comm(temp_comm);
+
+  // Each node is counted once by the root of its intranode comm
+  int is_root = intranode_comm.is_root() ? 1 : 0;
+  MPI_Allreduce(&is_root, &total_nodes, 1, MPI_INT, MPI_SUM, super_comm.comm);
+  MPI_Allreduce(&intranode_comm.size, &node_size, 1, MPI_INT, MPI_MAX, super_comm.comm);
+
+  intranode_comm.free();
+}
+
+CommLayout resolve_layout(const CommLayout& layout, int total_nodes, int node_size)
+{
+  CommLayout resolved = layout;
+  for (const int i : {0, 1}) {
+    auto n = layout.num_nodes[i];
+    auto ppn = layout.procs_per_node[i];
+    resolved.num_nodes[i] = n > 0 ? std::min(n, total_nodes) : total_nodes;
+    resolved.procs_per_node[i] = ppn > 0 ? std::min(ppn, node_size) : node_size;
+  }
+  return resolved;
+}
+
+double fit_strong_scaling(const std::vector<std::pair<int, double>>& samples)
+{
+  if (samples.size() < 2) {
+    return 1.0;
+  }
+
+  // Least-squares slope of log(t) against log(n)
+  double mean_x = 0.0;
+  double mean_y = 0.0;
+  for (const auto& sample : samples) {
+    mean_x += std::log(sample.first);
+    mean_y += std::log(sample.second);
+  }
+  mean_x /= samples.size();
+  mean_y /= samples.size();
+
+  double sxx = 0.0;
+  double sxy = 0.0;
+  for (const auto& sample : samples) {
+    double dx = std::log(sample.first) - mean_x;
+    sxx += dx * dx;
+    sxy += dx * (std::log(sample.second) - mean_y);
+  }
+  if (sxx == 0.0) {
+    return 1.0;
+  }
+  return std::min(std::max(-sxy / sxx, 0.0), 1.0);
+}
+
+CommLayout plan_driver_comms(int total_nodes,
+                             int node_size,
+                             const CommLayout& current,
+                             std::array<double, 2> solve_times,
+                             std::array<double, 2> scaling,
+                             bool concurrent)
+{
+  Expects(total_nodes > 0);
+  Expects(node_size > 0);
+
+  auto resolved = resolve_layout(current, total_nodes, node_size);
+  const auto& nodes = resolved.num_nodes;
+  const auto& ppn = resolved.procs_per_node;
+
+  // Time of both solves when driver i runs on n[i] nodes
+  auto predict = [&](std::array<int, 2> n) {
+    std::array<double, 2> t;
+    for (const int i : {0, 1}) {
+      double ratio = static_cast<double>(nodes[i]) / n[i];
+      t[i] = solve_times[i] * std::pow(ratio, scaling[i]);
+    }
+    // Drivers that share nodes also share ranks and run one after the other
+    bool shared = n[0] + n[1] > total_nodes;
+    return (concurrent && !shared) ? std::max(t[0], t[1]) : t[0] + t[1];
+  };
+
+  CommLayout best{nodes, ppn, predict(nodes)};
+
+  // Both drivers on all nodes
+  std::array<int, 2> n{total_nodes, total_nodes};
+  double t = predict(n);
+  if (t < best.time) {
+    best = {n, ppn, t};
+  }
+
+  // Drivers on disjoint nodes
+  for (int n0 = 1; n0 < total_nodes; ++n0) {
+    n = {n0, total_nodes - n0};
+    t = predict(n);
+    if (t < best.time) {
+      best = {n, ppn, t};
+    }
+  }
+  return best;
+}
+
 std::vector<int> gather_subcomm_ranks(const Comm& super, const Comm& sub)
 {
   std::vector<int> ranks(super.size);
@@ -0,0 +1,28 @@
+#include "enrico/comm_stats.h"
+
+namespace enrico {
+
+bool CommStats::enabled_ = false;
+const char* CommStats::current_ = nullptr;
+std::map<std::string, CommCounts> CommStats::counts_;
+
+CommCounts CommStats::counts(const std::string& site)
+{
+  auto it = counts_.find(site);
+  return it == counts_.end() ? CommCounts{} : it->second;
+}
+
+void CommStats::reset()
+{
+  counts_.clear();
+}
+
+void CommStats::record(std::int64_t messages, std::int64_t bytes, double wait)
+{
+  auto& c = counts_[current_ ? current_ : ""];
+  c.messages += messages;
+  c.bytes += bytes;
+  c.wait += wait;
+}
+
+} // namespace enrico
@@ -1,9 +1,12 @@
 #include "enrico/coupled_driver.h"
 
 #include "enrico/comm_split.h"
+#include "enrico/comm_stats.h"
 #include "enrico/driver.h"
 #include "enrico/error.h"
+#include "enrico/hash.h"
 #include "enrico/neutronics_driver.h"
+#include "enrico/thermal_state.h"
 
 #ifdef USE_NEK5000
 #include "enrico/nek5000_driver.h"
@@ -18,16 +21,24 @@
 #include "enrico/shift_driver.h"
 #endif
 #include "enrico/surrogate_heat_driver.h"
+#include "enrico/surrogate_neutronics_driver.h"
 
 #include <gsl/gsl-lite.hpp>
 #include <xtensor/xbuilder.hpp> // for empty
 #include <xtensor/xnorm.hpp>    // for norm_l1, norm_l2, norm_linf
 
-#include <algorithm> // for copy
+#include <algorithm> // for copy, equal, max, sort, unique, lower_bound
+#include <array>
+#include <cstdio>    // for rename
+#include <fstream>
+#include <functional>
 #include <iomanip>
+#include <limits>
 #include <map>
-#include <memory> // for make_unique
+#include <memory>  // for make_unique
+#include <numeric> // for accumulate, partial_sum
 #include <string>
+#include <unordered_set>
 
 // For gethostname
 #ifdef _WIN32
@@ -38,7 +49,20 @@
 
 namespace enrico {
 
+//! Identifies a mapping cache file and the version of its layout
+constexpr char MAPPING_CACHE_MAGIC[8] = {'E', 'N', 'R', 'M', 'A', 'P', '0', '1'};
+
+//! Identifies a checkpoint file and the version of its layout
+constexpr char CHECKPOINT_MAGIC[8] = {'E', 'N', 'R', 'C', 'H', 'K', '0', '1'};
+
 CoupledDriver::CoupledDriver(MPI_Comm comm, pugi::xml_node node)
+  : CoupledDriver(comm, node, nullptr, nullptr)
+{}
+
+CoupledDriver::CoupledDriver(MPI_Comm comm,
+                             pugi::xml_node node,
+                             NeutronicsFactory make_neutronics,
+                             HeatFluidsFactory make_heat)
   : comm_(comm)
   , timer_init_comms(comm_)
   , timer_init_mapping(comm_)
@@ -51,19 +75,57 @@ CoupledDriver::CoupledDriver(MPI_Comm comm, pugi::xml_node node)
   , timer_update_density(comm_)
   , timer_update_heat_source(comm_)
   , timer_update_temperature(comm_)
+  , timer_update_thermal_state(comm_)
 {
+  // All ranks start the timing trace at the same time
+  comm_.Barrier();
+  trace_origin_ = MPI_Wtime();
+
   parse_xml_params(node);
-  init_comms(node);
+  init_comms(node, make_neutronics, make_heat);
+
+  // Determine relaxation for heat source, temperature, and density.  They act on
+  // fields distributed over the heat/fluids ranks.
+  auto coup_node = node.child("coupling");
+  const auto& heat_comm = this->get_heat_driver().comm_;
+  heat_source_relaxation_ =
+    make_relaxation(coup_node.child("alpha"), anderson_depth_, heat_comm);
+  temperature_relaxation_ =
+    make_relaxation(coup_node.child("alpha_T"), anderson_depth_, heat_comm);
+  density_relaxation_ =
+    make_relaxation(coup_node.child("alpha_rho"), anderson_depth_, heat_comm);
+
+  // The largest number of particles of an adaptive schedule is the one from the
+  // neutronics input
+  auto& neutronics = this->get_neutronics_driver();
+  if (min_particles_ > 0 && neutronics.active()) {
+    max_particles_ = neutronics.get_particles();
+    if (max_particles_ == 0) {
+      throw std::runtime_error{
+        "<min_particles> is not supported by the neutronics driver"};
+    }
+    min_particles_ = std::min(min_particles_, max_particles_);
+  }
+
   init_mapping();
+  if (shared_memory_) {
+    init_shared_memory();
+  }
   init_tallies();
   init_volume();
   init_fluid_mask();
   init_temperature();
   init_density();
   init_heat_source();
+  if (incremental_update()) {
+    init_incremental_update();
+  }
   if (boron_search_) {
     init_boron();
   }
+  if (!restart_.empty()) {
+    read_checkpoint();
+  }
 }
 
 void CoupledDriver::parse_xml_params(const pugi::xml_node& node)
@@ -78,21 +140,11 @@ void CoupledDriver::parse_xml_params(const pugi::xml_node& node)
     epsilon_ = coup_node.child("epsilon").text().as_double();
   }
 
-  // Determine relaxation parameters for heat source, temperature, and density
-  auto set_alpha = [](pugi::xml_node node, double& alpha) {
-    if (node) {
-      std::string s = node.child_value();
-      if (s == "robbins-monro") {
-        alpha = ROBBINS_MONRO;
-      } else {
-        alpha = node.text().as_double();
-        Expects(alpha > 0 && alpha <= 1.0);
-      }
-    }
-  };
-  set_alpha(coup_node.child("alpha"), alpha_);
-  set_alpha(coup_node.child("alpha_T"), alpha_T_);
-  set_alpha(coup_node.child("alpha_rho"), alpha_rho_);
+  // The relaxations are created once the heat/fluids comm exists
+  if (coup_node.child("anderson_depth")) {
+    anderson_depth_ = coup_node.child("anderson_depth").text().as_int();
+    Expects(anderson_depth_ > 0);
+  }
 
   // check for convergence norm
   if (coup_node.child("convergence_norm")) {
@@ -132,11 +184,90 @@ void CoupledDriver::parse_xml_params(const pugi::xml_node& node)
     }
   }
 
+  if (coup_node.child("coupling_scheme")) {
+    std::string s = coup_node.child_value("coupling_scheme");
+    if (s == "gauss_seidel") {
+      coupling_scheme_ = CouplingScheme::gauss_seidel;
+    } else if (s == "jacobi") {
+      coupling_scheme_ = CouplingScheme::jacobi;
+    } else {
+      throw std::runtime_error{"Invalid value for <coupling_scheme>"};
+    }
+  }
+
+  if (coup_node.child("timestep_predictor")) {
+    std::string s = coup_node.child_value("timestep_predictor");
+    if (s == "none") {
+      predictor_ = Predictor::none;
+    } else if (s == "linear") {
+      predictor_ = Predictor::linear;
+    } else if (s == "quadratic") {
+      predictor_ = Predictor::quadratic;
+    } else {
+      throw std::runtime_error{"Invalid value for <timestep_predictor>"};
+    }
+  }
+
+  if (coup_node.child("min_particles")) {
+    min_particles_ = coup_node.child("min_particles").text().as_llong();
+    Expects(min_particles_ > 0);
+  }
+
+  if (coup_node.child("temperature_update_tol")) {
+    temperature_update_tol_ = coup_node.child("temperature_update_tol").text().as_double();
+    Expects(temperature_update_tol_ >= 0.0);
+  }
+  if (coup_node.child("density_update_tol")) {
+    density_update_tol_ = coup_node.child("density_update_tol").text().as_double();
+    Expects(density_update_tol_ >= 0.0);
+  }
+
+  if (coup_node.child("mapping_cache")) {
+    mapping_cache_ = coup_node.child_value("mapping_cache");
+  }
+  if (coup_node.child("mapping_chunk_size")) {
+    mapping_chunk_size_ = coup_node.child("mapping_chunk_size").text().as_llong();
+    Expects(mapping_chunk_size_ > 0);
+  }
+
+  if (coup_node.child("checkpoint")) {
+    checkpoint_ = coup_node.child_value("checkpoint");
+  }
+  if (coup_node.child("checkpoint_interval")) {
+    checkpoint_interval_ = coup_node.child("checkpoint_interval").text().as_int();
+    Expects(checkpoint_interval_ > 0);
+  }
+  if (coup_node.child("restart")) {
+    restart_ = coup_node.child_value("restart");
+  }
+
+  if (coup_node.child("shared_memory")) {
+    shared_memory_ = coup_node.child("shared_memory").text().as_bool();
+  }
+
+  if (coup_node.child("thread_lending")) {
+    thread_lending_ = coup_node.child("thread_lending").text().as_bool();
+  }
+
+  if (coup_node.child("comm_plan")) {
+    comm_plan_ = coup_node.child_value("comm_plan");
+  }
+  if (coup_node.child("timing_trace")) {
+    timing_trace_ = coup_node.child_value("timing_trace");
+    Timer::record_samples(!timing_trace_.empty());
+  }
+  if (coup_node.child("comm_stats")) {
+    CommStats::enable(coup_node.child("comm_stats").text().as_bool());
+  }
+
   // Load the flag for including boron concentration searches
   auto neut_node = node.child("neutronics");
   if (neut_node.child("boron_search")) {
     boron_search_ = neut_node.child("boron_search").text().as_bool();
   }
+  if (neut_node.child("boron_sensitivity")) {
+    boron_sensitivity_ = neut_node.child("boron_sensitivity").text().as_bool();
+  }
 
   Expects(power_ > 0);
   Expects(max_timesteps_ >= 0);
@@ -144,24 +275,36 @@ void CoupledDriver::parse_xml_params(const pugi::xml_node& node)
   Expects(epsilon_ > 0);
 }
 
-void CoupledDriver::init_comms(const pugi::xml_node& node)
+void CoupledDriver::init_comms(const pugi::xml_node& node,
+                               const NeutronicsFactory& make_neutronics,
+                               const HeatFluidsFactory& make_heat)
 {
   timer_init_comms.start();
+  CommStats::Site comm_site("init_comms");
 
   auto neut_node = node.child("neutronics");
   auto heat_node = node.child("heat_fluids");
 
   // Create communicators
-  std::array<int, 2> nodes{neut_node.child("nodes").text().as_int(),
-                           heat_node.child("nodes").text().as_int()};
-  std::array<int, 2> procs_per_node{neut_node.child("procs_per_node").text().as_int(),
-                                    heat_node.child("procs_per_node").text().as_int()};
+  CommLayout layout{{neut_node.child("nodes").text().as_int(),
+                     heat_node.child("nodes").text().as_int()},
+                    {neut_node.child("procs_per_node").text().as_int(),
+                     heat_node.child("procs_per_node").text().as_int()}};
+  get_node_layout(comm_, total_nodes_, node_size_);
+  if (!comm_plan_.empty()) {
+    read_comm_plan(layout);
+  }
+  comm_layout_ = resolve_layout(layout, total_nodes_, node_size_);
+
   std::array<Comm, 2> driver_comms;
-  Comm intranode_comm; // Not used in current comm scheme
-  Comm coupling_comm;  // Not used in current comm scheme
+  Comm coupling_comm; // Not used in current comm scheme
 
-  get_driver_comms(
-    comm_, nodes, procs_per_node, driver_comms, intranode_comm, coupling_comm);
+  get_driver_comms(comm_,
+                   layout.num_nodes,
+                   layout.procs_per_node,
+                   driver_comms,
+                   intranode_comm_,
+                   coupling_comm);
 
   auto neutronics_comm = driver_comms[0];
   auto heat_comm = driver_comms[1];
@@ -170,14 +313,19 @@ void CoupledDriver::init_comms(const pugi::xml_node& node)
 
   // Instantiate neutronics driver
   std::string neut_driver = neut_node.child_value("driver");
-  if (neut_driver == "openmc") {
-    neutronics_driver_ = std::make_unique<OpenmcDriver>(neutronics_comm.comm);
+  if (make_neutronics) {
+    neutronics_driver_ = make_neutronics(neutronics_comm.comm, neut_node);
+  } else if (neut_driver == "openmc") {
+    neutronics_driver_ = std::make_unique<OpenmcDriver>(neutronics_comm.comm, neut_node);
   } else if (neut_driver == "shift") {
 #ifdef USE_SHIFT
-    neutronics_driver_ = std::make_unique<ShiftDriver>(comm, neut_node);
+    neutronics_driver_ = std::make_unique<ShiftDriver>(neutronics_comm.comm, neut_node);
 #else
     throw std::runtime_error{"ENRICO has not been built with Shift support enabled."};
 #endif
+  } else if (neut_driver == "surrogate") {
+    neutronics_driver_ = std::make_unique<SurrogateNeutronicsDriver>(
+      neutronics_comm.comm, neut_node, heat_node);
   } else {
     throw std::runtime_error{"Invalid value for <neutronics><driver>"};
   }
@@ -189,7 +337,9 @@ void CoupledDriver::init_comms(const pugi::xml_node& node)
 
   // Instantiate heat-fluids driver
   std::string s = heat_node.child_value("driver");
-  if (s == "nek5000") {
+  if (make_heat) {
+    heat_fluids_driver_ = make_heat(heat_comm.comm, heat_node);
+  } else if (s == "nek5000") {
 #ifdef USE_NEK5000
     heat_fluids_driver_ = std::make_unique<Nek5000Driver>(heat_comm.comm, heat_node);
 #else
@@ -235,34 +385,107 @@ void CoupledDriver::init_comms(const pugi::xml_node& node)
 void CoupledDriver::execute()
 {
 
-  auto& neutronics = get_neutronics_driver();
-  auto& heat = get_heat_driver();
+  auto& neutronics = this->get_neutronics_driver();
+  auto& heat = this->get_heat_driver();
+
+  // Transfer of temperature and density from the heat/fluids ranks that is still in
+  // flight at the start of a Picard iteration
+  CommRequest thermal_state_request;
+
+  // A resumed run starts by sending the checkpointed temperature and density
+  if (resumed_) {
+    thermal_state_request = send_thermal_state();
+  }
+
+  // Picard iterations run so far, counted for the checkpoint interval
+  int n_iterations = 0;
+
+  // Whether the heat/fluids solver already ran with the heat source it was given
+  bool heat_source_solved = false;
+
+  // Highest order of the timestep predictor
+  int max_order = 0;
+  if (predictor_ == Predictor::linear) {
+    max_order = 1;
+  } else if (predictor_ == Predictor::quadratic) {
+    max_order = 2;
+  }
 
   // loop over time steps
-  for (i_timestep_ = 0; i_timestep_ < max_timesteps_; ++i_timestep_) {
+  for (i_timestep_ = resume_timestep_; i_timestep_ < max_timesteps_; ++i_timestep_) {
     std::string msg = "i_timestep: " + std::to_string(i_timestep_);
     comm_.message(msg);
 
+    // Once two timesteps have been run by this launch, each timestep starts from the
+    // fields extrapolated from the previous ones.  The predicted temperature and
+    // density replace the last iterate, whose transfer is still in flight.
+    int order = std::min(max_order, i_timestep_ - resume_timestep_ - 1);
+    if (order > 0) {
+      end_thermal_state_update(thermal_state_request);
+      if (heat.active()) {
+        predict_timestep_state(order);
+      }
+      thermal_state_request = send_thermal_state();
+      heat_source_solved = false;
+    }
+
     // loop over picard iterations
-    for (i_picard_ = 0; i_picard_ < max_picard_iter_; ++i_picard_) {
+    int first_picard = i_timestep_ == resume_timestep_ ? resume_picard_ : 0;
+    for (i_picard_ = first_picard; i_picard_ < max_picard_iter_; ++i_picard_) {
       std::string msg = "i_picard: " + std::to_string(i_picard_);
       comm_.message(msg);
 
+      // With the Jacobi scheme, the heat/fluids solver runs at the same time as the
+      // neutronics solver with the heat source of the previous Picard iteration.
+      // The very first iteration has no previous heat source, so it is always
+      // Gauss-Seidel, as is the first iteration of a resumed run, whose heat/fluids
+      // solver has not been given the checkpointed heat source.  A Jacobi iteration
+      // after a Gauss-Seidel one has no new heat source for the heat/fluids solver.
+      auto step = picard_step(coupling_scheme_ == CouplingScheme::jacobi,
+                              is_first_iteration() || resumed_,
+                              heat_source_solved);
+      bool jacobi = step.jacobi;
+
+      // Only one solver runs at a time with Gauss-Seidel, so the ranks of the other
+      // one can lend it their cores
+      bool lend = thread_lending_ && !jacobi;
+
+      // If the neutronics solver's init_step() does not depend on the temperature and
+      // density, the transfer started at the end of the previous iteration is
+      // completed after it, so the two overlap.
+      if (neutronics.init_step_needs_state()) {
+        end_thermal_state_update(thermal_state_request);
+      }
+
+      begin_driver_run(neutronics, lend);
       if (neutronics.active()) {
-#ifdef _OPENMP
-        omp_set_num_threads(neutronics.num_threads);
-#pragma omp parallel default(none) shared(neutronics)
-#pragma omp single
-        {
-          std::string msg = "OpenMP threads: " + std::to_string(omp_get_num_threads());
-          neutronics.comm_.message(msg);
+        if (min_particles_ > 0) {
+          auto n = scheduled_particles();
+          neutronics.comm_.message("Particles per batch: " + std::to_string(n));
+          neutronics.set_particles(n);
         }
-#endif
         neutronics.init_step();
+      }
+
+      end_thermal_state_update(thermal_state_request);
+
+      if (neutronics.active()) {
         neutronics.solve_step();
         neutronics.write_step(i_timestep_, i_picard_);
         neutronics.finalize_step();
       }
+      end_driver_run(neutronics, lend);
+
+      // The heat/fluids ranks get here without waiting on the neutronics solve
+      if (jacobi && !step.solve_heat) {
+        comm_.message("Heat/fluids solve skipped: no new heat source");
+      } else if (jacobi && heat.active()) {
+        set_driver_threads(heat);
+        heat.init_step();
+        heat.solve_step();
+        heat.write_step(i_timestep_, i_picard_);
+        heat.finalize_step();
+      }
 
       comm_.Barrier();
 
@@ -271,35 +494,51 @@ void CoupledDriver::execute()
         update_k_effective();
       }
 
-      // Update heat source.
       // On the first iteration, there is no previous iterate of heat source,
       // so we can't apply underrelaxation at that point
-      update_heat_source(i_timestep_ > 0 || i_picard_ > 0);
+      bool relax = !is_first_iteration();
+
+      if (jacobi) {
+        // Exchange the fields of both solvers for the next Picard iteration.  The
+        // heat source scatter and the temperature/density gather are in flight at
+        // the same time.  Without a heat/fluids solve, the neutronics ranks keep the
+        // temperature and density they have.
+        auto heat_source_request = begin_heat_source_update(relax);
+        if (step.solve_heat) {
+          thermal_state_request = begin_thermal_state_update(true);
+        }
+        end_heat_source_update(heat_source_request, relax);
+        heat_source_solved = false;
+      } else {
+        // Update heat source, overlapping the scatter to the heat ranks with
+        // heat.init_step().
+        auto heat_source_request = begin_heat_source_update(relax);
 
-      if (heat.active()) {
-#ifdef _OPENMP
-        omp_set_num_threads(heat.num_threads);
-#pragma omp parallel default(none) shared(heat)
-#pragma omp single
-        {
-          std::string msg = "OpenMP threads: " + std::to_string(omp_get_num_threads());
-          heat.comm_.message(msg);
+        begin_driver_run(heat, lend);
+        if (heat.active()) {
+          heat.init_step();
         }
-#endif
-        heat.init_step();
-        heat.solve_step();
-        heat.write_step(i_timestep_, i_picard_);
-        heat.finalize_step();
-      }
 
-      comm_.Barrier();
+        end_heat_source_update(heat_source_request, relax);
 
-      // Update temperature and density
-      // At this point, there is always a previous iterate of temperature and density
-      // (as assured by the initial conditions set in init_temperature and init_density)
-      // so we always apply underrelaxation here.
-      update_temperature(true);
-      update_density(true);
+        if (heat.active()) {
+          heat.solve_step();
+          heat.write_step(i_timestep_, i_picard_);
+          heat.finalize_step();
+        }
+        end_driver_run(heat, lend);
+
+        comm_.Barrier();
+
+        // Update temperature and density
+        // At this point, there is always a previous iterate of temperature and
+        // density (as assured by the initial conditions set in init_temperature and
+        // init_density) so we always apply underrelaxation here.  The cell-averaged
+        // fields are computed now, but the transfer to the neutronics ranks is
+        // completed at the start of the next iteration.
+        thermal_state_request = begin_thermal_state_update(true);
+        heat_source_solved = true;
+      }
 
       // Update the boron search information if the user requested it and
       // this is the first time step.
@@ -314,16 +553,139 @@ void CoupledDriver::execute()
 
       timer_report();
 
-      if (is_converged()) {
+      if (!comm_plan_.empty() && is_first_iteration()) {
+        plan_comms();
+      }
+
+      bool converged = step.check_convergence && is_converged();
+      if (!checkpoint_.empty() && ++n_iterations % checkpoint_interval_ == 0) {
+        write_checkpoint(converged);
+      }
+      resumed_ = false;
+
+      if (converged) {
         std::string msg = "Converged at i_picard = " + std::to_string(i_picard_);
         comm_.message(msg);
+        if (neutronics.active()) {
+          neutronics.write_converged_step(i_timestep_, i_picard_);
+        }
         break;
       }
     }
+    if (max_order > 0 && heat.active()) {
+      store_timestep_state();
+    }
     comm_.Barrier();
   }
-  // TODO: Is this final heat.write_step still needed?
-  heat.write_step();
+  end_thermal_state_update(thermal_state_request);
+
+  // Output after the last Picard iteration, such as the "final" visualization files
+  // of the surrogate heat/fluids driver and the "final" OpenMC statepoint
+  if (heat.active()) {
+    heat.write_step();
+  }
+  if (neutronics.active()) {
+    neutronics.write_step();
+  }
+
+  if (!timing_trace_.empty()) {
+    write_timing_trace();
+  }
+}
+
+void CoupledDriver::apply_relaxation(Relaxation& relaxation,
+                                     const std::string& label,
+                                     xt::xtensor<double, 1>& x,
+                                     const xt::xtensor<double, 1>& x_prev)
+{
+  relaxation.relax(x, x_prev, i_picard_);
+
+  std::stringstream msg;
+  msg << "  " << label << " residual: " << std::scientific << std::setprecision(4)
+      << relaxation.residual() << " (" << relaxation.name()
+      << " relaxation, factor = " << std::fixed << relaxation.factor() << ")";
+  this->get_heat_driver().comm_.message(msg.str());
+}
+
+std::int64_t CoupledDriver::scheduled_particles() const
+{
+  // Without a temperature norm, the fields are as far from converged as they get
+  if (temperature_norm_ < 0.0) {
+    return min_particles_;
+  }
+  if (temperature_norm_ <= epsilon_) {
+    return max_particles_;
+  }
+  double ratio = epsilon_ / temperature_norm_;
+  auto n = static_cast<std::int64_t>(max_particles_ * ratio * ratio);
+  return std::max(min_particles_, std::min(n, max_particles_));
+}
+
+void CoupledDriver::set_driver_threads(const Driver& driver, int lent_threads) const
+{
+#ifdef _OPENMP
+  omp_set_num_threads(driver.num_threads + lent_threads);
+#pragma omp parallel default(none) shared(driver, lent_threads)
+#pragma omp single
+  {
+    std::string msg = "OpenMP threads: " + std::to_string(omp_get_num_threads());
+    if (lent_threads > 0) {
+      msg += " (" + std::to_string(lent_threads) + " lent)";
+    }
+    driver.comm_.message(msg);
+  }
+#endif
+}
+
+void CoupledDriver::begin_driver_run(const Driver& driver, bool lend) const
+{
+  if (!lend) {
+    if (driver.active()) {
+      set_driver_threads(driver);
+    }
+    return;
+  }
+
+  // Cores of this rank, i.e. the threads it runs its own driver with
+  const auto& neutronics = this->get_neutronics_driver();
+  int threads = neutronics.active() ? neutronics.num_threads
+                                    : this->get_heat_driver().num_threads;
+
+  // Count the ranks on this node that run the driver and the threads of the ones
+  // that are idle meanwhile
+  int active = driver.active() ? 1 : 0;
+  std::array<int, 2> local{active, active ? 0 : threads};
+  std::array<int, 2> node;
+  MPI_Allreduce(local.data(), node.data(), 2, MPI_INT, MPI_SUM, intranode_comm_.comm);
+
+  // Index of this rank among the node's ranks that run the driver
+  int index = 0;
+  MPI_Exscan(&active, &index, 1, MPI_INT, MPI_SUM, intranode_comm_.comm);
+  if (intranode_comm_.is_root()) {
+    index = 0;
+  }
+
+  // Share the idle threads evenly, the first ranks taking the remainder
+  if (driver.active()) {
+    int lent = node[1] / node[0] + (index < node[1] % node[0] ? 1 : 0);
+    set_driver_threads(driver, lent);
+  }
+}
+
+void CoupledDriver::end_driver_run(const Driver& driver, bool lend) const
+{
+  if (!lend) {
+    return;
+  }
+
+  // The idle ranks sleep rather than spin in MPI so that their cores stay free for
+  // the threads they lent
+  auto request = comm_.ibarrier();
+  if (driver.active()) {
+    request.wait();
+  } else {
+    request.wait_idle();
+  }
 }
 
 double CoupledDriver::temperature_norm(Norm norm)
@@ -377,6 +739,7 @@ bool CoupledDriver::is_converged()
 
   comm_.broadcast(heat_converged, heat_root_);
   comm_.broadcast(norm, heat_root_);
+  temperature_norm_ = norm;
 
   msg << "  Temperature norm: " << std::fixed << std::setprecision(2) << norm;
   msg << (heat_converged ? " < " : " > ") << epsilon_ << " K";
@@ -410,9 +773,19 @@ void CoupledDriver::update_boron()
   double next_ppm;
 
   if (boron.active()) {
+    // Sensitivity of k-eff to the boron concentration from the latest solve
+    double dk_dppm = 0.;
+    if (boron_sensitivity_) {
+      dk_dppm = neutronics.boron_sensitivity(boron.ppm_, k_eff_.mean);
+      std::stringstream msg;
+      msg << "\tEstimated dk/dppm: " << std::scientific << std::setprecision(4)
+          << dk_dppm;
+      boron.comm_.message(msg.str());
+    }
+
     // Estimate the new boron concentration
     next_ppm = boron.solve_ppm(
-      is_first_iteration(), k_eff_, k_eff_prev_);
+      is_first_iteration(), k_eff_, k_eff_prev_, dk_dppm);
 
     // Announce what was done
     boron.print_boron();
@@ -428,9 +801,16 @@ void CoupledDriver::update_boron()
 };
 
 void CoupledDriver::update_heat_source(bool relax)
+{
+  auto request = begin_heat_source_update(relax);
+  end_heat_source_update(request, relax);
+}
+
+CommRequest CoupledDriver::begin_heat_source_update(bool relax)
 {
   comm_.message("Updating heat source");
   timer_update_heat_source.start();
+  CommStats::Site comm_site("update_heat_source");
 
   auto& neutronics = this->get_neutronics_driver();
   auto& heat = this->get_heat_driver();
@@ -441,124 +821,128 @@ void CoupledDriver::update_heat_source(bool relax)
               cell_heat_source_prev_.begin());
   }
 
-  decltype(cell_to_glob_cell_) cells_recv;
-  decltype(cell_heat_source_) cell_heat_send;
-  xt::xtensor<double, 1> all_cell_heat;
-
-  // For the coupling scheme, only the neutronics root needs the heat source.
-  // However, to compute the heat source, OpenmcDriver::heat_source must
-  // do a collective operation on all the ranks in the neutronics sub comm.
-  // Hence, all neutronics ranks must call OpenmcDriver::heat_source
+  // Only the neutronics root needs the heat source, in the order of coupled_cells_:
+  // the local cells of each heat rank in turn, whose indices in the neutronics driver
+  // were cached in init_mapping.  The call is collective over the neutronics comm,
+  // although the driver may do the work on the root only.
   if (neutronics.active()) {
-    all_cell_heat = neutronics.heat_source(power_);
-  }
-
-  // The neutronics root sends the cell-averaged heat sources to the heat ranks.
-  // Each heat rank gets only the heat sources for its local cells.
-  for (const auto& heat_rank : heat_ranks_) {
-    comm_.send_and_recv(cells_recv, neutronics_root_, cell_to_glob_cell_, heat_rank);
-    cell_heat_send.resize({cells_recv.size()});
     if (comm_.rank == neutronics_root_) {
-      for (gsl::index i = 0; i < cells_recv.size(); ++i) {
-        auto j = neutronics.cell_index(cells_recv.at(i));
-        cell_heat_send.at(i) = all_cell_heat.at(j);
-      }
+      coupled_heat_source_.resize({coupled_cells_.size()});
     }
-    comm_.send_and_recv(cell_heat_source_, heat_rank, cell_heat_send, neutronics_root_);
+    neutronics.get_heat_sources(
+      power_,
+      coupled_cell_indices_,
+      gsl::make_span(coupled_heat_source_.data(), coupled_heat_source_.size()));
   }
 
+  // The neutronics root scatters the cell-averaged heat sources to the heat ranks.
+  // Each heat rank gets only the heat sources for its local cells.
+  auto request = comm_.iscatterv(
+    coupled_heat_source_, cell_heat_source_, coupled_cell_counts_, neutronics_root_);
+
+  timer_update_heat_source.stop();
+  return request;
+}
+
+void CoupledDriver::end_heat_source_update(CommRequest& request, bool relax)
+{
+  timer_update_heat_source.start();
+  CommStats::Site comm_site("update_heat_source");
+
+  auto& heat = this->get_heat_driver();
+  request.wait();
+
   // On heat rank, update the elements' heat sources based on the cell-avged heat sources
   if (heat.active()) {
     if (relax) {
-      if (alpha_ == ROBBINS_MONRO) {
-        int n = i_picard_ + 1;
-        cell_heat_source_ = cell_heat_source_ / n + (1. - 1. / n) * cell_heat_source_prev_;
-      } else {
-        cell_heat_source_ = alpha_ * cell_heat_source_ + (1.0 - alpha_) * cell_heat_source_prev_;
-      }
-    }
-    for (gsl::index i = 0; i < cell_to_glob_cell_.size(); ++i) {
-      for (const auto& e : glob_cell_to_elem_.at(cell_to_glob_cell_.at(i))) {
-        heat.set_heat_source_at(e, cell_heat_source_.at(i));
-      }
+      apply_relaxation(
+        *heat_source_relaxation_, "Heat source", cell_heat_source_, cell_heat_source_prev_);
     }
+    set_elem_heat_source();
   }
   timer_update_heat_source.stop();
 }
 
-void CoupledDriver::update_temperature(bool relax)
+void CoupledDriver::set_elem_heat_source()
 {
-  comm_.message("Updating temperature");
-  timer_update_temperature.start();
-
-  auto& neutronics = this->get_neutronics_driver();
   auto& heat = this->get_heat_driver();
+  elem_field_.resize(heat.n_local_elem());
+  for (gsl::index i = 0; i < cell_to_glob_cell_.size(); ++i) {
+    double q = cell_heat_source_(i);
+    for (auto r = cell_run_offsets_[i]; r < cell_run_offsets_[i + 1]; ++r) {
+      const auto& run = cell_elem_runs_[r];
+      std::fill(elem_field_.begin() + run.first, elem_field_.begin() + run.last, q);
+    }
+  }
+  heat.set_heat_sources(elem_field_);
+}
 
-  // Step 1: On each heat rank, assign the current iterate of local cell-avged T
-  // to the previous iterate
-  if (relax && heat.active()) {
-    std::copy(cell_temperature_.begin(),
-              cell_temperature_.end(), cell_temperature_prev_.begin());
+void CoupledDriver::store_timestep_state()
+{
+  std::size_t max_states = predictor_ == Predictor::quadratic ? 3 : 2;
+  if (timestep_states_.size() == max_states) {
+    timestep_states_.pop_front();
   }
+  timestep_states_.push_back({cell_temperature_, cell_density_, cell_heat_source_});
+}
 
-  // Step 2: On each heat, compute cell-avged T
-  if (heat.active()) {
-    auto elem_temperatures = heat.temperature();
-    for (gsl::index i = 0; i < cell_to_glob_cell_.size(); ++i) {
-      double T_avg = 0.0;
-      double V_tot = 0.0;
-      for (const auto& e : glob_cell_to_elem_.at(cell_to_glob_cell_.at(i))) {
-        double T = elem_temperatures.at(e);
-        double V = elem_volume_.at(e);
-        T_avg += T * V;
-      }
-      T_avg /= cell_volume_.at(i);
-      Ensures(T_avg > 0.0);
-      cell_temperature_.at(i) = T_avg;
-    }
-    // Apply relaxation to local cell-avged T
-    if (relax) {
-      if (alpha_T_ == ROBBINS_MONRO) {
-        int n = i_picard_ + 1;
-        cell_temperature_ =
-          cell_temperature_ / n + (1. - 1. / n) * cell_temperature_prev_;
-      } else {
-        cell_temperature_ =
-          alpha_T_ * cell_temperature_ + (1.0 - alpha_T_) * cell_temperature_prev_;
+void CoupledDriver::predict_timestep_state(int order)
+{
+  Expects(order > 0 && order + 1 <= timestep_states_.size());
+
+  // Weights of the latest timesteps, newest first, in the polynomial extrapolation
+  // to the next one, for timesteps of the same length
+  std::vector<double> weights = order == 1 ? std::vector<double>{2.0, -1.0}
+                                           : std::vector<double>{3.0, -3.0, 1.0};
+
+  // A value that would change sign is kept at its latest value, so the temperature
+  // and density stay positive and the heat source nonnegative
+  auto extrapolate = [&](xt::xtensor<double, 1> CellState::*field,
+                         xt::xtensor<double, 1>& x) {
+    const auto& latest = timestep_states_.back().*field;
+    for (gsl::index i = 0; i < x.size(); ++i) {
+      double value = 0.0;
+      for (int k = 0; k <= order; ++k) {
+        value += weights[k] * (timestep_states_.rbegin()[k].*field)(i);
       }
+      x(i) = value > 0.0 ? value : latest(i);
     }
-  }
+  };
+  extrapolate(&CellState::temperature, cell_temperature_);
+  extrapolate(&CellState::density, cell_density_);
+  extrapolate(&CellState::heat_source, cell_heat_source_);
 
-  // Step 3: On each neutron rank, accumulate cell-avged volumes from all heat ranks
-  std::unordered_map<CellHandle, double> T_dot_V;
-  std::unordered_map<CellHandle, double> cell_V;
-  decltype(cell_to_glob_cell_) cells_recv;
-  decltype(cell_volume_) cell_volumes_recv;
-  decltype(cell_temperature_) cell_temperatures_recv;
-  for (const auto& heat_rank : heat_ranks_) {
-    comm_.send_and_recv(cells_recv, neutronics_root_, cell_to_glob_cell_, heat_rank);
-    neutronics.comm_.broadcast(cells_recv);
+  // With the Jacobi scheme, the first heat/fluids solve of the timestep uses this
+  // heat source
+  set_elem_heat_source();
+}
 
-    comm_.send_and_recv(
-      cell_temperatures_recv, neutronics_root_, cell_temperature_, heat_rank);
-    neutronics.comm_.broadcast(cell_temperatures_recv);
+void CoupledDriver::update_temperature(bool relax)
+{
+  comm_.message("Updating temperature");
+  timer_update_temperature.start();
+  CommStats::Site comm_site("update_temperature");
 
-    comm_.send_and_recv(cell_volumes_recv, neutronics_root_, cell_volume_, heat_rank);
-    neutronics.comm_.broadcast(cell_volumes_recv);
+  const auto& neutronics = this->get_neutronics_driver();
+  const auto& heat = this->get_heat_driver();
 
-    if (neutronics.active()) {
-      for (gsl::index i = 0; i < cells_recv.size(); ++i) {
-        auto T = cell_temperatures_recv.at(i);
-        auto V = cell_volumes_recv.at(i);
-        cell_V[cells_recv.at(i)] += V;
-        T_dot_V[cells_recv.at(i)] += T * V;
-      }
-    }
+  // Steps 1 and 2: On each heat rank, compute the local cell-avged T
+  if (heat.active()) {
+    elem_field_.resize(heat.n_local_elem());
+    heat.temperature(elem_field_);
+    compute_cell_temperature(elem_field_, relax);
   }
-  for (const auto& kv : T_dot_V) {
-    auto cell = kv.first;
-    auto tv = kv.second;
-    neutronics.set_temperature(cell, tv / cell_V.at(cell));
+
+  // Step 3: On each neutron rank, accumulate cell-avged T from all heat ranks.  Only
+  // the temperatures are sent; the cell handles and volumes were cached during
+  // initialization.
+  decltype(cell_temperature_) cell_temperatures_recv;
+  comm_.gatherv(
+    cell_temperature_, cell_temperatures_recv, coupled_cell_counts_, neutronics_root_);
+  neutronics.comm_.broadcast(cell_temperatures_recv);
+
+  if (neutronics.active()) {
+    set_neutronics_temperature(cell_temperatures_recv);
   }
   timer_update_temperature.stop();
 }
@@ -567,141 +951,1044 @@ void CoupledDriver::update_density(bool relax)
 {
   comm_.message("Updating density");
   timer_update_density.start();
+  CommStats::Site comm_site("update_density");
 
-  auto& neutronics = this->get_neutronics_driver();
-  auto& heat = this->get_heat_driver();
-
-  // Step 1: On each heat rank, assign the current iterate of local cell-avged rho
-  // to the previous iterate
-  if (relax && heat.active()) {
-    std::copy(cell_density_.cbegin(), cell_density_.cend(), cell_density_.begin());
-  }
+  const auto& neutronics = this->get_neutronics_driver();
+  const auto& heat = this->get_heat_driver();
 
-  // Step 2: On each heat, compute cell-avged rho
+  // Steps 1 and 2: On each heat rank, compute the local cell-avged rho
   if (heat.active()) {
-    auto elem_densities = heat.density();
-
-    for (gsl::index i = 0; i < cell_to_glob_cell_.size(); ++i) {
-      if (cell_fluid_mask_.at(i) == 1) {
-        double rho_avg = 0.0;
-        double V_tot = 0.0;
-        for (const auto& e : glob_cell_to_elem_.at(cell_to_glob_cell_.at(i))) {
-          rho_avg += elem_densities.at(e) * elem_volume_.at(e);
-        }
-        rho_avg /= cell_volume_[i];
-        Ensures(rho_avg > 0.0);
-        cell_density_.at(i) = rho_avg;
-      }
-    }
-    if (relax) {
-      if (alpha_rho_ == ROBBINS_MONRO) {
-        int n = i_picard_ + 1;
-        cell_density_ = cell_density_ / n + (1. - 1. / n) * cell_density_prev_;
-      } else {
-        cell_density_ =
-          alpha_rho_ * cell_density_ + (1.0 - alpha_rho_) * cell_density_prev_;
-      }
-    }
+    elem_field_.resize(heat.n_local_elem());
+    heat.density(elem_field_);
+    compute_cell_density(elem_field_, relax);
   }
 
-  // Step 3: On each neutron rank, accumulate cell-avged volumes from all heat ranks
-  std::map<CellHandle, double> rho_dot_V;
-  std::map<CellHandle, double> cell_V;
-  decltype(cell_to_glob_cell_) cells_recv;
-  decltype(cell_volume_) cell_volumes_recv;
+  // Step 3: On each neutron rank, accumulate cell-avged rho from all heat ranks.  Only
+  // the densities are sent; the cell handles, volumes, and fluid mask were cached
+  // during initialization.
   decltype(cell_density_) cell_densities_recv;
-  decltype(cell_fluid_mask_) cell_fluid_mask_recv;
+  comm_.gatherv(cell_density_, cell_densities_recv, coupled_cell_counts_, neutronics_root_);
+  neutronics.comm_.broadcast(cell_densities_recv);
 
-  for (const auto& heat_rank : heat_ranks_) {
-    comm_.send_and_recv(cells_recv, neutronics_root_, cell_to_glob_cell_, heat_rank);
-    neutronics.comm_.broadcast(cells_recv);
+  if (neutronics.active()) {
+    set_neutronics_density(cell_densities_recv);
+  }
+  timer_update_density.stop();
+}
 
-    comm_.send_and_recv(cell_volumes_recv, neutronics_root_, cell_volume_, heat_rank);
-    neutronics.comm_.broadcast(cell_volumes_recv);
+void CoupledDriver::update_thermal_state(bool relax)
+{
+  auto request = begin_thermal_state_update(relax);
+  end_thermal_state_update(request);
+}
 
-    comm_.send_and_recv(
-      cell_densities_recv, neutronics_root_, cell_density_, heat_rank);
-    neutronics.comm_.broadcast(cell_densities_recv);
+CommRequest CoupledDriver::begin_thermal_state_update(bool relax)
+{
+  comm_.message("Updating temperature and density");
+  timer_update_thermal_state.start();
+  CommStats::Site comm_site("update_thermal_state");
 
-    comm_.send_and_recv(
-      cell_fluid_mask_recv, neutronics_root_, cell_fluid_mask_, heat_rank);
-    neutronics.comm_.broadcast(cell_fluid_mask_recv);
+  const auto& heat = this->get_heat_driver();
 
-    if (neutronics.active()) {
-      for (gsl::index i = 0; i < cells_recv.size(); ++i) {
-        if (cell_fluid_mask_recv.at(i) == 1) {
-          auto rho = cell_densities_recv.at(i);
-          auto V = cell_volumes_recv.at(i);
-          cell_V[cells_recv.at(i)] += V;
-          rho_dot_V[cells_recv.at(i)] += rho * V;
-        }
-      }
-    }
+  // On each heat rank, compute the local cell-avged T and rho from one extraction of
+  // the element values
+  if (heat.active()) {
+    elem_field_.resize(heat.n_local_elem());
+    elem_density_.resize(heat.n_local_elem());
+    heat.thermal_state(elem_field_, elem_density_);
+    compute_cell_temperature(elem_field_, relax);
+    compute_cell_density(elem_density_, relax);
   }
+  auto request = send_thermal_state();
 
-  for (const auto& kv : rho_dot_V) {
-    neutronics.set_density(kv.first, kv.second / cell_V.at(kv.first));
-  }
-  timer_update_density.stop();
+  timer_update_thermal_state.stop();
+  return request;
 }
 
-void CoupledDriver::init_mapping()
+CommRequest CoupledDriver::send_thermal_state()
 {
-  comm_.message("Initializing mappings");
-  timer_init_mapping.start();
-
+  CommStats::Site comm_site("update_thermal_state");
   const auto& heat = this->get_heat_driver();
-  auto& neutronics = this->get_neutronics_driver();
-
-  // Send and recv buffers
-  std::vector<Position> centroids_send;
-  std::vector<Position> centroids_recv;
-  decltype(elem_to_glob_cell_) elem_to_cell_send;
-
-  for (const auto& heat_rank : heat_ranks_) {
-    // For the given heat rank, the neutronics root discovers the mapping of
-    // local elem ID --> global cell handle.
-    // * IMPORTANT: OpenmcDriver::find adds the cell instances it discovers to
-    //   the OpenmcDriver::cells_ array of the calling rank only.  However, every
-    //   neutronics rank needs the full array of cells_ for Openmc::create_tallies.
-    //   Hence, we broadcast the centroids to all neutronics ranks and then
-    //   call neutronics.find on each neutronics rank.
-    if (comm_.rank == heat_rank) {
-      centroids_send = heat.centroid();
-    }
-    this->comm_.send_and_recv(
-      centroids_recv, neutronics_root_, centroids_send, heat_rank);
-    neutronics.comm_.broadcast(centroids_recv);
-    if (neutronics.comm_.active()) {
-      elem_to_cell_send = neutronics.find(centroids_recv);
-    }
 
-    // The neutronics root send the mapping of local elem ID --> global cell handle
-    // back to the given heat rank.
-    this->comm_.send_and_recv(
-      elem_to_glob_cell_, heat_rank, elem_to_cell_send, neutronics_root_);
-    comm_.Barrier();
+  // Pack the local cell-avged T and rho into a single buffer.  For incremental
+  // updates, only the cells that changed by more than the tolerance since they were
+  // last sent are packed.  With shared memory, they are stored in place in the node's
+  // shared array instead, once the neutronics ranks are done reading it.
+  ThermalState* shared_cells = nullptr;
+  if (shared_memory_) {
+    shared_thermal_state_.sync();
+    shared_cells = shared_thermal_state_.data() + shared_offset_;
   }
   if (heat.active()) {
-    // The heat rank sets the inverse mapping of global cell handle -> local element ID
-    // This is only for its local cells.
-    for (gsl::index e = 0; e < elem_to_glob_cell_.size(); ++e) {
-      auto c = elem_to_glob_cell_[e];
-      glob_cell_to_elem_[c].push_back(e); // Use [ ] instead of at() to insert new item
+    thermal_state_send_.clear();
+    changed_cells_.clear();
+    for (gsl::index i = 0; i < cell_to_glob_cell_.size(); ++i) {
+      if (incremental_update()) {
+        bool changed =
+          std::abs(cell_temperature_(i) - cell_temperature_sent_(i)) >
+            temperature_update_tol_ ||
+          (cell_fluid_mask_[i] == 1 &&
+           std::abs(cell_density_(i) - cell_density_sent_(i)) > density_update_tol_);
+        if (!changed) {
+          continue;
+        }
+        cell_temperature_sent_(i) = cell_temperature_(i);
+        cell_density_sent_(i) = cell_density_(i);
+        changed_cells_.push_back(i);
+      }
+      if (shared_cells) {
+        shared_cells[i] = {cell_temperature_(i), cell_density_(i)};
+      } else {
+        thermal_state_send_.push_back({cell_temperature_(i), cell_density_(i)});
+      }
     }
-    // The heat rank creates an array global cell handles for its local cells.
-    // This is useful in the coupling.
-    for (const auto& kv : glob_cell_to_elem_) {
-      cell_to_glob_cell_.push_back(kv.first);
+  }
+
+  // Start moving T and rho of all heat ranks to the neutronics root in one exchange.
+  // With shared memory, only the indices of the changed cells go to the root.
+  CommRequest request;
+  if (incremental_update()) {
+    changed_cell_counts_ = comm_.gather_counts(changed_cells_.size(), neutronics_root_);
+    if (!shared_memory_) {
+      request = comm_.igatherv(thermal_state_send_,
+                               coupled_changed_thermal_state_,
+                               changed_cell_counts_,
+                               neutronics_root_);
     }
+    request.merge(comm_.igatherv(
+      changed_cells_, coupled_changed_cells_, changed_cell_counts_, neutronics_root_));
+  } else if (!shared_memory_) {
+    request = comm_.igatherv(
+      thermal_state_send_, coupled_thermal_state_, coupled_cell_counts_, neutronics_root_);
   }
-  timer_init_mapping.stop();
+  if (shared_memory_) {
+    request.merge(exchange_shared_thermal_state());
+  }
+  thermal_state_pending_ = true;
+  return request;
 }
 
-void CoupledDriver::init_tallies()
+void CoupledDriver::end_thermal_state_update(CommRequest& request)
+{
+  if (!thermal_state_pending_) {
+    return;
+  }
+  timer_update_thermal_state.start();
+  CommStats::Site comm_site("update_thermal_state");
+
+  const auto& neutronics = this->get_neutronics_driver();
+  request.wait();
+  thermal_state_pending_ = false;
+
+  // With shared memory, the fields of the node's heat ranks were stored in place in
+  // the node's shared array, and those of other nodes crossed the network once per
+  // node.  Every neutronics rank reads them in place.
+  if (shared_memory_) {
+    shared_thermal_state_.sync();
+  }
+  auto state = [this](gsl::index i) -> const ThermalState& {
+    return shared_memory_ ? shared_thermal_state_[shared_positions_[i]]
+                          : coupled_thermal_state_[i];
+  };
+
+  if (!incremental_update()) {
+    std::size_t n = coupled_cells_.size();
+    if (!shared_memory_) {
+      neutronics.comm_.broadcast(coupled_thermal_state_);
+    }
+
+    if (neutronics.active()) {
+      xt::xtensor<double, 1> cell_temperatures_recv;
+      xt::xtensor<double, 1> cell_densities_recv;
+      cell_temperatures_recv.resize({n});
+      cell_densities_recv.resize({n});
+      for (gsl::index i = 0; i < n; ++i) {
+        cell_temperatures_recv(i) = state(i).temperature;
+        cell_densities_recv(i) = state(i).density;
+      }
+      set_neutronics_temperature(cell_temperatures_recv);
+      set_neutronics_density(cell_densities_recv);
+    }
+    timer_update_thermal_state.stop();
+    return;
+  }
+
+  // The neutronics root converts the local cell indices of each heat rank into
+  // indices in coupled_cells_
+  if (comm_.rank == neutronics_root_) {
+    auto offsets = displacements(coupled_cell_counts_);
+    gsl::index k = 0;
+    for (gsl::index r = 0; r < changed_cell_counts_.size(); ++r) {
+      for (int n = 0; n < changed_cell_counts_[r]; ++n, ++k) {
+        coupled_changed_cells_[k] += offsets[r];
+      }
+    }
+  }
+  neutronics.comm_.broadcast(coupled_changed_cells_);
+  if (!shared_memory_) {
+    neutronics.comm_.broadcast(coupled_changed_thermal_state_);
+  }
+
+  if (neutronics.active()) {
+    // Update the stored fields and find the neutronics cells that are affected
+    std::vector<gsl::index> cells;
+    std::vector<gsl::index> fluid_cells;
+    for (gsl::index k = 0; k < coupled_changed_cells_.size(); ++k) {
+      auto i = coupled_changed_cells_[k];
+      if (!shared_memory_) {
+        coupled_thermal_state_[i] = coupled_changed_thermal_state_[k];
+      }
+      cells.push_back(coupled_cell_indices_[i]);
+      if (coupled_cell_fluid_mask_[i] == 1) {
+        fluid_cells.push_back(coupled_cell_indices_[i]);
+      }
+    }
+    for (auto* v : {&cells, &fluid_cells}) {
+      std::sort(v->begin(), v->end());
+      v->erase(std::unique(v->begin(), v->end()), v->end());
+    }
+
+    std::string msg = "Changed cells: " + std::to_string(cells.size()) + " of " +
+                      std::to_string(neutronics_cells_.size());
+    neutronics.comm_.message(msg);
+
+    // Only the affected neutronics cells are set
+    xt::xtensor<double, 1> values;
+    values.resize({coupled_cells_.size()});
+    for (gsl::index i = 0; i < coupled_cells_.size(); ++i) {
+      values(i) = state(i).temperature;
+    }
+    average_over_neutronics_cells(values, cells, neutronics_cell_volume_, false);
+    neutronics.set_temperatures(cells, neutronics_values_);
+
+    for (gsl::index i = 0; i < coupled_cells_.size(); ++i) {
+      values(i) = state(i).density;
+    }
+    average_over_neutronics_cells(values, fluid_cells, neutronics_fluid_volume_, true);
+    neutronics.set_densities(fluid_cells, neutronics_values_);
+  }
+  timer_update_thermal_state.stop();
+}
+
+void CoupledDriver::init_incremental_update()
+{
+  const auto& heat = this->get_heat_driver();
+  const auto& neutronics = this->get_neutronics_driver();
+
+  // The fields set by init_temperature and init_density are what the neutronics
+  // solver has now
+  if (heat.active()) {
+    cell_temperature_sent_ = cell_temperature_;
+    cell_density_sent_ = cell_density_;
+    thermal_state_send_.resize(cell_to_glob_cell_.size());
+    for (gsl::index i = 0; i < thermal_state_send_.size(); ++i) {
+      thermal_state_send_[i] = {cell_temperature_(i), cell_density_(i)};
+    }
+  }
+
+  // With shared memory, the fields of every cell start out in the shared array
+  if (shared_memory_) {
+    if (heat.active()) {
+      std::copy(thermal_state_send_.cbegin(),
+                thermal_state_send_.cend(),
+                shared_thermal_state_.data() + shared_offset_);
+    }
+    auto request = exchange_shared_thermal_state();
+    request.wait();
+    shared_thermal_state_.sync();
+    return;
+  }
+  comm_.gatherv(
+    thermal_state_send_, coupled_thermal_state_, coupled_cell_counts_, neutronics_root_);
+  neutronics.comm_.broadcast(coupled_thermal_state_);
+}
+
+void CoupledDriver::compute_cell_temperature(gsl::span<const double> elem_temperatures,
+                                             bool relax)
+{
+  // Step 1: Assign the current iterate of local cell-avged T to the previous iterate
+  if (relax) {
+    std::copy(
+      cell_temperature_.cbegin(), cell_temperature_.cend(), cell_temperature_prev_.begin());
+  }
+
+  // Step 2: Compute cell-avged T
+  for (gsl::index i = 0; i < cell_to_glob_cell_.size(); ++i) {
+    double T_sum = 0.0;
+    for (auto r = cell_run_offsets_[i]; r < cell_run_offsets_[i + 1]; ++r) {
+      for (auto e = cell_elem_runs_[r].first; e < cell_elem_runs_[r].last; ++e) {
+        T_sum += elem_volume_[e] * elem_temperatures[e];
+      }
+    }
+    double T_avg = T_sum / cell_volume_[i];
+    Ensures(T_avg > 0.0);
+    cell_temperature_(i) = T_avg;
+  }
+
+  // Apply relaxation to local cell-avged T
+  if (relax) {
+    apply_relaxation(
+      *temperature_relaxation_, "Temperature", cell_temperature_, cell_temperature_prev_);
+  }
+}
+
+void CoupledDriver::compute_cell_density(gsl::span<const double> elem_densities,
+                                         bool relax)
+{
+  // Step 1: Assign the current iterate of local cell-avged rho to the previous iterate
+  if (relax) {
+    std::copy(cell_density_.cbegin(), cell_density_.cend(), cell_density_prev_.begin());
+  }
+
+  // Step 2: Compute cell-avged rho
+  for (gsl::index i = 0; i < cell_to_glob_cell_.size(); ++i) {
+    if (cell_fluid_mask_[i] == 1) {
+      double rho_sum = 0.0;
+      for (auto r = cell_run_offsets_[i]; r < cell_run_offsets_[i + 1]; ++r) {
+        for (auto e = cell_elem_runs_[r].first; e < cell_elem_runs_[r].last; ++e) {
+          rho_sum += elem_volume_[e] * elem_densities[e];
+        }
+      }
+      double rho_avg = rho_sum / cell_volume_[i];
+      Ensures(rho_avg > 0.0);
+      cell_density_(i) = rho_avg;
+    }
+  }
+
+  // Apply relaxation to local cell-avged rho
+  if (relax) {
+    apply_relaxation(
+      *density_relaxation_, "Density", cell_density_, cell_density_prev_);
+  }
+}
+
+void CoupledDriver::set_neutronics_temperature(const xt::xtensor<double, 1>& T)
+{
+  const auto& neutronics = this->get_neutronics_driver();
+
+  average_over_neutronics_cells(T, neutronics_cells_, neutronics_cell_volume_, false);
+  neutronics.set_temperatures(neutronics_cells_, neutronics_values_);
+}
+
+void CoupledDriver::set_neutronics_density(const xt::xtensor<double, 1>& rho)
+{
+  const auto& neutronics = this->get_neutronics_driver();
+
+  average_over_neutronics_cells(
+    rho, neutronics_fluid_cells_, neutronics_fluid_volume_, true);
+  neutronics.set_densities(neutronics_fluid_cells_, neutronics_values_);
+}
+
+void CoupledDriver::average_over_neutronics_cells(const xt::xtensor<double, 1>& values,
+                                                  const std::vector<gsl::index>& cells,
+                                                  const std::vector<double>& volumes,
+                                                  bool fluid_only)
+{
+  for (auto j : cells) {
+    neutronics_sum_[j] = 0.0;
+  }
+  for (gsl::index i = 0; i < coupled_cells_.size(); ++i) {
+    if (!fluid_only || coupled_cell_fluid_mask_[i] == 1) {
+      neutronics_sum_[coupled_cell_indices_[i]] += values(i) * coupled_cell_volumes_[i];
+    }
+  }
+
+  neutronics_values_.resize(cells.size());
+  for (gsl::index k = 0; k < cells.size(); ++k) {
+    auto j = cells[k];
+    neutronics_values_[k] = neutronics_sum_[j] / volumes[j];
+  }
+}
+
+void CoupledDriver::init_mapping()
+{
+  comm_.message("Initializing mappings");
+  timer_init_mapping.start();
+  CommStats::Site comm_site("init_mapping");
+
+  const auto& heat = this->get_heat_driver();
+  auto& neutronics = this->get_neutronics_driver();
+
+  // The element centroids stay on the heat ranks, and are streamed to the neutronics
+  // root in chunks by stream_centroids(), concatenated in rank order
+  std::vector<Position> centroids;
+  if (heat.active()) {
+    centroids = heat.centroid();
+  }
+  auto elem_counts = comm_.gather_counts(centroids.size(), neutronics_root_);
+  bool is_root = comm_.rank == neutronics_root_;
+
+  // If the mapping is cached, the neutronics root reads it.  The cache is keyed by the
+  // centroids (including how they are split among the heat ranks) and the geometry.
+  // Each rank hashes its own centroids, and the root combines the hashes in rank order.
+  bool cache_hit = false;
+  std::uint64_t cache_key = HASH_SEED;
+  std::vector<CellHandle> elem_to_cell_send;
+  if (!mapping_cache_.empty()) {
+    std::uint64_t local_hash =
+      hash_bytes(centroids.data(), centroids.size() * sizeof(Position));
+    std::vector<std::uint64_t> rank_hashes(is_root ? comm_.size : 0);
+    comm_.Gather(&local_hash,
+                 1,
+                 MPI_UINT64_T,
+                 rank_hashes.data(),
+                 1,
+                 MPI_UINT64_T,
+                 neutronics_root_);
+    if (is_root) {
+      cache_key = hash_bytes(
+        rank_hashes.data(), rank_hashes.size() * sizeof(std::uint64_t), cache_key);
+      cache_key =
+        hash_bytes(elem_counts.data(), elem_counts.size() * sizeof(int), cache_key);
+      auto geom_hash = neutronics.geometry_hash();
+      cache_key = hash_bytes(&geom_hash, sizeof(geom_hash), cache_key);
+      std::size_t n_elems =
+        std::accumulate(elem_counts.cbegin(), elem_counts.cend(), std::size_t{0});
+      cache_hit = read_mapping_cache(cache_key, n_elems, elem_to_cell_send);
+      if (!cache_hit) {
+        elem_to_cell_send.clear();
+      }
+    }
+    comm_.broadcast(cache_hit, neutronics_root_);
+  }
+
+  // With a cached mapping, one centroid of each cell, in the order in which the cells
+  // were first found, is fetched from the heat rank that holds it and found again to
+  // check the mapping against the geometry.  This also registers the cells with the
+  // neutronics driver in their original order.
+  if (cache_hit) {
+    std::vector<int> rep_counts;
+    std::vector<int> rep_elems;
+    std::vector<CellHandle> representative_cells;
+    if (is_root) {
+      rep_counts.assign(comm_.size, 0);
+      auto elem_displs = displacements(elem_counts);
+      std::unordered_set<CellHandle> seen;
+      int r = 0;
+      for (int e = 0; e < elem_to_cell_send.size(); ++e) {
+        while (e >= elem_displs[r] + elem_counts[r]) {
+          ++r;
+        }
+        if (seen.insert(elem_to_cell_send[e]).second) {
+          rep_elems.push_back(e - elem_displs[r]);
+          ++rep_counts[r];
+          representative_cells.push_back(elem_to_cell_send[e]);
+        }
+      }
+    }
+    std::vector<int> n_reps(1);
+    comm_.scatterv(rep_counts, n_reps, std::vector<int>(comm_.size, 1), neutronics_root_);
+    std::vector<int> local_reps(n_reps[0]);
+    comm_.scatterv(rep_elems, local_reps, rep_counts, neutronics_root_);
+    std::vector<Position> representatives_send;
+    for (auto e : local_reps) {
+      representatives_send.push_back(centroids[e]);
+    }
+    std::vector<Position> representatives;
+    comm_.gatherv(representatives_send, representatives, rep_counts, neutronics_root_);
+
+    if (neutronics.comm_.active()) {
+      auto found = neutronics.find(representatives);
+      if (neutronics.comm_.is_root()) {
+        cache_hit = found == representative_cells;
+        neutronics.comm_.message(cache_hit ? "Using cached mapping from " + mapping_cache_
+                                           : "Cached mapping does not match geometry");
+      }
+    }
+    comm_.broadcast(cache_hit, neutronics_root_);
+  }
+
+  // The neutronics root scatters the mapping of local elem ID --> global cell handle
+  // back to the heat ranks.  Without a cached mapping, the neutronics ranks discover it
+  // chunk by chunk: NeutronicsDriver::find divides the point location among them and
+  // makes the discovered cells known to every neutronics rank.
+  std::vector<CellHandle> elem_to_glob_cell(centroids.size());
+  if (cache_hit) {
+    comm_.scatterv(elem_to_cell_send, elem_to_glob_cell, elem_counts, neutronics_root_);
+  } else {
+    bool write_cache = !mapping_cache_.empty() && is_root;
+    elem_to_cell_send.clear();
+    auto find_chunk = [&](const std::vector<Position>& chunk) {
+      std::vector<CellHandle> cells;
+      if (neutronics.comm_.active()) {
+        cells = neutronics.find(chunk);
+      }
+      if (write_cache) {
+        elem_to_cell_send.insert(elem_to_cell_send.end(), cells.cbegin(), cells.cend());
+      }
+      return cells;
+    };
+    elem_to_glob_cell = stream_centroids(centroids, elem_counts, find_chunk);
+    if (write_cache) {
+      write_mapping_cache(cache_key, elem_to_cell_send);
+    }
+  }
+  elem_to_cell_send = std::vector<CellHandle>{};
+
+  if (heat.active()) {
+    // The heat rank creates a sorted array of global cell handles for its local cells.
+    // This is useful in the coupling.
+    cell_to_glob_cell_ = elem_to_glob_cell;
+    std::sort(cell_to_glob_cell_.begin(), cell_to_glob_cell_.end());
+    cell_to_glob_cell_.erase(std::unique(cell_to_glob_cell_.begin(), cell_to_glob_cell_.end()),
+                             cell_to_glob_cell_.end());
+
+    // The elements are split into runs of consecutive elements in the same cell, and
+    // the local cell index of each run is looked up once
+    std::vector<ElemRun> runs;
+    std::vector<int32_t> run_to_cell;
+    for (int32_t e = 0; e < elem_to_glob_cell.size(); ++e) {
+      if (e == 0 || elem_to_glob_cell[e] != elem_to_glob_cell[e - 1]) {
+        auto it = std::lower_bound(
+          cell_to_glob_cell_.cbegin(), cell_to_glob_cell_.cend(), elem_to_glob_cell[e]);
+        runs.push_back({e, e + 1});
+        run_to_cell.push_back(it - cell_to_glob_cell_.cbegin());
+      } else {
+        ++runs.back().last;
+      }
+    }
+
+    // The heat rank sets the inverse mapping of local cell index -> runs of local
+    // elements as a CSR-style table.  Runs are bucketed by a counting sort, so the
+    // runs of each cell remain in ascending order.
+    cell_run_offsets_.assign(cell_to_glob_cell_.size() + 1, 0);
+    for (auto i : run_to_cell) {
+      ++cell_run_offsets_[i + 1];
+    }
+    std::partial_sum(
+      cell_run_offsets_.cbegin(), cell_run_offsets_.cend(), cell_run_offsets_.begin());
+
+    cell_elem_runs_.resize(runs.size());
+    std::vector<int32_t> pos(cell_run_offsets_.cbegin(), cell_run_offsets_.cend() - 1);
+    for (gsl::index r = 0; r < runs.size(); ++r) {
+      cell_elem_runs_[pos[run_to_cell[r]]++] = runs[r];
+    }
+  }
+
+  // The neutronics ranks keep the local cell handles of every heat rank, so only
+  // field values need to be sent during the Picard iterations
+  coupled_cell_counts_ = comm_.gather_counts(cell_to_glob_cell_.size(), neutronics_root_);
+  comm_.gatherv(cell_to_glob_cell_, coupled_cells_, coupled_cell_counts_, neutronics_root_);
+  neutronics.comm_.broadcast(coupled_cells_);
+
+  // The neutronics ranks look up the index of each coupled cell once, so that
+  // fields can be accumulated into dense arrays during the Picard iterations
+  if (neutronics.active()) {
+    coupled_cell_indices_.resize(coupled_cells_.size());
+    for (gsl::index i = 0; i < coupled_cells_.size(); ++i) {
+      coupled_cell_indices_[i] = neutronics.cell_index(coupled_cells_[i]);
+    }
+    neutronics_cells_ = coupled_cell_indices_;
+    std::sort(neutronics_cells_.begin(), neutronics_cells_.end());
+    neutronics_cells_.erase(std::unique(neutronics_cells_.begin(), neutronics_cells_.end()),
+                            neutronics_cells_.end());
+    neutronics_sum_.assign(neutronics.n_cells(), 0.0);
+  }
+  timer_init_mapping.stop();
+}
+
+void CoupledDriver::init_shared_memory()
+{
+  const auto& neutronics = this->get_neutronics_driver();
+  const auto& heat = this->get_heat_driver();
+
+  // One rank of comm_ per node
+  MPI_Comm temp_comm;
+  int color = intranode_comm_.is_root() ? 0 : MPI_UNDEFINED;
+  MPI_Comm_split(comm_.comm, color, comm_.rank, &temp_comm);
+  node_leader_comm_ = Comm(temp_comm);
+
+  // Number of local cells and node of every rank of comm_
+  int node = node_leader_comm_.rank;
+  intranode_comm_.broadcast(node);
+  int n_local = heat.active() ? static_cast<int>(cell_to_glob_cell_.size()) : 0;
+  std::array<int, 2> local{n_local, node};
+  std::vector<int> ranks(2 * comm_.size);
+  MPI_Allgather(local.data(), 2, MPI_INT, ranks.data(), 2, MPI_INT, comm_.comm);
+
+  // The cells of each node are contiguous in the shared array, so that a node leader
+  // sends them in one block
+  int n_nodes = 0;
+  for (int r = 0; r < comm_.size; ++r) {
+    n_nodes = std::max(n_nodes, ranks[2 * r + 1] + 1);
+  }
+  std::vector<int> node_counts(n_nodes, 0);
+  for (int r = 0; r < comm_.size; ++r) {
+    node_counts[ranks[2 * r + 1]] += ranks[2 * r];
+  }
+  auto node_displs = displacements(node_counts);
+  std::size_t n = std::accumulate(node_counts.begin(), node_counts.end(), std::size_t{0});
+
+  std::vector<std::size_t> offsets(comm_.size);
+  std::vector<std::size_t> next(node_displs.begin(), node_displs.end());
+  for (int r = 0; r < comm_.size; ++r) {
+    offsets[r] = next[ranks[2 * r + 1]];
+    next[ranks[2 * r + 1]] += ranks[2 * r];
+  }
+  shared_offset_ = offsets[comm_.rank];
+
+  // The cells in coupled_cells_ are the local cells of each heat rank in turn
+  if (neutronics.active()) {
+    shared_positions_.clear();
+    shared_positions_.reserve(n);
+    for (int r = 0; r < comm_.size; ++r) {
+      for (int j = 0; j < ranks[2 * r]; ++j) {
+        shared_positions_.push_back(offsets[r] + j);
+      }
+    }
+    Ensures(shared_positions_.size() == coupled_cells_.size());
+  }
+  if (node_leader_comm_.active()) {
+    node_cell_counts_ = node_counts;
+    node_cell_displs_ = node_displs;
+  }
+
+  shared_thermal_state_ = SharedWindow<ThermalState>(intranode_comm_, n);
+}
+
+CommRequest CoupledDriver::exchange_shared_thermal_state()
+{
+  // The stores of the node's heat ranks must be visible to the node leader, which
+  // sends them to the other nodes and receives theirs in place
+  shared_thermal_state_.sync();
+  CommRequest request;
+  if (node_leader_comm_.active() && node_leader_comm_.size > 1) {
+    request.requests_.emplace_back();
+    MPI_Iallgatherv(MPI_IN_PLACE,
+                    0,
+                    MPI_DATATYPE_NULL,
+                    shared_thermal_state_.data(),
+                    node_cell_counts_.data(),
+                    node_cell_displs_.data(),
+                    get_mpi_type<ThermalState>(),
+                    node_leader_comm_.comm,
+                    &request.requests_.back());
+  }
+  return request;
+}
+
+std::vector<CellHandle> CoupledDriver::stream_centroids(
+  const std::vector<Position>& centroids,
+  const std::vector<int>& elem_counts,
+  const std::function<std::vector<CellHandle>(const std::vector<Position>&)>& process)
+{
+  // Global index of the first local element, in rank order, and number of elements
+  std::int64_t n_local = centroids.size();
+  std::int64_t first = 0;
+  std::int64_t n_total = 0;
+  MPI_Exscan(&n_local, &first, 1, MPI_INT64_T, MPI_SUM, comm_.comm);
+  if (comm_.rank == 0) {
+    first = 0;
+  }
+  MPI_Allreduce(&n_local, &n_total, 1, MPI_INT64_T, MPI_SUM, comm_.comm);
+
+  // Offset and number of the elements [begin, begin + n) that fall in chunk k
+  std::int64_t chunk_size = mapping_chunk_size_;
+  auto chunk_part = [chunk_size](std::int64_t k, std::int64_t begin, std::int64_t n) {
+    auto lo = std::max(k * chunk_size, begin);
+    auto hi = std::min((k + 1) * chunk_size, begin + n);
+    return std::make_pair(lo - begin, std::max<std::int64_t>(hi - lo, 0));
+  };
+
+  // Number of elements of each rank in chunk k (significant at the neutronics root)
+  bool is_root = comm_.rank == neutronics_root_;
+  std::vector<int> elem_displs;
+  if (is_root) {
+    elem_displs = displacements(elem_counts);
+  }
+  auto chunk_counts = [&](std::int64_t k) {
+    std::vector<int> counts;
+    if (is_root) {
+      for (int r = 0; r < comm_.size; ++r) {
+        counts.push_back(chunk_part(k, elem_displs[r], elem_counts[r]).second);
+      }
+    }
+    return counts;
+  };
+
+  // Two buffers of each kind: chunk k uses buffers k % 2, so that the transfers of the
+  // neighboring chunks don't touch them while chunk k is processed
+  std::array<std::vector<Position>, 2> centroids_send;
+  std::array<std::vector<Position>, 2> centroids_recv;
+  std::array<std::vector<CellHandle>, 2> cells_send;
+  std::array<std::vector<CellHandle>, 2> cells_recv;
+  std::vector<CellHandle> local_cells(centroids.size());
+
+  auto start_gather = [&](std::int64_t k) {
+    auto part = chunk_part(k, first, n_local);
+    auto begin = centroids.cbegin() + part.first;
+    centroids_send[k % 2].assign(begin, begin + part.second);
+    return comm_.igatherv(
+      centroids_send[k % 2], centroids_recv[k % 2], chunk_counts(k), neutronics_root_);
+  };
+
+  // Chunk whose cells are being scattered, or -1
+  std::int64_t scattered = -1;
+  CommRequest scatter;
+  auto finish_scatter = [&]() {
+    scatter.wait();
+    if (scattered >= 0) {
+      auto part = chunk_part(scattered, first, n_local);
+      const auto& cells = cells_recv[scattered % 2];
+      std::copy(cells.cbegin(), cells.cend(), local_cells.begin() + part.first);
+      scattered = -1;
+    }
+  };
+
+  // The next chunk is gathered, and the cells of the previous one scattered, while a
+  // chunk is processed
+  std::int64_t n_chunks = (n_total + chunk_size - 1) / chunk_size;
+  CommRequest gather;
+  if (n_chunks > 0) {
+    gather = start_gather(0);
+  }
+  for (std::int64_t k = 0; k < n_chunks; ++k) {
+    gather.wait();
+    if (k + 1 < n_chunks) {
+      gather = start_gather(k + 1);
+    }
+
+    auto cells = process(centroids_recv[k % 2]);
+
+    finish_scatter();
+    cells_send[k % 2] = std::move(cells);
+    cells_recv[k % 2].resize(chunk_part(k, first, n_local).second);
+    scatter = comm_.iscatterv(
+      cells_send[k % 2], cells_recv[k % 2], chunk_counts(k), neutronics_root_);
+    scattered = k;
+  }
+  finish_scatter();
+
+  return local_cells;
+}
+
+bool CoupledDriver::read_mapping_cache(std::uint64_t key,
+                                      std::size_t n_elems,
+                                      std::vector<CellHandle>& elem_to_cell) const
+{
+  std::ifstream file{mapping_cache_, std::ios::binary | std::ios::ate};
+  if (!file) {
+    return false;
+  }
+  std::streamoff file_size = file.tellg();
+  file.seekg(0);
+
+  char magic[sizeof(MAPPING_CACHE_MAGIC)];
+  std::uint64_t file_key;
+  std::uint64_t n;
+  file.read(magic, sizeof(magic));
+  file.read(reinterpret_cast<char*>(&file_key), sizeof(file_key));
+  file.read(reinterpret_cast<char*>(&n), sizeof(n));
+  if (!file || !std::equal(magic, magic + sizeof(magic), MAPPING_CACHE_MAGIC) ||
+      file_key != key) {
+    return false;
+  }
+
+  // A cache of a different number of elements, or a truncated one, is rebuilt
+  std::streamoff header_size = sizeof(magic) + sizeof(file_key) + sizeof(n);
+  if (n != n_elems || file_size != header_size + static_cast<std::streamoff>(
+                                                   n * sizeof(CellHandle))) {
+    return false;
+  }
+
+  elem_to_cell.resize(n);
+  file.read(reinterpret_cast<char*>(elem_to_cell.data()), n * sizeof(CellHandle));
+  return static_cast<bool>(file);
+}
+
+void CoupledDriver::write_mapping_cache(std::uint64_t key,
+                                       const std::vector<CellHandle>& elem_to_cell) const
+{
+  std::ofstream file{mapping_cache_, std::ios::binary | std::ios::trunc};
+  std::uint64_t n = elem_to_cell.size();
+  file.write(MAPPING_CACHE_MAGIC, sizeof(MAPPING_CACHE_MAGIC));
+  file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+  file.write(reinterpret_cast<const char*>(&n), sizeof(n));
+  file.write(reinterpret_cast<const char*>(elem_to_cell.data()), n * sizeof(CellHandle));
+  if (!file) {
+    throw std::runtime_error{"Could not write mapping cache " + mapping_cache_};
+  }
+}
+
+namespace {
+
+//! Fixed-size header at the start of a checkpoint file.  It is followed by the
+//! number of local cells of each rank of the coupled comm, then by each coupled
+//! field over all cells in the order of the ranks, and finally by the fission
+//! source sites.
+struct CheckpointHeader {
+  char magic[8];           //!< CHECKPOINT_MAGIC
+  std::int32_t comm_size;  //!< Size of the coupled comm
+  std::int32_t i_timestep; //!< Index of the time step of the checkpoint
+  std::int32_t i_picard;   //!< Index of the Picard iteration of the checkpoint
+  std::int32_t converged;  //!< Whether the Picard iteration converged
+  double k_eff[2];         //!< k-effective (mean, standard deviation)
+  double k_eff_prev[2];    //!< Previous k-effective (mean, standard deviation)
+  double ppm;              //!< Boron concentration [ppm]
+  double ppm_prev;         //!< Previous boron concentration [ppm]
+  std::uint64_t n_cells;   //!< Number of cells over all heat/fluids ranks
+  std::uint64_t n_sites;   //!< Number of fission source sites over all ranks
+  std::uint64_t site_size; //!< Size of a fission source site in bytes
+};
+
+//! Offset of the fields in a checkpoint file, aligned to 8 bytes
+MPI_Offset checkpoint_fields_offset(int comm_size)
+{
+  MPI_Offset end = sizeof(CheckpointHeader) + comm_size * sizeof(std::int32_t);
+  return (end + 7) / 8 * 8;
+}
+
+//! Throw if an MPI-IO call on a checkpoint file failed
+void checkpoint_chk(int err, const std::string& path)
+{
+  if (err != MPI_SUCCESS) {
+    throw std::runtime_error{"MPI-IO error on checkpoint " + path};
+  }
+}
+
+} // namespace
+
+void CoupledDriver::write_checkpoint(bool converged)
+{
+  comm_.message("Writing checkpoint " + checkpoint_);
+
+  const auto& neutronics = this->get_neutronics_driver();
+  const auto& heat = this->get_heat_driver();
+  const auto& boron = this->get_boron_driver();
+
+  // Local cells of the heat/fluids ranks and fission source sites of the neutronics
+  // ranks
+  std::vector<char> sites;
+  std::uint64_t site_size = 0;
+  if (neutronics.active()) {
+    sites = neutronics.get_source_sites();
+    site_size = neutronics.source_site_size();
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &site_size, 1, MPI_UINT64_T, MPI_MAX, comm_.comm);
+
+  std::array<std::uint64_t, 2> local{heat.active() ? cell_temperature_.size() : 0,
+                                     site_size > 0 ? sites.size() / site_size : 0};
+  std::array<std::uint64_t, 2> offset{0, 0};
+  std::array<std::uint64_t, 2> total;
+  MPI_Exscan(local.data(), offset.data(), 2, MPI_UINT64_T, MPI_SUM, comm_.comm);
+  if (comm_.is_root()) {
+    offset = {0, 0};
+  }
+  MPI_Allreduce(local.data(), total.data(), 2, MPI_UINT64_T, MPI_SUM, comm_.comm);
+  auto cell_counts = comm_.gather_counts(static_cast<int>(local[0]), neutronics_root_);
+
+  // Write to a temporary file so that a job killed while writing leaves the
+  // previous checkpoint intact
+  std::string path = checkpoint_ + ".tmp";
+  MPI_File fh;
+  checkpoint_chk(MPI_File_open(comm_.comm,
+                               path.c_str(),
+                               MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                               MPI_INFO_NULL,
+                               &fh),
+                 path);
+  checkpoint_chk(MPI_File_set_size(fh, 0), path);
+
+  // The neutronics root has k-effective and the boron concentration
+  if (comm_.rank == neutronics_root_) {
+    CheckpointHeader header;
+    std::copy(CHECKPOINT_MAGIC, CHECKPOINT_MAGIC + sizeof(header.magic), header.magic);
+    header.comm_size = comm_.size;
+    header.i_timestep = i_timestep_;
+    header.i_picard = i_picard_;
+    header.converged = converged ? 1 : 0;
+    header.k_eff[0] = k_eff_.mean;
+    header.k_eff[1] = k_eff_.std_dev;
+    header.k_eff_prev[0] = k_eff_prev_.mean;
+    header.k_eff_prev[1] = k_eff_prev_.std_dev;
+    header.ppm = boron.ppm_;
+    header.ppm_prev = boron.ppm_prev_;
+    header.n_cells = total[0];
+    header.n_sites = total[1];
+    header.site_size = site_size;
+    checkpoint_chk(
+      MPI_File_write_at(fh, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE),
+      path);
+    checkpoint_chk(MPI_File_write_at(fh,
+                                     sizeof(header),
+                                     cell_counts.data(),
+                                     cell_counts.size(),
+                                     MPI_INT,
+                                     MPI_STATUS_IGNORE),
+                   path);
+  }
+
+  // Each heat/fluids rank writes its part of each field
+  MPI_Offset fields_offset = checkpoint_fields_offset(comm_.size);
+  const xt::xtensor<double, 1>* fields[] = {&cell_temperature_,
+                                            &cell_temperature_prev_,
+                                            &cell_density_,
+                                            &cell_density_prev_,
+                                            &cell_heat_source_,
+                                            &cell_heat_source_prev_};
+  for (gsl::index f = 0; f < 6; ++f) {
+    MPI_Offset pos = fields_offset + (f * total[0] + offset[0]) * sizeof(double);
+    checkpoint_chk(MPI_File_write_at_all(
+                     fh, pos, fields[f]->data(), local[0], MPI_DOUBLE, MPI_STATUS_IGNORE),
+                   path);
+  }
+
+  // Each neutronics rank writes its fission source sites
+  MPI_Offset sites_offset = fields_offset + 6 * total[0] * sizeof(double);
+  checkpoint_chk(MPI_File_write_at_all(fh,
+                                       sites_offset + offset[1] * site_size,
+                                       sites.data(),
+                                       sites.size(),
+                                       MPI_BYTE,
+                                       MPI_STATUS_IGNORE),
+                 path);
+
+  checkpoint_chk(MPI_File_close(&fh), path);
+
+  // The root renames the file, and every rank learns whether that failed, so that all
+  // of them throw together
+  int renamed = 1;
+  if (comm_.is_root()) {
+    renamed = std::rename(path.c_str(), checkpoint_.c_str()) == 0 ? 1 : 0;
+  }
+  comm_.broadcast(renamed);
+  if (!renamed) {
+    throw std::runtime_error{"Could not write checkpoint " + checkpoint_};
+  }
+}
+
+void CoupledDriver::read_checkpoint()
+{
+  comm_.message("Reading checkpoint " + restart_);
+
+  auto& neutronics = this->get_neutronics_driver();
+  const auto& heat = this->get_heat_driver();
+  auto& boron = this->get_boron_driver();
+
+  MPI_File fh;
+  checkpoint_chk(
+    MPI_File_open(comm_.comm, restart_.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh),
+    restart_);
+
+  CheckpointHeader header;
+  checkpoint_chk(
+    MPI_File_read_at_all(fh, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE),
+    restart_);
+  if (!std::equal(header.magic, header.magic + sizeof(header.magic), CHECKPOINT_MAGIC)) {
+    throw std::runtime_error{restart_ + " is not an ENRICO checkpoint"};
+  }
+  if (header.comm_size != comm_.size) {
+    throw std::runtime_error{"Checkpoint " + restart_ + " was written by " +
+                             std::to_string(header.comm_size) + " ranks"};
+  }
+
+  // The fields are read back in the distribution they were written with
+  std::vector<int> cell_counts(comm_.size);
+  checkpoint_chk(MPI_File_read_at_all(fh,
+                                      sizeof(header),
+                                      cell_counts.data(),
+                                      cell_counts.size(),
+                                      MPI_INT,
+                                      MPI_STATUS_IGNORE),
+                 restart_);
+  int n_local = heat.active() ? cell_temperature_.size() : 0;
+  int mismatch = cell_counts[comm_.rank] != n_local ? 1 : 0;
+  MPI_Allreduce(MPI_IN_PLACE, &mismatch, 1, MPI_INT, MPI_MAX, comm_.comm);
+  if (mismatch) {
+    throw std::runtime_error{"Checkpoint " + restart_ +
+                             " was written for a different distribution of cells"};
+  }
+  auto displs = displacements(cell_counts);
+
+  MPI_Offset fields_offset = checkpoint_fields_offset(comm_.size);
+  xt::xtensor<double, 1>* fields[] = {&cell_temperature_,
+                                      &cell_temperature_prev_,
+                                      &cell_density_,
+                                      &cell_density_prev_,
+                                      &cell_heat_source_,
+                                      &cell_heat_source_prev_};
+  for (gsl::index f = 0; f < 6; ++f) {
+    fields[f]->resize({static_cast<std::size_t>(n_local)});
+    MPI_Offset pos =
+      fields_offset + (f * header.n_cells + displs[comm_.rank]) * sizeof(double);
+    checkpoint_chk(MPI_File_read_at_all(
+                     fh, pos, fields[f]->data(), n_local, MPI_DOUBLE, MPI_STATUS_IGNORE),
+                   restart_);
+  }
+
+  // The fission source sites are split evenly among the neutronics ranks
+  std::vector<char> sites;
+  MPI_Offset sites_pos = fields_offset + 6 * header.n_cells * sizeof(double);
+  bool read_sites = neutronics.active() && header.site_size > 0 &&
+                    header.site_size == neutronics.source_site_size();
+  if (read_sites) {
+    auto site_counts = partition_counts(header.n_sites, neutronics.comm_.size);
+    auto site_displs = displacements(site_counts);
+    sites.resize(site_counts[neutronics.comm_.rank] * header.site_size);
+    sites_pos += site_displs[neutronics.comm_.rank] * header.site_size;
+  }
+  checkpoint_chk(
+    MPI_File_read_at_all(
+      fh, sites_pos, sites.data(), sites.size(), MPI_BYTE, MPI_STATUS_IGNORE),
+    restart_);
+  checkpoint_chk(MPI_File_close(&fh), restart_);
+  if (read_sites) {
+    neutronics.set_source_sites(sites);
+  }
+
+  k_eff_ = {header.k_eff[0], header.k_eff[1]};
+  k_eff_prev_ = {header.k_eff_prev[0], header.k_eff_prev[1]};
+  if (boron_search_) {
+    boron.ppm_ = header.ppm;
+    boron.ppm_prev_ = header.ppm_prev;
+    if (neutronics.active()) {
+      neutronics.set_boron_ppm(boron.fluid_cell_handles_, boron.ppm_, boron.B10_iso_abund_);
+    }
+  }
+
+  // Resume after the iteration of the checkpoint.  The history of Aitken and Anderson
+  // relaxation is not saved, so the first resumed iteration relaxes with the initial
+  // factor and the history builds up again from there.
+  auto resume =
+    resume_point(header.i_timestep, header.i_picard, header.converged, max_picard_iter_);
+  resume_timestep_ = resume.i_timestep;
+  resume_picard_ = resume.i_picard;
+  resumed_ = true;
+
+  if (!header.converged && resume_timestep_ > header.i_timestep) {
+    comm_.message("Time step " + std::to_string(header.i_timestep) +
+                  " of the checkpoint ran its last Picard iteration without "
+                  "converging; resuming at the next time step");
+  }
+
+  std::stringstream msg;
+  msg << "Resuming at i_timestep = " << resume_timestep_
+      << ", i_picard = " << resume_picard_;
+  comm_.message(msg.str());
+}
+
+ResumePoint
+resume_point(int i_timestep, int i_picard, bool converged, int max_picard_iter)
+{
+  if (converged || i_picard + 1 >= max_picard_iter) {
+    return {i_timestep + 1, 0};
+  }
+  return {i_timestep, i_picard + 1};
+}
+
+PicardStep picard_step(bool jacobi_scheme, bool gauss_seidel, bool heat_source_solved)
+{
+  if (!jacobi_scheme || gauss_seidel) {
+    return {false, true, true};
+  }
+  return {true, !heat_source_solved, !heat_source_solved};
+}
+
+void CoupledDriver::init_tallies()
 {
   comm_.message("Initializing tallies");
   timer_init_tallies.start();
+  CommStats::Site comm_site("init_tallies");
 
   auto& neutronics = this->get_neutronics_driver();
   if (neutronics.active()) {
@@ -714,6 +2001,7 @@ void CoupledDriver::init_temperature()
 {
   comm_.message("Initializing temperatures");
   timer_init_temperature.start();
+  CommStats::Site comm_site("init_temperature");
 
   const auto& neutronics = this->get_neutronics_driver();
   const auto& heat = this->get_heat_driver();
@@ -726,22 +2014,16 @@ void CoupledDriver::init_temperature()
   }
 
   if (temperature_ic_ == Initial::neutronics) {
-    // Send and recv buffers
-    decltype(cell_to_glob_cell_) cells_recv;
+    // Send buffer
     decltype(cell_temperature_) cell_temperatures_send;
-    // The neutronics root sends cell T to each heat rank
-    for (const auto& heat_rank : heat_ranks_) {
-      comm_.send_and_recv(cells_recv, neutronics_root_, cell_to_glob_cell_, heat_rank);
-      if (comm_.rank == neutronics_root_) {
-        const auto sz = static_cast<unsigned long>(cells_recv.size());
-        cell_temperatures_send.resize({sz});
-        for (gsl::index i = 0; i < sz; ++i) {
-          cell_temperatures_send.at(i) = neutronics.get_temperature(cells_recv.at(i));
-        }
-      }
-      comm_.send_and_recv(
-        cell_temperature_, heat_rank, cell_temperatures_send, neutronics_root_);
+    // The neutronics root scatters cell T to the heat ranks
+    if (comm_.rank == neutronics_root_) {
+      cell_temperatures_send.resize({coupled_cells_.size()});
+      neutronics.get_temperatures(
+        coupled_cell_indices_, gsl::make_span(cell_temperatures_send.data(), cell_temperatures_send.size()));
     }
+    comm_.scatterv(
+      cell_temperatures_send, cell_temperature_, coupled_cell_counts_, neutronics_root_);
   } else if (temperature_ic_ == Initial::heat) {
     //  We do not want to apply underrelaxation here since, at this point, there is no
     //  previous iterate of temperature.
@@ -760,18 +2042,35 @@ void CoupledDriver::init_volume()
 {
   comm_.message("Initializing volumes");
   timer_init_volume.start();
+  CommStats::Site comm_site("init_volume");
 
   const auto& heat = this->get_heat_driver();
   const auto& neutronics = this->get_neutronics_driver();
 
   if (heat.active()) {
     elem_volume_ = heat.volume();
-    for (const auto& c : cell_to_glob_cell_) {
+    cell_volume_.resize(cell_to_glob_cell_.size());
+    for (gsl::index i = 0; i < cell_to_glob_cell_.size(); ++i) {
       double V = 0.0;
-      for (const auto& e : glob_cell_to_elem_.at(c)) {
-        V += elem_volume_.at(e);
+      for (auto r = cell_run_offsets_[i]; r < cell_run_offsets_[i + 1]; ++r) {
+        for (auto e = cell_elem_runs_[r].first; e < cell_elem_runs_[r].last; ++e) {
+          V += elem_volume_[e];
+        }
       }
-      cell_volume_.push_back(V);
+      cell_volume_[i] = V;
+    }
+  }
+
+  // The neutronics ranks keep the local cell volumes of every heat rank
+  comm_.gatherv(
+    cell_volume_, coupled_cell_volumes_, coupled_cell_counts_, neutronics_root_);
+  neutronics.comm_.broadcast(coupled_cell_volumes_);
+
+  // Total volume mapped to each neutronics cell, used to volume-average fields
+  if (neutronics.active()) {
+    neutronics_cell_volume_.assign(neutronics.n_cells(), 0.0);
+    for (gsl::index i = 0; i < coupled_cells_.size(); ++i) {
+      neutronics_cell_volume_[coupled_cell_indices_[i]] += coupled_cell_volumes_[i];
     }
   }
   timer_init_volume.stop();
@@ -787,16 +2086,10 @@ void CoupledDriver::check_volumes()
   // An array of global cell volumes, which will be accumulated from local cell volumes.
   std::map<CellHandle, double> glob_volumes;
 
-  // Get all local cell volumes from heat ranks and sum them into the global cell volumes.
-  for (const auto& heat_rank : heat_ranks_) {
-    decltype(cell_to_glob_cell_) cells_recv;
-    decltype(cell_volume_) cell_volumes_recv;
-    comm_.send_and_recv(cells_recv, neutronics_root_, cell_to_glob_cell_, heat_rank);
-    comm_.send_and_recv(cell_volumes_recv, neutronics_root_, cell_volume_, heat_rank);
-    if (comm_.rank == neutronics_root_) {
-      for (gsl::index i = 0; i < cells_recv.size(); ++i) {
-        glob_volumes[cells_recv.at(i)] += cell_volumes_recv.at(i);
-      }
+  // Sum the cached local cell volumes from all heat ranks into the global cell volumes.
+  if (comm_.rank == neutronics_root_) {
+    for (gsl::index i = 0; i < coupled_cells_.size(); ++i) {
+      glob_volumes[coupled_cells_[i]] += coupled_cell_volumes_[i];
     }
   }
   comm_.Barrier();
@@ -851,6 +2144,7 @@ void CoupledDriver::init_density()
 {
   comm_.message("Initializing densities");
   timer_init_density.start();
+  CommStats::Site comm_site("init_density");
 
   const auto& neutronics = this->get_neutronics_driver();
   const auto& heat = this->get_heat_driver();
@@ -862,20 +2156,14 @@ void CoupledDriver::init_density()
   }
 
   if (density_ic_ == Initial::neutronics) {
-    decltype(cell_to_glob_cell_) cells_recv;
     decltype(cell_density_) cell_densities_send;
-    for (const auto& heat_rank : heat_ranks_) {
-      comm_.send_and_recv(cells_recv, neutronics_root_, cell_to_glob_cell_, heat_rank);
-      if (comm_.rank == neutronics_root_) {
-        const auto sz = static_cast<unsigned long>(cells_recv.size());
-        cell_densities_send.resize({sz});
-        for (gsl::index i = 0; i < sz; ++i) {
-          cell_densities_send.at(i) = neutronics.get_density(cells_recv.at(i));
-        }
-      }
-      comm_.send_and_recv(
-        cell_density_, heat_rank, cell_densities_send, neutronics_root_);
+    if (comm_.rank == neutronics_root_) {
+      cell_densities_send.resize({coupled_cells_.size()});
+      neutronics.get_densities(
+        coupled_cell_indices_, gsl::make_span(cell_densities_send.data(), cell_densities_send.size()));
     }
+    comm_.scatterv(
+      cell_densities_send, cell_density_, coupled_cell_counts_, neutronics_root_);
   } else if (density_ic_ == Initial::heat) {
     // * We do not want to apply underrelaxation here (and at this point,
     //   there is no previous iterate of density, anyway).
@@ -893,64 +2181,66 @@ void CoupledDriver::init_fluid_mask()
 {
   comm_.message("Initializing cell fluid mask");
   timer_init_fluid_mask.start();
+  CommStats::Site comm_site("init_fluid_mask");
 
   auto& heat = this->get_heat_driver();
+  auto& neutronics = this->get_neutronics_driver();
 
   if (heat.active()) {
     auto elem_fluid_mask = heat.fluid_mask();
-    for (const auto& kv : glob_cell_to_elem_) {
-
-      auto& elems = kv.second;
-      auto in_fluid = elem_fluid_mask.at(elems.at(0));
-      for (gsl::index i = 1; i < elems.size(); ++i) {
-        if (in_fluid != elem_fluid_mask.at(elems.at(i))) {
-          throw std::runtime_error("ENRICO detected a neutronics cell that "
-                                   "contains both fluid and solid T/H elements.");
+    for (gsl::index i = 0; i < cell_to_glob_cell_.size(); ++i) {
+      auto in_fluid = elem_fluid_mask.at(cell_elem_runs_[cell_run_offsets_[i]].first);
+      for (auto r = cell_run_offsets_[i]; r < cell_run_offsets_[i + 1]; ++r) {
+        for (auto e = cell_elem_runs_[r].first; e < cell_elem_runs_[r].last; ++e) {
+          if (in_fluid != elem_fluid_mask.at(e)) {
+            throw std::runtime_error("ENRICO detected a neutronics cell that "
+                                     "contains both fluid and solid T/H elements.");
+          }
         }
       }
       cell_fluid_mask_.push_back(in_fluid);
     }
   }
 
-  // The Boron driver needs to know which cells are fluid cells. That info
-  // currently exists in the heat driver and its nodes as the handles to the
-  // cells and the masks for which are the fluid cells. Therefore, first
-  // convert the format on each heat node, send the pieces to the boron root
-  // where we then recompose the vector, and then broadcast to all boron nodes.
-  if (boron_search_) {
-    auto& boron = this->get_boron_driver();
-    std::vector<CellHandle> local_fluid_cell_handles;
+  // The neutronics ranks keep the local cell fluid mask of every heat rank
+  comm_.gatherv(
+    cell_fluid_mask_, coupled_cell_fluid_mask_, coupled_cell_counts_, neutronics_root_);
+  neutronics.comm_.broadcast(coupled_cell_fluid_mask_);
 
-    // Step 1: Get the fluid cells present on each rank
-    // On each heat rank, build the vector of cell handles for fluid cells
-    if (heat.active()) {
-      for (gsl::index i = 0; i < cell_to_glob_cell_.size(); ++i) {
-        if (cell_fluid_mask_.at(i) == 1) {
-          auto handle = cell_to_glob_cell_.at(i);
-          local_fluid_cell_handles.push_back(handle);
+  // Total fluid volume mapped to each neutronics cell, used to volume-average the
+  // fluid density
+  if (neutronics.active()) {
+    neutronics_fluid_volume_.assign(neutronics.n_cells(), 0.0);
+    for (gsl::index i = 0; i < coupled_cells_.size(); ++i) {
+      if (coupled_cell_fluid_mask_[i] == 1) {
+        auto j = coupled_cell_indices_[i];
+        if (neutronics_fluid_volume_[j] == 0.0) {
+          neutronics_fluid_cells_.push_back(j);
         }
+        neutronics_fluid_volume_[j] += coupled_cell_volumes_[i];
       }
     }
+    std::sort(neutronics_fluid_cells_.begin(), neutronics_fluid_cells_.end());
+  }
 
-    // Step 2: aggregate the data on the boron root node
-    decltype(local_fluid_cell_handles) fluid_cell_handles;
-    for (auto heat_rank : heat_ranks_) {
-      decltype(fluid_cell_handles) temp_vector;
-      comm_.send_and_recv(temp_vector, boron_root_,
-                          local_fluid_cell_handles, heat_rank);
-      if (boron.comm_.is_root()) {
-        // Now append the temporary vector to fluid_cell_handles
-        fluid_cell_handles.insert(fluid_cell_handles.end(),
-                                  temp_vector.begin(), temp_vector.end());
-      }
-    }
-
-    // Step 3: Distribute to all boron nodes
-    boron.comm_.broadcast(fluid_cell_handles);
+  // The Boron driver needs to know which cells are fluid cells. Since the boron
+  // comm is the same as the neutronics comm, the handles of the fluid cells can
+  // be taken directly from the cached cell handles and fluid mask.
+  if (boron_search_) {
+    auto& boron = this->get_boron_driver();
 
-    // Initialize the boron driver's knowledge of the fluid cells
     if (boron.active()) {
+      std::vector<CellHandle> fluid_cell_handles;
+      for (gsl::index i = 0; i < coupled_cells_.size(); ++i) {
+        if (coupled_cell_fluid_mask_[i] == 1) {
+          fluid_cell_handles.push_back(coupled_cells_[i]);
+        }
+      }
+
+      // Initialize the boron driver's and the neutronics driver's knowledge of the
+      // fluid cells
       boron.set_fluid_cells(fluid_cell_handles);
+      neutronics.set_fluid_cells(fluid_cell_handles);
     }
   }
 
@@ -961,6 +2251,7 @@ void CoupledDriver::init_heat_source()
 {
   comm_.message("Initializing heat source");
   timer_init_heat_source.start();
+  CommStats::Site comm_site("init_heat_source");
 
   if (this->heat_fluids_driver_->active()) {
     auto sz = {cell_to_glob_cell_.size()};
@@ -983,6 +2274,16 @@ void CoupledDriver::init_boron() {
   // a boron.active check is not necessary.
   // Further, note that the boron and neutronics comms are the same and
   // therefore no additional broadcast of an updated boron.ppm* is necessary
+  // The boron and neutronics comms are the same, so every rank of the boron comm
+  // knows whether the tallies could be created
+  if (boron_sensitivity_ && neutronics.active()) {
+    boron_sensitivity_ = neutronics.create_boron_tallies();
+    if (!boron_sensitivity_) {
+      neutronics.comm_.message("Boron sensitivity is not available; the boron "
+                               "search uses finite differences");
+    }
+  }
+
   if (neutronics.active()) {
     if (boron.ppm_ >= 0.) {
       neutronics.set_boron_ppm(boron.fluid_cell_handles_, boron.ppm_,
@@ -994,6 +2295,100 @@ void CoupledDriver::init_boron() {
   }
 }
 
+void CoupledDriver::read_comm_plan(CommLayout& layout)
+{
+  pugi::xml_document doc;
+  if (!doc.load_file(comm_plan_.c_str())) {
+    return;
+  }
+  auto root = doc.child("comm_plan");
+  bool same_nodes = root.attribute("total_nodes").as_int() == total_nodes_ &&
+                    root.attribute("node_size").as_int() == node_size_;
+
+  const char* names[] = {"neutronics", "heat_fluids"};
+  for (const int i : {0, 1}) {
+    auto driver_node = root.child(names[i]);
+    if (same_nodes) {
+      layout.num_nodes[i] = driver_node.attribute("nodes").as_int();
+      layout.procs_per_node[i] = driver_node.attribute("procs_per_node").as_int();
+    }
+    // Measured solve times remain valid on a different allocation
+    for (auto s = driver_node.child("sample"); s; s = s.next_sibling("sample")) {
+      comm_samples_[i].push_back({s.attribute("nodes").as_int(),
+                                  s.attribute("procs_per_node").as_int(),
+                                  s.attribute("time").as_double()});
+    }
+  }
+  if (same_nodes) {
+    comm_.message("Using communicator layout planned in " + comm_plan_);
+  }
+}
+
+void CoupledDriver::plan_comms()
+{
+  auto& neutronics = this->get_neutronics_driver();
+  auto& heat = this->get_heat_driver();
+
+  // The timers are zero on ranks outside of the driver comms
+  std::array<double, 2> times{neutronics.timer_solve_step.elapsed(),
+                              heat.timer_solve_step.elapsed()};
+  MPI_Allreduce(MPI_IN_PLACE, times.data(), 2, MPI_DOUBLE, MPI_MAX, comm_.comm);
+
+  // Fit the scaling of each driver to the times measured with its procs/node
+  std::array<double, 2> scaling;
+  for (const int i : {0, 1}) {
+    comm_samples_[i].push_back(
+      {comm_layout_.num_nodes[i], comm_layout_.procs_per_node[i], times[i]});
+    std::vector<std::pair<int, double>> samples;
+    for (const auto& sample : comm_samples_[i]) {
+      if (sample.procs_per_node == comm_layout_.procs_per_node[i] && sample.time > 0.0) {
+        samples.emplace_back(sample.nodes, sample.time);
+      }
+    }
+    scaling[i] = fit_strong_scaling(samples);
+  }
+
+  bool concurrent = coupling_scheme_ == CouplingScheme::jacobi;
+  auto plan =
+    plan_driver_comms(total_nodes_, node_size_, comm_layout_, times, scaling, concurrent);
+
+  const char* names[] = {"neutronics", "heat_fluids"};
+  std::stringstream msg;
+  msg << "Communicator plan for " << total_nodes_ << " nodes (predicted solve time "
+      << std::scientific << std::setprecision(4) << plan.time << " s):";
+  comm_.message(msg.str());
+  for (const int i : {0, 1}) {
+    std::stringstream msg;
+    msg << "  " << names[i] << ": " << plan.num_nodes[i] << " nodes, "
+        << plan.procs_per_node[i] << " procs/node (measured " << std::scientific
+        << std::setprecision(4) << times[i] << " s on " << comm_layout_.num_nodes[i]
+        << " nodes, scaling exponent " << std::fixed << std::setprecision(2)
+        << scaling[i] << ")";
+    comm_.message(msg.str());
+  }
+
+  if (comm_.is_root()) {
+    std::ofstream out(comm_plan_);
+    if (!out) {
+      throw std::runtime_error{"Could not write communicator plan " + comm_plan_};
+    }
+    out << std::setprecision(17);
+    out << "<?xml version=\"1.0\"?>\n";
+    out << "<comm_plan total_nodes=\"" << total_nodes_ << "\" node_size=\"" << node_size_
+        << "\">\n";
+    for (const int i : {0, 1}) {
+      out << "  <" << names[i] << " nodes=\"" << plan.num_nodes[i]
+          << "\" procs_per_node=\"" << plan.procs_per_node[i] << "\">\n";
+      for (const auto& sample : comm_samples_[i]) {
+        out << "    <sample nodes=\"" << sample.nodes << "\" procs_per_node=\""
+            << sample.procs_per_node << "\" time=\"" << sample.time << "\"/>\n";
+      }
+      out << "  </" << names[i] << ">\n";
+    }
+    out << "</comm_plan>\n";
+  }
+}
+
 void CoupledDriver::comm_report()
 {
   if (!verbose_)
@@ -1028,36 +2423,46 @@ void CoupledDriver::comm_report()
   }
 }
 
-void CoupledDriver::timer_report()
+std::vector<CoupledDriver::TimedRegion> CoupledDriver::timed_regions()
 {
-
   auto& heat = this->get_heat_driver();
   auto& neut = this->get_neutronics_driver();
 
-  std::vector<TimeAmt> coup_times{
-    {"init_comms", timer_init_comms.elapsed()},
-    {"init_fluid_mask", timer_init_fluid_mask.elapsed()},
-    {"init_density", timer_init_density.elapsed()},
-    {"init_heat_source", timer_init_heat_source.elapsed()},
-    {"init_mapping", timer_init_mapping.elapsed()},
-    {"init_tallies", timer_init_tallies.elapsed()},
-    {"init_temperature", timer_init_temperature.elapsed()},
-    {"init_volume", timer_init_volume.elapsed()},
-    {"update_density", timer_update_density.elapsed()},
-    {"update_heat_source", timer_update_heat_source.elapsed()},
-    {"update_temperature", timer_update_temperature.elapsed()}};
-
-  std::vector<TimeAmt> heat_times{{"driver_setup", heat.timer_driver_setup.elapsed()},
-                                  {"init_step", heat.timer_init_step.elapsed()},
-                                  {"solve_step", heat.timer_solve_step.elapsed()},
-                                  {"write_step", heat.timer_write_step.elapsed()},
-                                  {"finalize_step", heat.timer_finalize_step.elapsed()}};
-
-  std::vector<TimeAmt> neut_times{{"driver_setup", neut.timer_driver_setup.elapsed()},
-                                  {"init_step", neut.timer_init_step.elapsed()},
-                                  {"solve_step", neut.timer_solve_step.elapsed()},
-                                  {"write_step", neut.timer_write_step.elapsed()},
-                                  {"finalize_step", neut.timer_finalize_step.elapsed()}};
+  return {{"CoupledDriver", "init_comms", &timer_init_comms},
+          {"CoupledDriver", "init_fluid_mask", &timer_init_fluid_mask},
+          {"CoupledDriver", "init_density", &timer_init_density},
+          {"CoupledDriver", "init_heat_source", &timer_init_heat_source},
+          {"CoupledDriver", "init_mapping", &timer_init_mapping},
+          {"CoupledDriver", "init_tallies", &timer_init_tallies},
+          {"CoupledDriver", "init_temperature", &timer_init_temperature},
+          {"CoupledDriver", "init_volume", &timer_init_volume},
+          {"CoupledDriver", "update_density", &timer_update_density},
+          {"CoupledDriver", "update_heat_source", &timer_update_heat_source},
+          {"CoupledDriver", "update_temperature", &timer_update_temperature},
+          {"CoupledDriver", "update_thermal_state", &timer_update_thermal_state},
+          {"NeutronicsDriver", "driver_setup", &neut.timer_driver_setup},
+          {"NeutronicsDriver", "init_step", &neut.timer_init_step},
+          {"NeutronicsDriver", "solve_step", &neut.timer_solve_step},
+          {"NeutronicsDriver", "write_step", &neut.timer_write_step},
+          {"NeutronicsDriver", "finalize_step", &neut.timer_finalize_step},
+          {"HeatFluidsDriver", "driver_setup", &heat.timer_driver_setup},
+          {"HeatFluidsDriver", "init_step", &heat.timer_init_step},
+          {"HeatFluidsDriver", "solve_step", &heat.timer_solve_step},
+          {"HeatFluidsDriver", "write_step", &heat.timer_write_step},
+          {"HeatFluidsDriver", "finalize_step", &heat.timer_finalize_step}};
+}
+
+void CoupledDriver::timer_report()
+{
+  auto regions = this->timed_regions();
+
+  std::map<std::string, std::vector<TimeAmt>> times;
+  for (const auto& r : regions) {
+    times[r.driver].emplace_back(r.name, r.timer->elapsed());
+  }
+  auto& coup_times = times["CoupledDriver"];
+  auto& heat_times = times["HeatFluidsDriver"];
+  auto& neut_times = times["NeutronicsDriver"];
 
   auto tot_time = TimeAmt::sum_times(coup_times) + TimeAmt::sum_times(heat_times) +
                   TimeAmt::sum_times(neut_times);
@@ -1078,6 +2483,175 @@ void CoupledDriver::timer_report()
                  TimeAmt::sum_percent(neut_times);
   std::vector<TimeAmt> total_time{{"total", tot_time, tot_pct}};
   TimeAmt::print_times("Total", total_time, comm_);
+
+  if (CommStats::enabled()) {
+    comm_stats_report(regions);
+  }
+
+  // The elapsed times are the same on all ranks of a timer's comm, since the timers
+  // wait for all of them.  The busy times before that wait show the load imbalance.
+  // The busy times of each driver's timers are reduced over the ranks of that driver
+  // only, and sent to the root of comm_ to be printed.
+  struct DriverComm {
+    std::string driver; // Name of the driver, as in TimedRegion
+    const Comm* comm;   // Comm of the driver's timers
+    int root;           // Rank in comm_ of the root of comm
+  };
+  const auto& heat = this->get_heat_driver();
+  const auto& neutronics = this->get_neutronics_driver();
+  std::vector<DriverComm> driver_comms{
+    {"CoupledDriver", &comm_, 0},
+    {"NeutronicsDriver", &neutronics.comm_, neutronics_root_},
+    {"HeatFluidsDriver", &heat.comm_, heat_root_}};
+
+  comm_.message("  Busy time across ranks (seconds: min, mean, max)");
+  for (const auto& d : driver_comms) {
+    std::vector<gsl::index> indices;
+    for (gsl::index i = 0; i < regions.size(); ++i) {
+      if (regions[i].driver == d.driver) {
+        indices.push_back(i);
+      }
+    }
+    auto m = indices.size();
+
+    // Minimum, sum and maximum of the busy time of each timer
+    std::vector<double> stats(3 * m);
+    if (d.comm->active()) {
+      std::vector<double> busy(m);
+      for (gsl::index j = 0; j < m; ++j) {
+        busy[j] = regions[indices[j]].timer->busy();
+      }
+      MPI_Reduce(busy.data(), &stats[0], m, MPI_DOUBLE, MPI_MIN, 0, d.comm->comm);
+      MPI_Reduce(busy.data(), &stats[m], m, MPI_DOUBLE, MPI_SUM, 0, d.comm->comm);
+      MPI_Reduce(busy.data(), &stats[2 * m], m, MPI_DOUBLE, MPI_MAX, 0, d.comm->comm);
+    }
+    int n_ranks = d.comm->size;
+    comm_.send_and_recv(n_ranks, 0, d.root);
+    comm_.send_and_recv(stats, 0, d.root);
+
+    if (comm_.is_root()) {
+      for (gsl::index j = 0; j < m; ++j) {
+        if (stats[2 * m + j] == 0.0) {
+          continue;
+        }
+        const auto& region = regions[indices[j]];
+        std::stringstream msg;
+        msg << "    " << std::setw(40) << std::left << region.driver + "::" + region.name
+            << std::right << std::scientific << std::setprecision(4) << stats[j] << "  "
+            << stats[m + j] / n_ranks << "  " << stats[2 * m + j];
+        comm_.message(msg.str());
+      }
+    }
+  }
+}
+
+void CoupledDriver::comm_stats_report(const std::vector<TimedRegion>& regions)
+{
+  // The communication of each CoupledDriver member function is counted under its name.
+  // The sums over all ranks are taken together with the counts of the neutronics
+  // root, which are zero on the other ranks.
+  std::vector<std::string> sites;
+  for (const auto& r : regions) {
+    if (r.driver == "CoupledDriver") {
+      sites.push_back(r.name);
+    }
+  }
+  auto n = sites.size();
+  std::vector<double> local(6 * n, 0.0);
+  for (gsl::index i = 0; i < n; ++i) {
+    auto c = CommStats::counts(sites[i]);
+    local[3 * i] = c.messages;
+    local[3 * i + 1] = c.bytes;
+    local[3 * i + 2] = c.wait;
+    if (comm_.rank == neutronics_root_) {
+      local[3 * (n + i)] = c.messages;
+      local[3 * (n + i) + 1] = c.bytes;
+      local[3 * (n + i) + 2] = c.wait;
+    }
+  }
+  std::vector<double> sum(6 * n);
+  std::vector<double> max(3 * n);
+  MPI_Reduce(local.data(), sum.data(), 6 * n, MPI_DOUBLE, MPI_SUM, 0, comm_.comm);
+  MPI_Reduce(local.data(), max.data(), 3 * n, MPI_DOUBLE, MPI_MAX, 0, comm_.comm);
+
+  if (!comm_.is_root()) {
+    return;
+  }
+  comm_.message("  Communication per rank (mean / max; neutronics root)");
+  for (gsl::index i = 0; i < n; ++i) {
+    if (sum[3 * i] == 0.0) {
+      continue;
+    }
+    const double* mean = &sum[3 * i];
+    const double* root = &sum[3 * (n + i)];
+    std::stringstream msg;
+    msg << "    " << std::setw(22) << std::left << sites[i] << std::right
+        << std::scientific << std::setprecision(4) << "messages " << mean[0] / comm_.size
+        << " / " << max[3 * i] << "; " << root[0] << "  bytes " << mean[1] / comm_.size
+        << " / " << max[3 * i + 1] << "; " << root[1] << "  wait (s) "
+        << mean[2] / comm_.size << " / " << max[3 * i + 2] << "; " << root[2];
+    comm_.message(msg.str());
+  }
+}
+
+void CoupledDriver::write_timing_trace()
+{
+  auto regions = this->timed_regions();
+
+  // Each interval is sent as the index of its region followed by its times in
+  // microseconds since the origin of the trace
+  std::vector<double> intervals;
+  for (gsl::index i = 0; i < regions.size(); ++i) {
+    for (const auto& s : regions[i].timer->samples()) {
+      intervals.insert(intervals.end(),
+                       {static_cast<double>(i),
+                        1.0e6 * (s.start - trace_origin_),
+                        1.0e6 * (s.busy - trace_origin_),
+                        1.0e6 * (s.stop - trace_origin_)});
+    }
+  }
+  auto counts = comm_.gather_counts(intervals.size());
+  std::vector<double> all_intervals;
+  comm_.gatherv(intervals, all_intervals, counts);
+
+  if (!comm_.is_root()) {
+    return;
+  }
+
+  comm_.message("Writing timing trace " + timing_trace_);
+  std::ofstream out(timing_trace_);
+  if (!out) {
+    throw std::runtime_error{"Could not write timing trace " + timing_trace_};
+  }
+
+  // Each rank is a thread of one process, so that the ranks are shown one above the
+  // other.  An interval is a complete event, with a nested "wait" event for the time
+  // the rank spent waiting on the others at its end.
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  auto begin = all_intervals.cbegin();
+  for (int rank = 0; rank < comm_.size; ++rank) {
+    out << (rank == 0 ? "" : ",\n") << "  {\"name\": \"thread_name\", \"ph\": \"M\", "
+        << "\"pid\": 0, \"tid\": " << rank << ", \"args\": {\"name\": \"rank "
+        << rank << "\"}}";
+    for (auto it = begin; it != begin + counts[rank]; it += 4) {
+      const auto& r = regions[static_cast<gsl::index>(it[0])];
+      double start = it[1];
+      double busy = it[2];
+      double stop = it[3];
+      out << ",\n  {\"name\": \"" << r.name << "\", \"cat\": \"" << r.driver
+          << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << rank
+          << ", \"ts\": " << start << ", \"dur\": " << stop - start
+          << ", \"args\": {\"busy_us\": " << busy - start << "}}";
+      if (stop > busy) {
+        out << ",\n  {\"name\": \"wait\", \"cat\": \"" << r.driver
+            << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << rank
+            << ", \"ts\": " << busy << ", \"dur\": " << stop - busy << "}";
+      }
+    }
+    begin += counts[rank];
+  }
+  out << "\n]}\n";
 }
 
 } // namespace enrico
@@ -1,9 +1,12 @@
 #include "enrico/heat_fluids_driver.h"
 
+#include "iapws/iapws.h"
 #include <gsl/gsl-lite.hpp>
 #include <pugixml.hpp>
 #include <xtensor/xadapt.hpp>
 
+#include <algorithm> // for min
+
 namespace enrico {
 
 HeatFluidsDriver::HeatFluidsDriver(MPI_Comm comm, pugi::xml_node node)
@@ -11,6 +14,76 @@ HeatFluidsDriver::HeatFluidsDriver(MPI_Comm comm, pugi::xml_node node)
 {
   pressure_bc_ = node.child("pressure_bc").text().as_double();
   Expects(pressure_bc_ > 0.0);
+
+  if (node.child("property_table_tolerance")) {
+    property_table_tol_ = node.child("property_table_tolerance").text().as_double();
+    Expects(property_table_tol_ > 0.0);
+  }
+}
+
+void HeatFluidsDriver::init_specific_volume_table()
+{
+  if (property_table_tol_ > 0.0) {
+    // Liquid water (IAPWS region 1) from the triple point to saturation
+    double T_max = std::min(iapws::sat_temp(pressure_bc_), 623.15);
+    specific_volume_table_ = std::make_shared<PropertyTable>(
+      iapws::nu1, pressure_bc_, pressure_bc_, 273.16, T_max, property_table_tol_);
+  }
+}
+
+void HeatFluidsDriver::set_heat_sources(gsl::span<const double> heat)
+{
+  Expects(heat.size() == this->n_local_elem());
+  for (gsl::index i = 0; i < heat.size(); ++i) {
+    this->set_heat_source_at(i, heat[i]);
+  }
+}
+
+std::vector<double> HeatFluidsDriver::temperature() const
+{
+  std::vector<double> T(this->n_local_elem());
+  this->temperature(T);
+  return T;
+}
+
+std::vector<double> HeatFluidsDriver::density() const
+{
+  std::vector<double> rho(this->n_local_elem());
+  this->density(rho);
+  return rho;
+}
+
+void HeatFluidsDriver::thermal_state(gsl::span<double> T, gsl::span<double> rho) const
+{
+  this->temperature(T);
+  this->density(rho);
+}
+
+std::vector<int> HeatFluidsDriver::fluid_mask() const
+{
+  std::vector<int> mask(this->n_local_elem());
+  this->fluid_mask(mask);
+  return mask;
+}
+
+std::vector<Position> HeatFluidsDriver::centroid() const
+{
+  std::vector<Position> centroids(this->n_local_elem());
+  this->centroid(centroids);
+  return centroids;
+}
+
+std::vector<double> HeatFluidsDriver::volume() const
+{
+  std::vector<double> volumes(this->n_local_elem());
+  this->volume(volumes);
+  return volumes;
+}
+
+double HeatFluidsDriver::specific_volume(double T) const
+{
+  return specific_volume_table_ ? (*specific_volume_table_)(pressure_bc_, T)
+                                : iapws::nu1(pressure_bc_, T);
 }
 
 }
@@ -8,13 +8,6 @@
 
 int main(int argc, char* argv[])
 {
-  // Initialize MPI
-  MPI_Init(&argc, &argv);
-  enrico::init_mpi_datatypes();
-
-  // Define enums for selecting drivers
-  enum class Transport { OpenMC, Shift, Surrogate };
-
   // Parse enrico.xml file
   pugi::xml_document doc;
   auto result = doc.load_file("enrico.xml");
@@ -25,6 +18,16 @@ int main(int argc, char* argv[])
   // Get root element
   auto root = doc.document_element();
 
+  // Initialize MPI.  Background OpenMC output makes MPI calls from a second thread.
+  bool output_async = root.child("neutronics").child("output_async").text().as_bool();
+  int required = output_async ? MPI_THREAD_MULTIPLE : MPI_THREAD_SINGLE;
+  int provided;
+  MPI_Init_thread(&argc, &argv, required, &provided);
+  enrico::init_mpi_datatypes();
+
+  // Define enums for selecting drivers
+  enum class Transport { OpenMC, Shift, Surrogate };
+
   // Determine transport driver
   auto neut_driver = std::string{root.child("neutronics").child_value("driver")};
   auto heat_driver = std::string{root.child("heat_fluids").child_value("driver")};
@@ -42,13 +45,11 @@ int main(int argc, char* argv[])
   // Create driver according to selections
   switch (driver_transport) {
   case Transport::OpenMC:
-  case Transport::Shift: {
+  case Transport::Shift:
+  case Transport::Surrogate: {
     enrico::CoupledDriver driver{MPI_COMM_WORLD, root};
     driver.execute();
   } break;
-  case Transport::Surrogate:
-    throw std::runtime_error{"No surrogate particle transport driver implemented"};
-    break;
   }
 
   enrico::free_mpi_datatypes();
@@ -1,6 +1,7 @@
 #include "enrico/mpi_types.h"
 
 #include "enrico/geom.h"
+#include "enrico/thermal_state.h"
 
 #include <mpi.h>
 
@@ -11,6 +12,7 @@ namespace enrico {
 //==============================================================================
 
 MPI_Datatype position_mpi_datatype{MPI_DATATYPE_NULL};
+MPI_Datatype thermal_state_mpi_datatype{MPI_DATATYPE_NULL};
 
 //==============================================================================
 // Functions
@@ -36,11 +38,32 @@ void init_mpi_datatypes()
   // Make datatype
   MPI_Type_create_struct(3, blockcounts, displs, types, &position_mpi_datatype);
   MPI_Type_commit(&position_mpi_datatype);
+
+  // Make datatype for ThermalState, resized to the extent of the struct so that
+  // arrays of ThermalState can be sent
+  ThermalState s;
+  int state_blockcounts[2] = {1, 1};
+  MPI_Datatype state_types[2] = {MPI_DOUBLE, MPI_DOUBLE};
+  MPI_Aint state_displs[2];
+  MPI_Aint base;
+
+  MPI_Get_address(&s, &base);
+  MPI_Get_address(&s.temperature, &state_displs[0]);
+  MPI_Get_address(&s.density, &state_displs[1]);
+  state_displs[0] -= base;
+  state_displs[1] -= base;
+
+  MPI_Datatype tmp;
+  MPI_Type_create_struct(2, state_blockcounts, state_displs, state_types, &tmp);
+  MPI_Type_create_resized(tmp, 0, sizeof(ThermalState), &thermal_state_mpi_datatype);
+  MPI_Type_commit(&thermal_state_mpi_datatype);
+  MPI_Type_free(&tmp);
 }
 
 void free_mpi_datatypes()
 {
   MPI_Type_free(&position_mpi_datatype);
+  MPI_Type_free(&thermal_state_mpi_datatype);
 }
 
 // Traits for mapping plain types to corresponding MPI types (ints)
@@ -109,5 +132,10 @@ MPI_Datatype get_mpi_type<Position>()
 {
   return position_mpi_datatype;
 }
+template<>
+MPI_Datatype get_mpi_type<ThermalState>()
+{
+  return thermal_state_mpi_datatype;
+}
 
 } // namespace enrico
@@ -2,7 +2,6 @@
 
 #include "enrico/error.h"
 #include "gsl/gsl-lite.hpp"
-#include "iapws/iapws.h"
 #include "nek5000/core/nek_interface.h"
 #include "xtensor/xadapt.hpp"
 
@@ -14,6 +13,24 @@
 
 namespace enrico {
 
+namespace {
+
+//! Check the result of a Nek5000 call for a local element.  These calls are made for
+//! every element, so the error message is only built when the call failed.
+//!
+//! \param err Error code returned by Nek5000
+//! \param what Quantity that was requested
+//! \param local_elem A local element ID
+void check_elem(int err, const char* what, int32_t local_elem)
+{
+  if (err < E_SUCCESS) {
+    throw std::runtime_error(std::string("Could not find ") + what +
+                             " of local element " + std::to_string(local_elem));
+  }
+}
+
+} // namespace
+
 Nek5000Driver::Nek5000Driver(MPI_Comm comm, pugi::xml_node node)
   : HeatFluidsDriver(comm, node)
 {
@@ -23,6 +40,7 @@ Nek5000Driver::Nek5000Driver(MPI_Comm comm, pugi::xml_node node)
     if (node.child("output_heat_source")) {
       output_heat_source_ = node.child("output_heat_source").text().as_bool();
     }
+    init_specific_volume_table();
 
     if (comm_.rank == 0) {
       init_session_name();
@@ -61,41 +79,53 @@ void Nek5000Driver::init_session_name()
   session_name.close();
 }
 
-std::vector<double> Nek5000Driver::temperature() const
+void Nek5000Driver::temperature(gsl::span<double> T) const
 {
-  // Each Nek proc finds the temperatures of its local elements
-  std::vector<double> local_elem_temperatures(nelt_);
+  Expects(T.size() == nelt_);
+
+  // Each Nek proc finds the temperatures of its local elements, each directly into
+  // the output buffer
   for (int32_t i = 0; i < nelt_; ++i) {
-    local_elem_temperatures[i] = this->temperature_at(i);
+    check_elem(nek_get_local_elem_temperature(i + 1, &T[i]), "temperature", i);
   }
-
-  return local_elem_temperatures;
 }
 
-std::vector<int> Nek5000Driver::fluid_mask() const
+void Nek5000Driver::fluid_mask(gsl::span<int> mask) const
 {
-  std::vector<int> local_fluid_mask(nelt_);
+  Expects(mask.size() == nelt_);
   for (int32_t i = 0; i < nelt_; ++i) {
-    local_fluid_mask[i] = this->in_fluid_at(i);
+    mask[i] = nek_local_elem_is_in_fluid(i + 1);
   }
-  return local_fluid_mask;
 }
 
-std::vector<double> Nek5000Driver::density() const
+void Nek5000Driver::density(gsl::span<double> rho) const
 {
-  std::vector<double> local_densities(nelt_);
+  Expects(rho.size() == nelt_);
 
   for (int32_t i = 0; i < nelt_; ++i) {
-    if (this->in_fluid_at(i) == 1) {
-      auto T = this->temperature_at(i);
+    if (nek_local_elem_is_in_fluid(i + 1) == 1) {
+      double T;
+      check_elem(nek_get_local_elem_temperature(i + 1, &T), "temperature", i);
       // nu1 returns specific volume in [m^3/kg]
-      local_densities[i] = 1.0e-3 / iapws::nu1(pressure_bc_, T);
+      rho[i] = 1.0e-3 / this->specific_volume(T);
     } else {
-      local_densities[i] = 0.0;
+      rho[i] = 0.0;
     }
   }
+}
 
-  return local_densities;
+void Nek5000Driver::thermal_state(gsl::span<double> T, gsl::span<double> rho) const
+{
+  Expects(T.size() == nelt_);
+  Expects(rho.size() == nelt_);
+
+  // The temperature of each element is found once and gives its density as well
+  for (int32_t i = 0; i < nelt_; ++i) {
+    check_elem(nek_get_local_elem_temperature(i + 1, &T[i]), "temperature", i);
+    // nu1 returns specific volume in [m^3/kg]
+    rho[i] =
+      nek_local_elem_is_in_fluid(i + 1) == 1 ? 1.0e-3 / this->specific_volume(T[i]) : 0.0;
+  }
 }
 
 void Nek5000Driver::solve_step()
@@ -109,44 +139,42 @@ void Nek5000Driver::solve_step()
 Position Nek5000Driver::centroid_at(int32_t local_elem) const
 {
   double x, y, z;
-  err_chk(nek_get_local_elem_centroid(local_elem + 1, &x, &y, &z),
-          "Could not find centroid of local element " + std::to_string(local_elem));
+  check_elem(
+    nek_get_local_elem_centroid(local_elem + 1, &x, &y, &z), "centroid", local_elem);
   return {x, y, z};
 }
 
-std::vector<Position> Nek5000Driver::centroid() const
+void Nek5000Driver::centroid(gsl::span<Position> centroids) const
 {
   int n_local = this->n_local_elem();
-  std::vector<Position> local_element_centroids(n_local);
+  Expects(centroids.size() == n_local);
   for (int32_t i = 0; i < n_local; ++i) {
-    local_element_centroids[i] = this->centroid_at(i);
+    auto& c = centroids[i];
+    check_elem(nek_get_local_elem_centroid(i + 1, &c.x, &c.y, &c.z), "centroid", i);
   }
-  return local_element_centroids;
 }
 
 double Nek5000Driver::volume_at(int32_t local_elem) const
 {
   double volume;
-  err_chk(nek_get_local_elem_volume(local_elem + 1, &volume),
-          "Could not find volume of local element " + std::to_string(local_elem));
+  check_elem(nek_get_local_elem_volume(local_elem + 1, &volume), "volume", local_elem);
   return volume;
 }
 
-std::vector<double> Nek5000Driver::volume() const
+void Nek5000Driver::volume(gsl::span<double> volumes) const
 {
   int n_local = this->n_local_elem();
-  std::vector<double> local_elem_volumes(n_local);
+  Expects(volumes.size() == n_local);
   for (int32_t i = 0; i < n_local; ++i) {
-    local_elem_volumes[i] = this->volume_at(i);
+    check_elem(nek_get_local_elem_volume(i + 1, &volumes[i]), "volume", i);
   }
-  return local_elem_volumes;
 }
 
 double Nek5000Driver::temperature_at(int32_t local_elem) const
 {
   double temperature;
-  err_chk(nek_get_local_elem_temperature(local_elem + 1, &temperature),
-          "Could not find temperature of local element " + std::to_string(local_elem));
+  int err = nek_get_local_elem_temperature(local_elem + 1, &temperature);
+  check_elem(err, "temperature", local_elem);
   return temperature;
 }
 
@@ -161,6 +189,14 @@ int Nek5000Driver::set_heat_source_at(int32_t local_elem, double heat)
   return nek_set_heat_source(local_elem + 1, heat);
 }
 
+void Nek5000Driver::set_heat_sources(gsl::span<const double> heat)
+{
+  Expects(heat.size() == nelt_);
+  for (int32_t i = 0; i < nelt_; ++i) {
+    err_chk(nek_set_heat_source(i + 1, heat[i]), "Could not set heat source");
+  }
+}
+
 void Nek5000Driver::write_step(int timestep, int iteration)
 {
   nek_write_step(int(output_heat_source_));
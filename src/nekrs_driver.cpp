@@ -1,7 +1,6 @@
 #include "enrico/nekrs_driver.h"
 #include "enrico/error.h"
 #include "fldFile.hpp"
-#include "iapws/iapws.h"
 #include "nekInterfaceAdapter.hpp"
 #include "nekrs.hpp"
 
@@ -11,9 +10,71 @@
 #include "nekrs_home.h"
 
 #include <algorithm>
+#include <cmath>
 #include <dlfcn.h>
+#include <utility> // for swap
 
 namespace enrico {
+
+namespace {
+
+//! OKL kernels for the element-wise coupling operations. The average gives each
+//! element block a shared-memory reduction over its GLL points; the broadcast writes
+//! one value per element to all of its GLL points.  The fields are in dfloat, as in
+//! nekRS and the UDF.
+const std::string element_kernels = R"(
+#define ENRICO_BLOCK 256
+
+@kernel void elementAverage(const int Nelements,
+                            const int Np,
+                            @restrict const dfloat* w,
+                            @restrict const dfloat* f,
+                            @restrict dfloat* avg)
+{
+  for (int e = 0; e < Nelements; ++e; @outer(0)) {
+    @shared dfloat s_num[ENRICO_BLOCK];
+    @shared dfloat s_den[ENRICO_BLOCK];
+
+    for (int t = 0; t < ENRICO_BLOCK; ++t; @inner(0)) {
+      dfloat num = 0.0;
+      dfloat den = 0.0;
+      for (int n = t; n < Np; n += ENRICO_BLOCK) {
+        const int id = e * Np + n;
+        num += w[id] * f[id];
+        den += w[id];
+      }
+      s_num[t] = num;
+      s_den[t] = den;
+    }
+
+    for (int s = ENRICO_BLOCK / 2; s > 0; s /= 2) {
+      for (int t = 0; t < ENRICO_BLOCK; ++t; @inner(0)) {
+        if (t < s) {
+          s_num[t] += s_num[t + s];
+          s_den[t] += s_den[t + s];
+        }
+      }
+    }
+
+    for (int t = 0; t < ENRICO_BLOCK; ++t; @inner(0)) {
+      if (t == 0)
+        avg[e] = s_num[0] / s_den[0];
+    }
+  }
+}
+
+@kernel void elementBroadcast(const int Nelements,
+                              const int Np,
+                              @restrict const dfloat* value,
+                              @restrict dfloat* q)
+{
+  for (int id = 0; id < Nelements * Np; ++id; @tile(ENRICO_BLOCK, @outer, @inner)) {
+    q[id] = value[id / Np];
+  }
+}
+)";
+
+} // namespace
 NekRSDriver::NekRSDriver(MPI_Comm comm, pugi::xml_node node)
   : HeatFluidsDriver(comm, node)
 {
@@ -29,6 +90,13 @@ NekRSDriver::NekRSDriver(MPI_Comm comm, pugi::xml_node node)
     if (node.child("output_heat_source")) {
       output_heat_source_ = node.child("output_heat_source").text().as_bool();
     }
+    if (node.child("steady_state_interval")) {
+      steady_state_interval_ = node.child("steady_state_interval").text().as_int();
+      steady_state_tol_ = node.child("steady_state_tol").text().as_double();
+      Expects(steady_state_interval_ >= 0);
+      Expects(steady_state_interval_ == 0 || steady_state_tol_ > 0.0);
+    }
+    init_specific_volume_table();
 
     host_.setup({{"mode", "Serial"}});
 
@@ -71,12 +139,16 @@ NekRSDriver::NekRSDriver(MPI_Comm comm, pugi::xml_node node)
 
     auto cds = nrs_ptr_->cds;
 
-    // Copy rho_cp_ from the device to host
-    rho_cp_.resize(mesh->Nelements * mesh->Np);
-    occa::memory o_rho = cds->o_rho;
-    o_rho.copyTo(rho_cp_.data(), mesh->Nlocal * sizeof(dfloat));
-
-    temperature_ = cds->S;
+    // Build the kernels for element averages and broadcasts, which work on
+    // device-resident fields and move one value per element to and from the host
+    occa::properties kernel_props;
+    kernel_props["defines/dfloat"] = dfloatString;
+    element_average_ =
+      mesh->device.buildKernelFromString(element_kernels, "elementAverage", kernel_props);
+    element_broadcast_ = mesh->device.buildKernelFromString(
+      element_kernels, "elementBroadcast", kernel_props);
+    o_elem_ = mesh->device.malloc(n_local_elem_ * sizeof(dfloat));
+    elem_host_.resize(n_local_elem_);
 
     // Copy lumped mass matrix from device to host
     mass_matrix_.resize(mesh->Nelements * mesh->Np);
@@ -104,6 +176,7 @@ void NekRSDriver::init_step()
 void NekRSDriver::solve_step()
 {
   timer_solve_step.start();
+  this->flush_heat_sources();
   const int runtime_stat_freq = 500;
   auto elapsed_time = MPI_Wtime();
   tstep_ = 0;
@@ -114,6 +187,13 @@ void NekRSDriver::solve_step()
   auto last_step = nekrs::lastStep(time_, tstep_, elapsed_time);
   double elapsedStepSum = 0;
 
+  // The temperatures at the start are the reference for the first steady-state check
+  if (steady_state_interval_ > 0) {
+    temperature_check_.resize(n_local_elem_);
+    temperature_latest_.resize(n_local_elem_);
+    this->temperature(temperature_check_);
+  }
+
   if (!last_step) {
     std::stringstream msg;
     if (nekrs::endTime() > nekrs::startTime()) {
@@ -171,10 +251,34 @@ void NekRSDriver::solve_step()
 
     if (tstep_ % runtime_stat_freq == 0 || last_step)
       nekrs::printRuntimeStatistics(tstep_);
+
+    if (!last_step && steady_state_interval_ > 0 && tstep_ % steady_state_interval_ == 0 &&
+        this->temperature_is_steady()) {
+      std::stringstream msg;
+      msg << "temperature reached a steady state after " << tstep_ << " steps";
+      comm_.message(msg.str());
+      nekrs::printRuntimeStatistics(tstep_);
+      break;
+    }
   }
   timer_solve_step.stop();
 }
 
+bool NekRSDriver::temperature_is_steady()
+{
+  this->temperature(temperature_latest_);
+
+  double max_change = 0.0;
+  for (int32_t i = 0; i < n_local_elem_; ++i) {
+    max_change =
+      std::max(max_change, std::abs(temperature_latest_[i] - temperature_check_[i]));
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &max_change, 1, MPI_DOUBLE, MPI_MAX, comm_.comm);
+
+  std::swap(temperature_check_, temperature_latest_);
+  return max_change <= steady_state_tol_;
+}
+
 void NekRSDriver::write_step(int timestep, int iteration)
 {
   timer_write_step.start();
@@ -182,7 +286,10 @@ void NekRSDriver::write_step(int timestep, int iteration)
   int FP64 = 1;
   if (output_heat_source_) {
     comm_.message("Writing heat source to .fld file");
-    occa::memory o_localq = host_.wrapMemory<double>(localq_->data(), localq_->size());
+    this->flush_heat_sources();
+    occa::memory o_localq = o_localq_
+                              ? *o_localq_
+                              : host_.wrapMemory<double>(localq_->data(), localq_->size());
     writeFld("qsc", time_, 1, 0, FP64, &nrs_ptr_->o_U, &nrs_ptr_->o_P, &o_localq, 1);
   }
   timer_write_step.stop();
@@ -206,13 +313,12 @@ Position NekRSDriver::centroid_at(int32_t local_elem) const
   return c;
 }
 
-std::vector<Position> NekRSDriver::centroid() const
+void NekRSDriver::centroid(gsl::span<Position> c) const
 {
-  std::vector<Position> c(n_local_elem());
+  Expects(c.size() == n_local_elem());
   for (int32_t i = 0; i < n_local_elem(); ++i) {
     c[i] = this->centroid_at(i);
   }
-  return c;
 }
 
 double NekRSDriver::volume_at(int32_t local_elem) const
@@ -225,55 +331,55 @@ double NekRSDriver::volume_at(int32_t local_elem) const
   return v;
 }
 
-std::vector<double> NekRSDriver::volume() const
+void NekRSDriver::volume(gsl::span<double> v) const
 {
-  std::vector<double> v(n_local_elem());
+  Expects(v.size() == n_local_elem());
   for (int32_t i = 0; i < n_local_elem(); ++i) {
     v[i] = this->volume_at(i);
   }
-  return v;
 }
 
-double NekRSDriver::temperature_at(int32_t local_elem) const
+void NekRSDriver::temperature(gsl::span<double> t) const
 {
-  Expects(local_elem < n_local_elem());
-
-  double sum0 = 0.;
-  double sum1 = 0.;
-  for (int32_t i = 0; i < n_gll_; ++i) {
-    auto idx = local_elem * n_gll_ + i;
-    sum0 += rho_cp_[idx] * temperature_[idx];
-    sum1 += rho_cp_[idx];
-  }
-  return sum0 / sum1;
-}
-
-std::vector<double> NekRSDriver::temperature() const
-{
-  std::vector<double> t(n_local_elem());
-  for (int32_t i = 0; i < n_local_elem(); ++i) {
-    t[i] = this->temperature_at(i);
-  }
-
-  return t;
+  Expects(t.size() == n_local_elem());
+
+  // Average the current temperature with the current rho*cp as weights on the
+  // device, then copy one value per element back
+  auto cds = nrs_ptr_->cds;
+  element_average_(n_local_elem_, n_gll_, cds->o_rho, cds->o_S, o_elem_);
+  o_elem_.copyTo(elem_host_.data(), n_local_elem_ * sizeof(dfloat));
+  std::copy(elem_host_.cbegin(), elem_host_.cend(), t.begin());
 }
 
-std::vector<double> NekRSDriver::density() const
+void NekRSDriver::density(gsl::span<double> rho) const
 {
+  Expects(rho.size() == n_local_elem());
   nek::copyToNek(time_, tstep_);
-  std::vector<double> local_densities(n_local_elem());
 
+  // The element temperatures are computed in rho itself, then converted in place
+  this->temperature(rho);
   for (int32_t i = 0; i < n_local_elem(); ++i) {
     if (this->in_fluid_at(i) == 1) {
-      auto T = this->temperature_at(i);
       // nu1 returns specific volume in [m^3/kg]
-      local_densities[i] = 1.0e-3 / iapws::nu1(pressure_bc_, T);
+      rho[i] = 1.0e-3 / this->specific_volume(rho[i]);
     } else {
-      local_densities[i] = 0.0;
+      rho[i] = 0.0;
     }
   }
+}
+
+void NekRSDriver::thermal_state(gsl::span<double> T, gsl::span<double> rho) const
+{
+  Expects(T.size() == n_local_elem());
+  Expects(rho.size() == n_local_elem());
+  nek::copyToNek(time_, tstep_);
 
-  return local_densities;
+  // One device average gives the temperatures, from which the densities follow
+  this->temperature(T);
+  for (int32_t i = 0; i < n_local_elem(); ++i) {
+    // nu1 returns specific volume in [m^3/kg]
+    rho[i] = this->in_fluid_at(i) == 1 ? 1.0e-3 / this->specific_volume(T[i]) : 0.0;
+  }
 }
 
 int NekRSDriver::in_fluid_at(int32_t local_elem) const
@@ -282,23 +388,68 @@ int NekRSDriver::in_fluid_at(int32_t local_elem) const
   return element_info_[local_elem] == 1 ? 0 : 1;
 }
 
-std::vector<int> NekRSDriver::fluid_mask() const
+void NekRSDriver::fluid_mask(gsl::span<int> mask) const
 {
-  std::vector<int> mask(n_local_elem());
+  Expects(mask.size() == n_local_elem());
   for (int32_t i = 0; i < n_local_elem(); ++i) {
     mask[i] = in_fluid_at(i);
   }
-  return mask;
 }
 
 int NekRSDriver::set_heat_source_at(int32_t local_elem, double heat)
 {
+  Expects(local_elem < n_local_elem());
+
+  // With a device-resident heat source, the element values are staged on the host,
+  // starting from the ones on the device, and copied to the device once before they
+  // are used
+  if (o_localq_) {
+    if (!heat_staged_) {
+      auto mesh = nrs_ptr_->cds->mesh[0];
+      element_average_(n_local_elem_, n_gll_, mesh->o_LMM, *o_localq_, o_elem_);
+      o_elem_.copyTo(elem_host_.data(), n_local_elem_ * sizeof(dfloat));
+      heat_staged_ = true;
+    }
+    elem_host_[local_elem] = heat;
+    return 0;
+  }
+
   for (int i = 0; i < n_gll_; ++i) {
     localq_->at(local_elem * n_gll_ + i) = heat;
   }
   return 0;
 }
 
+void NekRSDriver::set_heat_sources(gsl::span<const double> heat)
+{
+  Expects(heat.size() == n_local_elem());
+
+  // With a device-resident heat source, only the element values are copied to the
+  // device, where they are broadcast to the GLL points
+  if (o_localq_) {
+    Expects(o_localq_->size() >= n_local_elem() * n_gll_ * sizeof(dfloat));
+    std::copy(heat.begin(), heat.end(), elem_host_.begin());
+    heat_staged_ = true;
+    this->flush_heat_sources();
+    return;
+  }
+
+  Expects(localq_->size() >= n_local_elem() * n_gll_);
+  double* q = localq_->data();
+  for (int32_t e = 0; e < n_local_elem(); ++e) {
+    std::fill_n(q + e * n_gll_, n_gll_, heat[e]);
+  }
+}
+
+void NekRSDriver::flush_heat_sources()
+{
+  if (heat_staged_) {
+    o_elem_.copyFrom(elem_host_.data(), n_local_elem_ * sizeof(dfloat));
+    element_broadcast_(n_local_elem_, n_gll_, o_elem_, *o_localq_);
+    heat_staged_ = false;
+  }
+}
+
 void NekRSDriver::open_lib_udf()
 {
   lib_udf_handle_ = dlopen(lib_udf_name_.c_str(), RTLD_LAZY);
@@ -312,6 +463,15 @@ void NekRSDriver::open_lib_udf()
     throw std::runtime_error("dlsym error for localq in " + lib_udf_name_);
   }
   localq_ = reinterpret_cast<std::vector<double>*>(localq_void);
+
+  // The UDF may also define the heat source on the device as o_localq, in which case
+  // it is set there instead
+  dlerror();
+  void* o_localq_void = dlsym(lib_udf_handle_, "o_localq");
+  if (!dlerror()) {
+    o_localq_ = reinterpret_cast<occa::memory*>(o_localq_void);
+    comm_.message("Setting the heat source on the device through o_localq");
+  }
 }
 
 void NekRSDriver::close_lib_udf()
@@ -2,11 +2,13 @@
 
 #include "enrico/const.h"
 #include "enrico/error.h"
+#include "enrico/hash.h"
 
 #include "openmc/capi.h"
 #include "openmc/cell.h"
 #include "openmc/constants.h"
 #include "openmc/nuclide.h"
+#include "openmc/settings.h"
 #include "openmc/simulation.h"
 #include "openmc/summary.h"
 #include "openmc/tallies/filter.h"
@@ -17,20 +19,70 @@
 #include "xtensor/xview.hpp"
 #include <gsl/gsl-lite.hpp>
 
+#include <algorithm> // for copy, min
+#include <fstream>
+#include <iostream>
+#include <numeric> // for accumulate
+#include <iterator>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace enrico {
 
-OpenmcDriver::OpenmcDriver(MPI_Comm comm)
+OpenmcDriver::OpenmcDriver(MPI_Comm comm, pugi::xml_node node)
   : NeutronicsDriver(comm)
 {
   timer_driver_setup.start();
+
+  // A background write makes MPI calls while the coupling does, which needs full
+  // thread support from MPI
+  if (node.child("output_async")) {
+    output_async_ = node.child("output_async").text().as_bool();
+  }
+  if (output_async_) {
+    int provided;
+    MPI_Query_thread(&provided);
+    if (provided < MPI_THREAD_MULTIPLE) {
+      comm_.message("MPI_THREAD_MULTIPLE not provided; OpenMC output is synchronous");
+      output_async_ = false;
+    }
+  }
+
   if (active()) {
-    err_chk(openmc_init(0, nullptr, &comm));
+    MPI_Comm openmc_comm = comm;
+    if (output_async_) {
+      MPI_Comm_dup(comm, &openmc_comm_);
+      openmc_comm = openmc_comm_;
+    }
+    err_chk(openmc_init(0, nullptr, &openmc_comm));
   }
   MPI_Barrier(MPI_COMM_WORLD);
 
+  // Determine whether to carry the fission source across Picard iterations
+  if (node.child("warm_source")) {
+    warm_source_ = node.child("warm_source").text().as_bool();
+  }
+  if (node.child("warm_source_inactive")) {
+    warm_source_inactive_ = node.child("warm_source_inactive").text().as_int();
+  }
+  // Determine which Picard iterations write a statepoint and properties file
+  if (node.child("output_iterations")) {
+    output_iterations_ = node.child("output_iterations").text().as_string();
+  }
+  if (node.child("output_interval")) {
+    output_interval_ = node.child("output_interval").text().as_int();
+  }
+  Expects(output_iterations_ == "all" || output_iterations_ == "converged" ||
+          output_iterations_ == "final" || output_iterations_ == "none");
+  Expects(output_interval_ >= 1);
+
+  n_inactive_ = openmc::settings::n_inactive;
+  n_batches_ = openmc::settings::n_batches;
+  if (warm_source_ && active()) {
+    Expects(warm_source_inactive_ >= 0 && warm_source_inactive_ <= n_inactive_);
+  }
+
   // determine number of fissionable cells in model to aid in catching
   // improperly mapped problems
   n_fissionable_cells_ = 0;
@@ -70,25 +122,11 @@ void OpenmcDriver::create_tallies()
   using gsl::index;
   using gsl::narrow_cast;
 
-  // Build vector of material indices on each rank
-  // After CoupledDriver::init_mappings, the cells_ array is up-to-date on the root,
-  // so we need to send that info to all the other ranks
-  std::vector<int32_t> indices;
-  std::vector<int32_t> instances;
-  if (comm_.is_root()) {
-    for (const auto& c : cells_) {
-      indices.push_back(c.index_);
-      instances.push_back(c.instance_);
-    }
-  }
-  comm_.broadcast(indices);
-  comm_.broadcast(instances);
-  Ensures(indices.size() == instances.size());
-
+  // After CoupledDriver::init_mapping, the cells_ array is consistent on all ranks
   std::vector<openmc::CellInstance> openmc_instances;
-  for (index i = 0; i < indices.size(); ++i) {
+  for (const auto& c : cells_) {
     openmc_instances.push_back(
-      {narrow_cast<index>(indices[i]), narrow_cast<index>(instances[i])});
+      {narrow_cast<index>(c.index_), narrow_cast<index>(c.instance_)});
   }
   // Create material filter
   auto f = openmc::Filter::create("cellinstance");
@@ -103,6 +141,48 @@ void OpenmcDriver::create_tallies()
   tally_->add_filter(filter_);
 }
 
+bool OpenmcDriver::create_boron_tallies()
+{
+  if (openmc::data::nuclide_map.count("B10") == 0 || fluid_materials_.empty()) {
+    return false;
+  }
+
+  // Only the B10 of the fluid materials, whose boron set_boron_ppm() changes, is
+  // soluble boron, while neutrons are produced in the whole model
+  auto f = openmc::Filter::create("material");
+  auto filter = dynamic_cast<openmc::MaterialFilter*>(f);
+  filter->set_materials(fluid_materials_);
+
+  boron_tally_ = openmc::Tally::create();
+  boron_tally_->set_scores({"absorption"});
+  boron_tally_->set_nuclides({"B10"});
+  boron_tally_->add_filter(filter);
+
+  production_tally_ = openmc::Tally::create();
+  production_tally_->set_scores({"nu-fission"});
+  return true;
+}
+
+double OpenmcDriver::boron_sensitivity(double ppm, double k_eff) const
+{
+  // With k = P / L, the B10 absorption rate A_B10 is part of the loss rate L and
+  // is proportional to the ppm.  To first order, with the flux unchanged,
+  // dk/dppm = -k^2 A_B10 / (P ppm).  The tally results are only reduced on the root.
+  double dk_dppm = 0.0;
+  if (comm_.is_root() && ppm > 0.0) {
+    // The B10 absorption is summed over the fluid materials
+    int i_sum = static_cast<int>(openmc::TallyResult::SUM);
+    auto absorption = xt::view(boron_tally_->results_, xt::all(), 0, i_sum);
+    double absorption_B10 = xt::sum(absorption)();
+    double production = production_tally_->results_(0, 0, i_sum);
+    if (production > 0.0) {
+      dk_dppm = -k_eff * k_eff * absorption_B10 / (production * ppm);
+    }
+  }
+  comm_.broadcast(dk_dppm);
+  return dk_dppm;
+}
+
 xt::xtensor<double, 1> OpenmcDriver::heat_source(double power) const
 {
   // Determine number of realizations for normalizing tallies
@@ -130,35 +210,184 @@ xt::xtensor<double, 1> OpenmcDriver::heat_source(double power) const
   return heat;
 }
 
+void OpenmcDriver::get_heat_sources(double power,
+                                    gsl::span<const gsl::index> indices,
+                                    gsl::span<double> heat) const
+{
+  if (!comm_.is_root()) {
+    return;
+  }
+  Expects(indices.size() == heat.size());
+
+  // The conversion to [J/source] cancels out in the normalization to the power, so the
+  // heat source in [W/cm^3] is the power times the cell's share of the energy
+  // production over its volume
+  int i_sum = static_cast<int>(openmc::TallyResult::SUM);
+  auto sum = xt::view(tally_->results_, xt::all(), 0, i_sum);
+  double scale = power / xt::sum(sum)();
+  for (gsl::index k = 0; k < indices.size(); ++k) {
+    auto i = indices[k];
+    heat[k] = scale * sum(i) / cells_[i].volume_;
+  }
+}
+
 std::vector<CellHandle> OpenmcDriver::find(const std::vector<Position>& positions)
 {
-  std::vector<CellHandle> handles;
-  handles.reserve(positions.size());
+  // The positions on the root are split into consecutive pieces, one per rank
+  auto n = positions.size();
+  comm_.broadcast(n);
+  auto counts = partition_counts(n, comm_.size);
+  std::vector<Position> local_positions(counts[comm_.rank]);
+  comm_.scatterv(positions, local_positions, counts);
+
+  // Each rank locates its piece of the positions, divided among threads.  Errors
+  // are recorded and checked after the loop, since exceptions can't escape the
+  // parallel region.
+  auto n_local = local_positions.size();
+  std::vector<int32_t> local_indices(n_local);
+  std::vector<int32_t> local_instances(n_local);
+  std::vector<int> local_errors(n_local);
+#pragma omp parallel for schedule(dynamic, 64)
+  for (gsl::index i = 0; i < n_local; ++i) {
+    const auto& r = local_positions[i];
+    double xyz[3] = {r.x, r.y, r.z};
+    local_errors[i] = openmc_find_cell(xyz, &local_indices[i], &local_instances[i]);
+  }
+  for (auto err : local_errors) {
+    err_chk(err);
+  }
 
-  for (const auto& r : positions) {
-    // Determine cell instance corresponding to global element
-    CellInstance c{r};
+  // The cell instances are gathered on the root in the order of the positions
+  std::vector<int32_t> indices;
+  std::vector<int32_t> instances;
+  comm_.gatherv(local_indices, indices, counts);
+  comm_.gatherv(local_instances, instances, counts);
 
-    // If this cell instance hasn't been saved yet, add it to cells_ and
-    // keep track of what index it corresponds to
-    auto h = c.get_handle();
-    if (cell_index_.find(h) == cell_index_.end()) {
-      cell_index_.emplace(h, cells_.size());
+  // If a cell instance hasn't been saved yet, the root adds it to cells_ and
+  // keeps track of what index it corresponds to.  The new cell instances are
+  // then sent to the other ranks, which add them in the same order.
+  std::vector<CellHandle> handles;
+  std::vector<int32_t> new_indices;
+  std::vector<int32_t> new_instances;
+  if (comm_.is_root()) {
+    handles.reserve(n);
+    for (gsl::index i = 0; i < n; ++i) {
+      CellInstance c{indices[i], instances[i]};
+      auto h = c.get_handle();
+      if (cell_index_.find(h) == cell_index_.end()) {
+        cell_index_.emplace(h, cells_.size());
+        cells_.push_back(c);
+        new_indices.push_back(c.index_);
+        new_instances.push_back(c.instance_);
+      }
+      handles.push_back(h);
+    }
+  }
+  comm_.broadcast(new_indices);
+  comm_.broadcast(new_instances);
+  if (!comm_.is_root()) {
+    for (gsl::index i = 0; i < new_indices.size(); ++i) {
+      CellInstance c{new_indices[i], new_instances[i]};
+      cell_index_.emplace(c.get_handle(), cells_.size());
       cells_.push_back(c);
     }
-
-    // Set value for cell instance in array
-    handles.push_back(h);
   }
 
   return handles;
 }
 
+std::int64_t OpenmcDriver::get_particles() const
+{
+  return openmc::settings::n_particles;
+}
+
+void OpenmcDriver::set_particles(std::int64_t n)
+{
+  Expects(n > 0);
+  this->wait_for_output();
+  // The source bank is sized by openmc_simulation_init, so this takes effect in
+  // the next init_step
+  openmc::settings::n_particles = n;
+}
+
+std::vector<char> OpenmcDriver::get_source_sites() const
+{
+  const char* begin = reinterpret_cast<const char*>(source_sites_.data());
+  return {begin, begin + source_sites_.size() * sizeof(openmc::SourceSite)};
+}
+
+void OpenmcDriver::set_source_sites(const std::vector<char>& sites)
+{
+  Expects(sites.size() % sizeof(openmc::SourceSite) == 0);
+  source_sites_.resize(sites.size() / sizeof(openmc::SourceSite));
+  std::copy(sites.begin(), sites.end(), reinterpret_cast<char*>(source_sites_.data()));
+  source_restored_ = !source_sites_.empty();
+}
+
+std::uint64_t OpenmcDriver::geometry_hash() const
+{
+  // The geometry is either in its own file or part of a single model file
+  for (const auto& name : {"geometry.xml", "model.xml"}) {
+    std::ifstream file{openmc::settings::path_input + name, std::ios::binary};
+    if (file) {
+      std::string contents{std::istreambuf_iterator<char>{file},
+                           std::istreambuf_iterator<char>{}};
+      return hash_bytes(contents.data(), contents.size());
+    }
+  }
+  return 0;
+}
+
+void OpenmcDriver::set_fluid_cells(const std::vector<CellHandle>& fluid_cell_handles)
+{
+  fluid_materials_.clear();
+  fluid_material_nuclides_.clear();
+
+  std::unordered_set<int32_t> seen;
+  for (auto cell : fluid_cell_handles) {
+    auto i_mat = this->cell_instance(cell).material_index_;
+    if (!seen.insert(i_mat).second) {
+      continue;
+    }
+    const auto& mat = openmc::model::materials.at(i_mat);
+    auto nucs = mat->nuclides();
+    auto densities = mat->densities();
+
+    // Reorder the nuclides so that the non-boron ones come first, which is also the
+    // order in which set_boron_ppm() sets them
+    std::vector<std::string> names;
+    std::vector<double> new_densities;
+    std::vector<std::string> boron_names;
+    std::vector<double> boron_densities;
+    for (int i = 0; i < nucs.size(); i++) {
+      const auto& nuclide = openmc::data::nuclides[nucs[i]];
+      if (nuclide->Z_ != 5) {
+        names.push_back(nuclide->name_);
+        new_densities.push_back(densities[i]);
+      } else {
+        boron_names.push_back(nuclide->name_);
+        boron_densities.push_back(densities[i]);
+      }
+    }
+    auto nuclides = names;
+    nuclides.push_back("B10");
+    nuclides.push_back("B11");
+
+    names.insert(names.end(), boron_names.begin(), boron_names.end());
+    new_densities.insert(new_densities.end(), boron_densities.begin(), boron_densities.end());
+    mat->set_densities(names, new_densities);
+
+    fluid_materials_.push_back(i_mat);
+    fluid_material_nuclides_.push_back(nuclides);
+  }
+}
+
 void OpenmcDriver::set_boron_ppm(const std::vector<CellHandle>& fluid_cell_handles,
                                  double ppm, double B10_iso_abund) const
 {
-  // Step through all the fluid-filled cells we received from the heat solver
-  // during initialization
+  // Step through all the distinct materials in the fluid-filled cells that were
+  // cached by set_fluid_cells().  Many cell instances share one material, so each
+  // material is only updated once.
   // For each material, apply the B10 and B11 inventories according to the ppm
   // NOTE: we assume the following when modifying the boron density:
   //   1. Changing boron density does not also change H and O density as the
@@ -172,49 +401,43 @@ void OpenmcDriver::set_boron_ppm(const std::vector<CellHandle>& fluid_cell_handl
   //      assumed to not change the specific volume of the water (i.e.,
   //      the presence of boron increases the mass in density = mass / volume
   //      but not the volume term)
-  for (auto cell : fluid_cell_handles) {
-    const auto& mat = this->cell_instance(cell).material();
-    auto nucs = mat->nuclides();
+  Expects(fluid_cell_handles.empty() || !fluid_materials_.empty());
+  this->wait_for_output();
+  for (gsl::index m = 0; m < fluid_materials_.size(); ++m) {
+    const auto& mat = openmc::model::materials[fluid_materials_[m]];
+    const auto& nuclides = fluid_material_nuclides_[m];
     auto densities = mat->densities();
 
-    // Get the non-boron constituents
-    std::vector<std::string> names;
-    std::vector<double> new_densities;
-    double N_not_boron = 0.;
-    for (int i = 0; i < nucs.size(); i++) {
-      int nuc_index = nucs[i];
-      const auto& nuclide = openmc::data::nuclides[nuc_index];
-
-      if (nuclide->Z_ != 5) {
-        names.push_back(nuclide->name_);
-        new_densities.push_back(densities[i]);
-        N_not_boron += densities[i];
-      }
-    }
+    // The non-boron constituents are the first nuclides of the material; their
+    // densities are read each time since they change with the fluid density
+    auto n_not_boron = nuclides.size() - 2;
+    std::vector<double> new_densities(densities.begin(), densities.begin() + n_not_boron);
+    double N_not_boron = std::accumulate(new_densities.begin(), new_densities.end(), 0.);
 
     // Now compute the boron number densities
     auto N_boron = N_not_boron * ppm / (1.e6 + ppm);
 
     // And add the boron isotopes to the material
     if (N_boron > 0.) {
-      names.push_back("B10");
       new_densities.push_back(N_boron * B10_iso_abund);
-      names.push_back("B11");
       new_densities.push_back(N_boron * (1. - B10_iso_abund));
+      mat->set_densities(nuclides, new_densities);
+    } else {
+      std::vector<std::string> names(nuclides.begin(), nuclides.begin() + n_not_boron);
+      mat->set_densities(names, new_densities);
     }
-
-    // Update the material inventory accordingly
-    mat->set_densities(names, new_densities);
   }
 }
 
 void OpenmcDriver::set_density(CellHandle cell, double rho) const
 {
+  this->wait_for_output();
   this->cell_instance(cell).material()->set_density(rho, "g/cm3");
 }
 
 void OpenmcDriver::set_temperature(CellHandle cell, double T) const
 {
+  this->wait_for_output();
   const auto& c = this->cell_instance(cell);
   c.cell()->set_temperature(T, c.instance_);
 }
@@ -230,6 +453,44 @@ double OpenmcDriver::get_temperature(CellHandle cell) const
   return c.cell()->temperature(c.instance_);
 }
 
+void OpenmcDriver::set_temperatures(gsl::span<const gsl::index> indices,
+                                    gsl::span<const double> T) const
+{
+  Expects(indices.size() == T.size());
+  this->wait_for_output();
+  for (gsl::index i = 0; i < indices.size(); ++i) {
+    cells_[indices[i]].set_temperature(T[i]);
+  }
+}
+
+void OpenmcDriver::set_densities(gsl::span<const gsl::index> indices,
+                                 gsl::span<const double> rho) const
+{
+  Expects(indices.size() == rho.size());
+  this->wait_for_output();
+  for (gsl::index i = 0; i < indices.size(); ++i) {
+    cells_[indices[i]].set_density(rho[i]);
+  }
+}
+
+void OpenmcDriver::get_temperatures(gsl::span<const gsl::index> indices,
+                                    gsl::span<double> T) const
+{
+  Expects(indices.size() == T.size());
+  for (gsl::index i = 0; i < indices.size(); ++i) {
+    T[i] = cells_[indices[i]].get_temperature();
+  }
+}
+
+void OpenmcDriver::get_densities(gsl::span<const gsl::index> indices,
+                                 gsl::span<double> rho) const
+{
+  Expects(indices.size() == rho.size());
+  for (gsl::index i = 0; i < indices.size(); ++i) {
+    rho[i] = cells_[indices[i]].get_density();
+  }
+}
+
 double OpenmcDriver::get_volume(CellHandle cell) const
 {
   return this->cell_instance(cell).volume_;
@@ -302,7 +563,26 @@ double OpenmcDriver::get_boron_ppm(const std::vector<CellHandle>& fluid_cell_han
 void OpenmcDriver::init_step()
 {
   timer_init_step.start();
+  this->wait_for_output();
+
+  // A warm-started source needs fewer inactive batches to converge; the number of
+  // active batches is unchanged
+  bool warm = (warm_source_ || source_restored_) && !source_sites_.empty();
+  source_restored_ = false;
+  int32_t n_inactive = warm ? std::min(warm_source_inactive_, n_inactive_) : n_inactive_;
+  openmc::settings::n_inactive = n_inactive;
+  openmc::settings::n_batches = n_batches_ - n_inactive_ + n_inactive;
+
   err_chk(openmc_simulation_init());
+
+  // Replace the initial source with the source of the previous iteration.  If the
+  // number of particles changed, the sites are reused cyclically.
+  if (warm) {
+    auto& bank = openmc::simulation::source_bank;
+    for (gsl::index i = 0; i < bank.size(); ++i) {
+      bank[i] = source_sites_[i % source_sites_.size()];
+    }
+  }
   timer_init_step.stop();
 }
 
@@ -324,29 +604,110 @@ UncertainDouble OpenmcDriver::get_k_effective() const
 
 void OpenmcDriver::write_step(int timestep, int iteration)
 {
+  // With "all", every output_interval_-th Picard iteration is written; with "final",
+  // only the call after the last one, which has no timestep or iteration
+  bool final = iteration < 0;
+  if (output_iterations_ != (final ? "final" : "all")) {
+    return;
+  }
+  if (!final && n_output_calls_++ % output_interval_ != 0) {
+    return;
+  }
+
   timer_write_step.start();
-  std::string suffix{"_t" + std::to_string(timestep) + "_i" + std::to_string(iteration) +
-                     ".h5"};
-  std::string filename{"openmc" + suffix};
-  err_chk(openmc_statepoint_write(filename.c_str(), nullptr));
+  if (final) {
+    write_files(".h5");
+  } else {
+    std::string suffix =
+      "_t" + std::to_string(timestep) + "_i" + std::to_string(iteration) + ".h5";
+    if (output_async_) {
+      // openmc_simulation_finalize() changes the tally results, so the background
+      // write can only start after it
+      pending_suffix_ = suffix;
+    } else {
+      write_files(suffix);
+    }
+  }
+  timer_write_step.stop();
+}
 
-  std::string prop_file{"properties" + suffix};
-  err_chk(openmc_properties_export(prop_file.c_str()));
+void OpenmcDriver::write_converged_step(int timestep, int iteration)
+{
+  if (output_iterations_ != "converged") {
+    return;
+  }
+  timer_write_step.start();
+  write_files("_t" + std::to_string(timestep) + "_i" + std::to_string(iteration) +
+              ".h5");
   timer_write_step.stop();
 }
 
+void OpenmcDriver::write_files(const std::string& suffix)
+{
+  // The tally results and the source bank of the last solve are kept by OpenMC until
+  // the next openmc_simulation_init(), so the files can be written after
+  // finalize_step()
+  auto write = [suffix] {
+    std::string filename{"openmc" + suffix};
+    err_chk(openmc_statepoint_write(filename.c_str(), nullptr));
+
+    std::string prop_file{"properties" + suffix};
+    err_chk(openmc_properties_export(prop_file.c_str()));
+  };
+
+  // A background write only reads OpenMC's state, and the only MPI calls made while
+  // it runs are those of the coupling, which are on other communicators
+  this->wait_for_output();
+  if (output_async_) {
+    output_ = std::async(std::launch::async, write);
+  } else {
+    write();
+  }
+}
+
+void OpenmcDriver::wait_for_output() const
+{
+  if (output_.valid()) {
+    output_.get();
+  }
+}
+
 void OpenmcDriver::finalize_step()
 {
   timer_finalize_step.start();
+
+  // After the last batch, the source bank holds the sites for the next generation.
+  // They are kept even without a warm-started source so that they can be
+  // checkpointed.
+  const auto& bank = openmc::simulation::source_bank;
+  source_sites_.assign(bank.begin(), bank.end());
+
   err_chk(openmc_simulation_finalize());
+
+  if (!pending_suffix_.empty()) {
+    write_files(pending_suffix_);
+    pending_suffix_.clear();
+  }
   timer_finalize_step.stop();
 }
 
 OpenmcDriver::~OpenmcDriver()
 {
+  // A destructor can't throw, so an error from the last background write is reported
+  // by the rank that hit it
+  if (output_.valid()) {
+    try {
+      output_.get();
+    } catch (const std::exception& e) {
+      std::cerr << "Error writing OpenMC output: " << e.what() << std::endl;
+    }
+  }
   if (active()) {
     err_chk(openmc_finalize());
   }
+  if (openmc_comm_ != MPI_COMM_NULL) {
+    MPI_Comm_free(&openmc_comm_);
+  }
   MPI_Barrier(MPI_COMM_WORLD);
 }
 
@@ -0,0 +1,125 @@
+#include "enrico/property_table.h"
+
+#include <gsl/gsl-lite.hpp>
+
+#include <algorithm> // for max
+#include <sstream>
+#include <stdexcept>
+
+namespace enrico {
+
+namespace {
+
+//! Number of intervals per variable of the first table that is tried
+constexpr std::size_t initial_intervals = 16;
+
+//! Largest number of tabulated points before giving up on the tolerance
+constexpr std::size_t max_points = 1025 * 1025;
+
+} // namespace
+
+PropertyTable::PropertyTable(Function f,
+                             double x_min,
+                             double x_max,
+                             double y_min,
+                             double y_max,
+                             double tol)
+  : f_(f)
+  , x_min_(x_min)
+  , x_max_(x_max)
+  , y_min_(y_min)
+  , y_max_(y_max)
+{
+  Expects(x_max >= x_min);
+  Expects(y_max > y_min);
+  Expects(tol > 0.0);
+
+  // Halve the grid spacing until the interpolation error is within the tolerance
+  bool degenerate = x_max_ == x_min_;
+  for (std::size_t n = initial_intervals;; n *= 2) {
+    std::size_t n_x = degenerate ? 1 : n + 1;
+    if (n_x * (n + 1) > max_points) {
+      break;
+    }
+    n_x_ = n_x;
+    n_y_ = n + 1;
+    max_error_ = this->build();
+    if (max_error_ <= tol) {
+      return;
+    }
+  }
+
+  std::stringstream msg;
+  msg << "Property table with " << n_x_ << " x " << n_y_ << " points has a relative "
+      << "error of " << max_error_ << ", larger than the tolerance of " << tol;
+  throw std::runtime_error{msg.str()};
+}
+
+double PropertyTable::build()
+{
+  double dx = n_x_ > 1 ? (x_max_ - x_min_) / (n_x_ - 1) : 0.0;
+  double dy = (y_max_ - y_min_) / (n_y_ - 1);
+  i_max_ = n_x_ > 1 ? n_x_ - 2 : 0;
+  stride_x_ = n_x_ > 1 ? n_y_ : 0;
+  inv_dx_ = n_x_ > 1 ? 1.0 / dx : 0.0;
+  inv_dy_ = 1.0 / dy;
+
+  values_.resize(n_x_ * n_y_);
+  auto n_points = static_cast<std::ptrdiff_t>(values_.size());
+#pragma omp parallel for default(none) shared(n_points, dx, dy)
+  for (std::ptrdiff_t k = 0; k < n_points; ++k) {
+    std::size_t i = k / n_y_;
+    std::size_t j = k % n_y_;
+    values_[k] = f_(x_min_ + i * dx, y_min_ + j * dy);
+  }
+
+  // The error of bilinear interpolation is largest away from the nodes, so it is
+  // checked at the center of each cell and the midpoint of each edge
+  auto n_cells = static_cast<std::ptrdiff_t>(std::max<std::size_t>(n_x_ - 1, 1) * n_y_);
+  double max_error = 0.0;
+#pragma omp parallel for default(none) shared(n_cells, dx, dy) reduction(max : max_error)
+  for (std::ptrdiff_t k = 0; k < n_cells; ++k) {
+    std::size_t i = k / n_y_;
+    std::size_t j = k % n_y_;
+    double x = x_min_ + i * dx;
+    double y = y_min_ + j * dy;
+
+    double points[3][2] = {
+      {x + 0.5 * dx, y}, {x, y + 0.5 * dy}, {x + 0.5 * dx, y + 0.5 * dy}};
+    for (const auto& pt : points) {
+      if (pt[0] > x_max_ || pt[1] > y_max_) {
+        continue;
+      }
+      double exact = f_(pt[0], pt[1]);
+      double error = std::abs(this->interpolate(pt[0], pt[1]) - exact);
+      if (exact != 0.0) {
+        error /= std::abs(exact);
+      }
+      max_error = std::max(max_error, error);
+    }
+  }
+  return max_error;
+}
+
+void PropertyTable::evaluate(std::size_t n,
+                             const double* x,
+                             const double* y,
+                             double* out) const
+{
+  // Interpolate every point with its coordinates clamped to the table
+#pragma omp simd
+  for (std::size_t k = 0; k < n; ++k) {
+    double xk = std::min(std::max(x[k], x_min_), x_max_);
+    double yk = std::min(std::max(y[k], y_min_), y_max_);
+    out[k] = this->interpolate(xk, yk);
+  }
+
+  // Points that were clamped are evaluated exactly
+  for (std::size_t k = 0; k < n; ++k) {
+    if (!(x[k] >= x_min_ && x[k] <= x_max_ && y[k] >= y_min_ && y[k] <= y_max_)) {
+      out[k] = f_(x[k], y[k]);
+    }
+  }
+}
+
+} // namespace enrico
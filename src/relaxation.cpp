@@ -0,0 +1,269 @@
+#include "enrico/relaxation.h"
+
+#include <gsl/gsl-lite.hpp>
+
+#include <algorithm> // for max, swap
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace enrico {
+
+void Relaxation::relax(xt::xtensor<double, 1>& x,
+                       const xt::xtensor<double, 1>& x_prev,
+                       int iteration)
+{
+  Expects(x.size() == x_prev.size());
+  if (iteration == 0) {
+    this->reset();
+  }
+
+  xt::xtensor<double, 1> r = x - x_prev;
+  residual_ = std::sqrt(this->dot(r, r));
+  this->update(x, x_prev, r, iteration);
+}
+
+double Relaxation::dot(const xt::xtensor<double, 1>& a,
+                       const xt::xtensor<double, 1>& b) const
+{
+  double local = 0.0;
+  for (gsl::index i = 0; i < a.size(); ++i) {
+    local += a(i) * b(i);
+  }
+  return this->sum(local);
+}
+
+double Relaxation::sum(double local) const
+{
+  double global = local;
+  if (comm_.active()) {
+    MPI_Allreduce(&local, &global, 1, MPI_DOUBLE, MPI_SUM, comm_.comm);
+  }
+  return global;
+}
+
+bool Relaxation::any(bool local) const
+{
+  bool global = local;
+  if (comm_.active()) {
+    MPI_Allreduce(&local, &global, 1, MPI_CXX_BOOL, MPI_LOR, comm_.comm);
+  }
+  return global;
+}
+
+bool Relaxation::leaves_range(const xt::xtensor<double, 1>& x_new,
+                              const xt::xtensor<double, 1>& x_prev,
+                              const xt::xtensor<double, 1>& x) const
+{
+  bool local_bad = false;
+  for (gsl::index i = 0; i < x_new.size(); ++i) {
+    if (x_new(i) < 0.0 && x_prev(i) >= 0.0 && x(i) >= 0.0) {
+      local_bad = true;
+      break;
+    }
+  }
+  return this->any(local_bad);
+}
+
+ConstantRelaxation::ConstantRelaxation(const Comm& comm, double alpha)
+  : Relaxation(comm)
+  , alpha_(alpha)
+{
+  Expects(alpha_ > 0 && alpha_ <= 1.0);
+  factor_ = alpha_;
+}
+
+void ConstantRelaxation::update(xt::xtensor<double, 1>& x,
+                                const xt::xtensor<double, 1>& x_prev,
+                                const xt::xtensor<double, 1>& r,
+                                int iteration)
+{
+  x = x_prev + alpha_ * r;
+}
+
+void RobbinsMonroRelaxation::update(xt::xtensor<double, 1>& x,
+                                    const xt::xtensor<double, 1>& x_prev,
+                                    const xt::xtensor<double, 1>& r,
+                                    int iteration)
+{
+  int n = iteration + 1;
+  factor_ = 1.0 / n;
+  x = x / n + (1. - 1. / n) * x_prev;
+}
+
+AitkenRelaxation::AitkenRelaxation(const Comm& comm, double alpha)
+  : Relaxation(comm)
+  , alpha_(alpha)
+  , omega_(alpha)
+{
+  Expects(alpha_ > 0 && alpha_ <= 1.0);
+}
+
+void AitkenRelaxation::update(xt::xtensor<double, 1>& x,
+                              const xt::xtensor<double, 1>& x_prev,
+                              const xt::xtensor<double, 1>& r,
+                              int iteration)
+{
+  if (!has_r_prev_) {
+    omega_ = alpha_;
+  } else {
+    xt::xtensor<double, 1> dr = r - r_prev_;
+    double dr_sq = this->dot(dr, dr);
+    if (dr_sq > 0.0) {
+      omega_ = -omega_ * this->dot(r_prev_, dr) / dr_sq;
+    }
+    if (!(omega_ > 0.0)) {
+      omega_ = alpha_;
+    }
+  }
+  r_prev_ = r;
+  has_r_prev_ = true;
+
+  // Over-relaxation may leave the range of physical values, in which case the
+  // initial factor is used instead
+  xt::xtensor<double, 1> x_relaxed = x_prev + omega_ * r;
+  if (this->leaves_range(x_relaxed, x_prev, x)) {
+    omega_ = alpha_;
+    x_relaxed = x_prev + omega_ * r;
+  }
+  factor_ = omega_;
+  x = x_relaxed;
+}
+
+AndersonRelaxation::AndersonRelaxation(const Comm& comm, double alpha, int depth)
+  : Relaxation(comm)
+  , alpha_(alpha)
+  , depth_(depth)
+{
+  Expects(alpha_ > 0 && alpha_ <= 1.0);
+  Expects(depth_ > 0);
+  factor_ = alpha_;
+}
+
+void AndersonRelaxation::reset()
+{
+  x_last_ = xt::xtensor<double, 1>{};
+  r_last_ = xt::xtensor<double, 1>{};
+  has_last_ = false;
+  dx_.clear();
+  dr_.clear();
+}
+
+void AndersonRelaxation::update(xt::xtensor<double, 1>& x,
+                                const xt::xtensor<double, 1>& x_prev,
+                                const xt::xtensor<double, 1>& r,
+                                int iteration)
+{
+  // Add the differences from the previous iteration to the history.  Since this is
+  // decided on all ranks alike, the history has the same length on all of them.
+  if (has_last_) {
+    dx_.push_back(x_prev - x_last_);
+    dr_.push_back(r - r_last_);
+    if (dx_.size() > depth_) {
+      dx_.pop_front();
+      dr_.pop_front();
+    }
+  }
+  x_last_ = x_prev;
+  r_last_ = r;
+  has_last_ = true;
+
+  // Find the combination of residual differences closest to the residual by solving
+  // the normal equations.  If they are singular, the oldest differences are
+  // dropped until they are not.
+  std::vector<double> gamma;
+  while (!dr_.empty()) {
+    auto m = dr_.size();
+    std::vector<double> A(m * m);
+    std::vector<double> b(m);
+    for (gsl::index i = 0; i < m; ++i) {
+      for (gsl::index j = i; j < m; ++j) {
+        A[i * m + j] = A[j * m + i] = this->dot(dr_[i], dr_[j]);
+      }
+      b[i] = this->dot(dr_[i], r);
+    }
+
+    // Gaussian elimination with partial pivoting
+    bool singular = false;
+    double scale = 0.0;
+    for (gsl::index i = 0; i < m; ++i) {
+      scale = std::max(scale, A[i * m + i]);
+    }
+    for (gsl::index k = 0; k < m && !singular; ++k) {
+      gsl::index p = k;
+      for (gsl::index i = k + 1; i < m; ++i) {
+        if (std::abs(A[i * m + k]) > std::abs(A[p * m + k])) {
+          p = i;
+        }
+      }
+      if (!(std::abs(A[p * m + k]) > 1e-12 * scale)) {
+        singular = true;
+        break;
+      }
+      for (gsl::index j = 0; j < m; ++j) {
+        std::swap(A[k * m + j], A[p * m + j]);
+      }
+      std::swap(b[k], b[p]);
+      for (gsl::index i = k + 1; i < m; ++i) {
+        double f = A[i * m + k] / A[k * m + k];
+        for (gsl::index j = k; j < m; ++j) {
+          A[i * m + j] -= f * A[k * m + j];
+        }
+        b[i] -= f * b[k];
+      }
+    }
+    if (singular) {
+      dx_.pop_front();
+      dr_.pop_front();
+      continue;
+    }
+    gamma.assign(m, 0.0);
+    for (gsl::index i = m - 1; i >= 0; --i) {
+      double s = b[i];
+      for (gsl::index j = i + 1; j < m; ++j) {
+        s -= A[i * m + j] * gamma[j];
+      }
+      gamma[i] = s / A[i * m + i];
+    }
+    break;
+  }
+
+  xt::xtensor<double, 1> x_mixed = x_prev + alpha_ * r;
+  for (gsl::index j = 0; j < gamma.size(); ++j) {
+    x_mixed -= gamma[j] * (dx_[j] + alpha_ * dr_[j]);
+  }
+
+  // The extrapolation may leave the range of physical values (e.g., negative heat
+  // sources or temperatures).  In that case, the history is discarded and simple
+  // mixing is used.
+  bool bad = this->leaves_range(x_mixed, x_prev, x);
+  if (bad) {
+    dx_.clear();
+    dr_.clear();
+    x_mixed = x_prev + alpha_ * r;
+  }
+
+  x = x_mixed;
+}
+
+std::unique_ptr<Relaxation> make_relaxation(pugi::xml_node node,
+                                            int anderson_depth,
+                                            const Comm& comm)
+{
+  if (!node) {
+    return std::make_unique<ConstantRelaxation>(comm, 1.0);
+  }
+
+  std::string s = node.child_value();
+  if (s == "robbins-monro") {
+    return std::make_unique<RobbinsMonroRelaxation>(comm);
+  } else if (s == "aitken") {
+    return std::make_unique<AitkenRelaxation>(comm, 1.0);
+  } else if (s == "anderson") {
+    return std::make_unique<AndersonRelaxation>(comm, 1.0, anderson_depth);
+  } else {
+    return std::make_unique<ConstantRelaxation>(comm, node.text().as_double());
+  }
+}
+
+} // namespace enrico
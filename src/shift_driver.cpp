@@ -7,6 +7,7 @@
 #include "Teuchos_DefaultMpiComm.hpp"          // for MpiComm
 #include "Teuchos_XMLParameterListHelpers.hpp" // for RCP, ParameterList
 
+#include <numeric> // for accumulate
 #include <unordered_map>
 
 namespace enrico {
@@ -68,23 +69,46 @@ ShiftDriver::ShiftDriver(MPI_Comm comm, pugi::xml_node node)
 
 std::vector<CellHandle> ShiftDriver::find(const std::vector<Position>& positions)
 {
-  std::vector<CellHandle> handles;
-  handles.reserve(positions.size());
+  // The positions on the root are split into consecutive pieces, one per rank
+  auto n = positions.size();
+  comm_.broadcast(n);
+  auto counts = partition_counts(n, comm_.size);
+  std::vector<Position> local_positions(counts[comm_.rank]);
+  comm_.scatterv(positions, local_positions, counts);
+
+  // Find geometric cells of the local positions
+  std::vector<cell_type> local_cells;
+  local_cells.reserve(local_positions.size());
+  for (const auto& r : local_positions) {
+    local_cells.push_back(geometry_->find_cell({r.x, r.y, r.z}));
+  }
 
-  for (const auto& r : positions) {
-    // Find geometric cell and corresponding material
-    cell_type cell = geometry_->find_cell({r.x, r.y, r.z});
+  // The cells are gathered on the root in the order of the positions
+  std::vector<cell_type> found_cells;
+  comm_.gatherv(local_cells, found_cells, counts);
 
-    // If this cell hasn't been saved yet, add it to cells_ and
-    // keep track of what index it corresponds to
-    if (cell_index_.find(cell) == cell_index_.end()) {
+  // If a cell hasn't been saved yet, the root adds it to cells_ and keeps track
+  // of what index it corresponds to.  The new cells are then sent to the other
+  // ranks, which add them in the same order.
+  std::vector<CellHandle> handles;
+  std::vector<cell_type> new_cells;
+  if (comm_.is_root()) {
+    handles.reserve(n);
+    for (auto cell : found_cells) {
+      if (cell_index_.find(cell) == cell_index_.end()) {
+        cell_index_[cell] = cells_.size();
+        cells_.push_back(cell);
+        new_cells.push_back(cell);
+      }
+      handles.push_back(cell_index_.at(cell));
+    }
+  }
+  comm_.broadcast(new_cells);
+  if (!comm_.is_root()) {
+    for (auto cell : new_cells) {
       cell_index_[cell] = cells_.size();
       cells_.push_back(cell);
     }
-    auto h = cell_index_.at(cell);
-
-    // Set value for cell instance in array
-    handles.push_back(h);
   }
   return handles;
 }
@@ -112,6 +136,13 @@ void ShiftDriver::create_tallies()
   Array<int> counts(geometry_->num_cells(), 1);
   power_pl->set("union_cells", cells);
   power_pl->set("union_lengths", counts);
+
+  // The cells coupled to TH elements are all known by now, so the inverse volumes
+  // used to normalize the tally in heat_source() are computed once
+  inv_volume_.resize(cells_.size());
+  for (gsl::index i = 0; i < cells_.size(); ++i) {
+    inv_volume_[i] = 1.0 / geometry_->cell_volume(cells_[i]);
+  }
 }
 
 void ShiftDriver::set_density(CellHandle handle, double rho) const
@@ -146,6 +177,52 @@ double ShiftDriver::get_temperature(CellHandle handle) const
   return driver_->compositions()[matid]->temperature();
 }
 
+void ShiftDriver::set_temperatures(gsl::span<const gsl::index> indices,
+                                   gsl::span<const double> T) const
+{
+  Expects(indices.size() == T.size());
+  const auto& compositions = driver_->compositions();
+  for (gsl::index i = 0; i < indices.size(); ++i) {
+    Expects(T[i] > 0);
+    int matid = geometry_->matid(cells_[indices[i]]);
+    compositions[matid]->set_temperature(T[i]);
+  }
+}
+
+void ShiftDriver::set_densities(gsl::span<const gsl::index> indices,
+                                gsl::span<const double> rho) const
+{
+  Expects(indices.size() == rho.size());
+  const auto& compositions = driver_->compositions();
+  for (gsl::index i = 0; i < indices.size(); ++i) {
+    Expects(rho[i] > 0);
+    int matid = geometry_->matid(cells_[indices[i]]);
+    compositions[matid]->set_density(rho[i]);
+  }
+}
+
+void ShiftDriver::get_temperatures(gsl::span<const gsl::index> indices,
+                                   gsl::span<double> T) const
+{
+  Expects(indices.size() == T.size());
+  const auto& compositions = driver_->compositions();
+  for (gsl::index i = 0; i < indices.size(); ++i) {
+    int matid = geometry_->matid(cells_[indices[i]]);
+    T[i] = compositions[matid]->temperature();
+  }
+}
+
+void ShiftDriver::get_densities(gsl::span<const gsl::index> indices,
+                                gsl::span<double> rho) const
+{
+  Expects(indices.size() == rho.size());
+  const auto& compositions = driver_->compositions();
+  for (gsl::index i = 0; i < indices.size(); ++i) {
+    int matid = geometry_->matid(cells_[indices[i]]);
+    rho[i] = compositions[matid]->density();
+  }
+}
+
 double ShiftDriver::get_volume(CellHandle handle) const
 {
   auto cell = cells_.at(handle);
@@ -177,29 +254,20 @@ xt::xtensor<double, 1> ShiftDriver::heat_source(double power) const
       const auto& result = tally->result();
       auto mean = result.mean(0);
       Expects(result.num_multipliers() == 1);
+      Expects(inv_volume_.size() == cells_.size());
 
       // Compute global sum for normalization
       double total_heat = std::accumulate(mean.begin(), mean.end(), 0.0);
 
-      for (cell_type cell = 0; cell < mean.size(); ++cell) {
-        // Determine if this cell corresponds to any TH elements
-        auto it = cell_index_.find(cell);
-
-        if (it != cell_index_.end()) {
-          // Get volume
-          double V = geometry_->cell_volume(cell);
-
-          // Get handle for cell
-          CellHandle h = it->second;
-
-          // Convert heat to [W/cm^3]. Dividing by total_heat gives the fraction
-          // of heat deposited in each material. Multiplying by power gives an
-          // absolute value in W.
-          heat(h) = power * mean[cell] / (total_heat * V);
-        }
+      // Convert heat to [W/cm^3]. Dividing by total_heat gives the fraction of heat
+      // deposited in each cell; multiplying by power gives an absolute value in W.
+      // The tally has one slot per Shift cell, in the order of the cell IDs.
+      double scale = power / total_heat;
+      for (gsl::index i = 0; i < cells_.size(); ++i) {
+        heat(i) = scale * mean[cells_[i]] * inv_volume_[i];
       }
+      break;
     }
-    break;
   }
 
   return heat;
@@ -10,11 +10,12 @@
 #include "xtensor/xnorm.hpp"
 #include "xtensor/xview.hpp"
 
-#include <algorithm> // for fill_n
+#include <algorithm> // for any_of, copy, count, fill_n, max_element
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <future>
 #include <iostream>
-#include <iterator> // for back_inserter
+#include <numeric> // for accumulate
 
 namespace enrico {
 
@@ -105,9 +106,38 @@ SurrogateHeatDriver::SurrogateHeatDriver(MPI_Comm comm, pugi::xml_node node)
   Expects(subchannel_tol_p_ > 0.0);
   Expects(heat_tol_ > 0.0);
 
-  bool has_coupling = has_coupling_data();
+  // Tabulate the fluid properties over the states the subchannel solver can reach:
+  // the pressure stays near the outlet pressure, and the enthalpy rises from the inlet
+  // value up to saturation. Anything outside falls back to the exact correlations.
+  std::shared_ptr<const PropertyTable> T_table;
+  std::shared_ptr<const PropertyTable> rho_table;
+  if (property_table_tol_ > 0.0) {
+    double p_min = 0.95 * pressure_bc_;
+    double p_max = 1.05 * pressure_bc_;
+    double T_max = std::min(iapws::sat_temp(p_min), 623.15);
+    double h_min = iapws::h1(p_min, std::min(inlet_temperature_, T_max - 1.0));
+    double h_max = iapws::h1(p_min, T_max);
+    T_table = std::make_shared<PropertyTable>(
+      iapws::T_from_p_h, p_min, p_max, h_min, h_max, property_table_tol_);
+    rho_table = std::make_shared<PropertyTable>(
+      iapws::rho_from_p_h, p_min, p_max, h_min, h_max, property_table_tol_);
+  }
+
+  // The active (non-skipped) assemblies are divided among the heat ranks in row-major
+  // order; each rank owns a consecutive range of them. A rank outside the heat comm
+  // owns none.
+  gsl::index first_owned = 0;
+  gsl::index last_owned = 0;
+  if (comm_.active()) {
+    auto counts = partition_counts(n_assem_, comm_.size);
+    for (int r = 0; r < comm_.rank; ++r) {
+      first_owned += counts[r];
+    }
+    last_owned = first_owned + counts[comm_.rank];
+  }
 
   // init vector of assembly surrogate drivers
+  gsl::index n_active = 0;
   for (gsl::index row = 0; row < n_assem_y_; ++row) {
     for (gsl::index col = 0; col < n_assem_x_; ++col) {
       std::size_t assem_index = row * n_assem_x_ + col;
@@ -117,8 +147,19 @@ SurrogateHeatDriver::SurrogateHeatDriver(MPI_Comm comm, pugi::xml_node node)
           skip = true;
         }
       }
+
+      bool owned = false;
+      if (!skip) {
+        owned = n_active >= first_owned && n_active < last_owned;
+        if (owned) {
+          local_assemblies_.push_back(assem_index);
+        }
+        ++n_active;
+      }
       assembly_drivers_.push_back(
-        SurrogateHeatDriverAssembly(node, has_coupling, pressure_bc_, assem_index, skip));
+        SurrogateHeatDriverAssembly(node, owned, pressure_bc_, assem_index, skip));
+      assembly_drivers_.back().T_table_ = T_table;
+      assembly_drivers_.back().rho_table_ = rho_table;
     }
   }
 
@@ -152,12 +193,29 @@ SurrogateHeatDriver::SurrogateHeatDriver(MPI_Comm comm, pugi::xml_node node)
     if (viz_node.child("regions")) {
       viz_regions_ = viz_node.child("regions").text().as_string();
     }
+    if (viz_node.child("format")) {
+      viz_format_ = viz_node.child("format").text().as_string();
+      Expects(viz_format_ == "vtk" || viz_format_ == "vtu");
+    }
   }
 };
 
+SurrogateHeatDriver::~SurrogateHeatDriver()
+{
+  // A destructor can't throw, so an error from the last background write is reported
+  // by the rank that hit it
+  if (viz_output_.valid()) {
+    try {
+      viz_output_.get();
+    } catch (const std::exception& e) {
+      std::cerr << "Error writing VTK files: " << e.what() << std::endl;
+    }
+  }
+}
+
 int SurrogateHeatDriver::n_local_elem() const
 {
-  return this->has_coupling_data() ? this->n_global_elem() : 0;
+  return local_assemblies_.size() * (n_solid_ + n_fluid_);
 }
 
 std::size_t SurrogateHeatDriver::n_global_elem() const
@@ -165,47 +223,40 @@ std::size_t SurrogateHeatDriver::n_global_elem() const
   return n_assem_ * (n_solid_ + n_fluid_);
 }
 
-std::vector<Position> SurrogateHeatDriver::centroid() const
+void SurrogateHeatDriver::centroid(gsl::span<Position> centroids) const
 {
-  if (!this->has_coupling_data())
-    return {};
-
-  std::vector<Position> centroids;
+  Expects(centroids.size() == n_local_elem());
 
   // Establish mappings between solid regions and OpenMC cells. The center
   // coordinate for each region in the T/H model is obtained and used to
   // determine the OpenMC cell at that position.
-  for (gsl::index arow = 0; arow < n_assem_y_; ++arow) {
-    for (gsl::index acol = 0; acol < n_assem_x_; ++acol) {
-      std::size_t assem_index = arow * n_assem_x_ + acol;
-      const auto& assembly = assembly_drivers_[assem_index];
-      if (!assembly.skip_assembly_) {
-        for (gsl::index i = 0; i < n_pins_; ++i) {
-          double x_center = assembly.pin_centers_(i, 0);
-          double y_center = assembly.pin_centers_(i, 1);
-
-          for (gsl::index j = 0; j < n_axial_; ++j) {
-            double zavg = 0.5 * (z_(j) + z_(j + 1));
-
-            for (gsl::index k = 0; k < n_rings(); ++k) {
-              double ravg;
-              if (k < n_fuel_rings_) {
-                ravg = 0.5 * (assembly.r_grid_fuel_(k) + assembly.r_grid_fuel_(k + 1));
-              } else {
-                int m = k - n_fuel_rings_;
-                ravg = 0.5 * (assembly.r_grid_clad_(m) + assembly.r_grid_clad_(m + 1));
-              }
-
-              for (gsl::index m = 0; m < n_azimuthal_; ++m) {
-                double m_avg = m + 0.5;
-                double theta = 2.0 * m_avg * M_PI / n_azimuthal_;
-                double x = x_center + ravg * std::cos(theta);
-                double y = y_center + ravg * std::sin(theta);
-
-                // Determine cell instance corresponding to given pin location
-                centroids.emplace_back(x, y, zavg);
-              }
-            }
+  gsl::index e = 0;
+  for (auto assem_index : local_assemblies_) {
+    const auto& assembly = assembly_drivers_[assem_index];
+    for (gsl::index i = 0; i < n_pins_; ++i) {
+      double x_center = assembly.pin_centers_(i, 0);
+      double y_center = assembly.pin_centers_(i, 1);
+
+      for (gsl::index j = 0; j < n_axial_; ++j) {
+        double zavg = 0.5 * (z_(j) + z_(j + 1));
+
+        for (gsl::index k = 0; k < n_rings(); ++k) {
+          double ravg;
+          if (k < n_fuel_rings_) {
+            ravg = 0.5 * (assembly.r_grid_fuel_(k) + assembly.r_grid_fuel_(k + 1));
+          } else {
+            int m = k - n_fuel_rings_;
+            ravg = 0.5 * (assembly.r_grid_clad_(m) + assembly.r_grid_clad_(m + 1));
+          }
+
+          for (gsl::index m = 0; m < n_azimuthal_; ++m) {
+            double m_avg = m + 0.5;
+            double theta = 2.0 * m_avg * M_PI / n_azimuthal_;
+            double x = x_center + ravg * std::cos(theta);
+            double y = y_center + ravg * std::sin(theta);
+
+            // Determine cell instance corresponding to given pin location
+            centroids[e++] = {x, y, zavg};
           }
         }
       }
@@ -216,189 +267,119 @@ std::vector<Position> SurrogateHeatDriver::centroid() const
   // are no azimuthal divisions in the fluid phase in the OpenMC model so that we
   // can take a point on a 45 degree ray from the pin center. TODO: add a check to make
   // sure that the T/H model is finer than the OpenMC model.
-
-  for (gsl::index arow = 0; arow < n_assem_y_; ++arow) {
-    for (gsl::index acol = 0; acol < n_assem_x_; ++acol) {
-      std::size_t assem_index = arow * n_assem_x_ + acol;
-      const auto& assembly = assembly_drivers_[assem_index];
-      if (!assembly.skip_assembly_) {
-        for (gsl::index i = 0; i < n_pins_; ++i) {
-          double x_center = assembly.pin_centers_(i, 0);
-          double y_center = assembly.pin_centers_(i, 1);
-
-          for (gsl::index j = 0; j < assembly.n_axial_; ++j) {
-            double zavg = 0.5 * (z_(j) + z_(j + 1));
-            double l = pin_pitch() / std::sqrt(2.0);
-            double d = (l - clad_outer_radius_) / 2.0;
-            double x = x_center + (clad_outer_radius_ + d) * std::sqrt(2.0) / 2.0;
-            double y = y_center + (clad_outer_radius_ + d) * std::sqrt(2.0) / 2.0;
-
-            // Determine cell instance corresponding to given fluid location
-            centroids.emplace_back(x, y, zavg);
-          }
-        }
+  double l = pin_pitch() / std::sqrt(2.0);
+  double d = (l - clad_outer_radius_) / 2.0;
+  double offset = (clad_outer_radius_ + d) * std::sqrt(2.0) / 2.0;
+  for (auto assem_index : local_assemblies_) {
+    const auto& assembly = assembly_drivers_[assem_index];
+    for (gsl::index i = 0; i < n_pins_; ++i) {
+      double x = assembly.pin_centers_(i, 0) + offset;
+      double y = assembly.pin_centers_(i, 1) + offset;
+
+      for (gsl::index j = 0; j < assembly.n_axial_; ++j) {
+        double zavg = 0.5 * (z_(j) + z_(j + 1));
+
+        // Determine cell instance corresponding to given fluid location
+        centroids[e++] = {x, y, zavg};
       }
     }
   }
-
-  return centroids;
 }
 
-std::vector<double> SurrogateHeatDriver::temperature() const
+void SurrogateHeatDriver::temperature(gsl::span<double> T) const
 {
-  std::vector<double> local_temperatures;
-
-  if (this->has_coupling_data()) {
-    // first fill all solid temperatures
-    for (gsl::index arow = 0; arow < n_assem_y_; ++arow) {
-      for (gsl::index acol = 0; acol < n_assem_x_; ++acol) {
-        std::size_t assem_index = arow * n_assem_x_ + acol;
-        const auto& assembly = assembly_drivers_[assem_index];
-        if (!assembly.skip_assembly_) {
-          for (gsl::index i = 0; i < n_pins_; ++i) {
-            for (gsl::index j = 0; j < n_axial_; ++j) {
-              for (gsl::index k = 0; k < n_rings(); ++k) {
-                for (gsl::index m = 0; m < n_azimuthal_; ++m) {
-                  local_temperatures.push_back(assembly.solid_temperature_(i, j, k));
-                }
-              }
-            }
-          }
-        }
-      }
-    }
-
-    // then fill all fluid temperatures
-    for (gsl::index arow = 0; arow < n_assem_y_; ++arow) {
-      for (gsl::index acol = 0; acol < n_assem_x_; ++acol) {
-        std::size_t assem_index = arow * n_assem_x_ + acol;
-        const auto& assembly = assembly_drivers_[assem_index];
-        if (!assembly.skip_assembly_) {
-          for (double T : assembly.fluid_temperature_) {
-            local_temperatures.push_back(T);
-          }
+  Expects(T.size() == n_local_elem());
+
+  // first fill all solid temperatures
+  double* out = T.data();
+  for (auto assem_index : local_assemblies_) {
+    const auto& solid_temperature = assembly_drivers_[assem_index].solid_temperature_;
+    for (gsl::index i = 0; i < n_pins_; ++i) {
+      for (gsl::index j = 0; j < n_axial_; ++j) {
+        for (gsl::index k = 0; k < n_rings(); ++k) {
+          std::fill_n(out, n_azimuthal_, solid_temperature(i, j, k));
+          out += n_azimuthal_;
         }
       }
     }
   }
 
-  return local_temperatures;
+  // then fill all fluid temperatures
+  for (auto assem_index : local_assemblies_) {
+    const auto& fluid_temperature = assembly_drivers_[assem_index].fluid_temperature_;
+    out = std::copy(fluid_temperature.cbegin(), fluid_temperature.cend(), out);
+  }
 }
 
-std::vector<double> SurrogateHeatDriver::density() const
+void SurrogateHeatDriver::density(gsl::span<double> rho) const
 {
-  std::vector<double> local_densities;
-
-  if (this->has_coupling_data()) {
-    // Solid region just gets zeros for densities (not used)
-    auto n = n_pins_ * n_axial_ * n_rings() * n_azimuthal_;
-    std::fill_n(std::back_inserter(local_densities), n * n_assem_, 0.0);
-
-    // iterate over each assembly to get fluid densities
-    for (gsl::index arow = 0; arow < n_assem_y_; ++arow) {
-      for (gsl::index acol = 0; acol < n_assem_x_; ++acol) {
-        std::size_t assem_index = arow * n_assem_x_ + acol;
-        const auto& assembly = assembly_drivers_[assem_index];
-        if (!assembly.skip_assembly_) {
-          // Add fluid densities and return
-          for (double rho : assembly.fluid_density_) {
-            local_densities.push_back(rho);
-          }
-        }
-      }
-    }
+  Expects(rho.size() == n_local_elem());
+
+  // Solid region just gets zeros for densities (not used)
+  double* out = std::fill_n(rho.data(), n_solid_ * local_assemblies_.size(), 0.0);
+
+  // iterate over each assembly to get fluid densities
+  for (auto assem_index : local_assemblies_) {
+    const auto& fluid_density = assembly_drivers_[assem_index].fluid_density_;
+    out = std::copy(fluid_density.cbegin(), fluid_density.cend(), out);
   }
-  return local_densities;
 }
 
 int SurrogateHeatDriver::in_fluid_at(int32_t local_elem) const
 {
-  return local_elem >= n_solid_ * n_assem_;
+  return local_elem >= n_solid_ * local_assemblies_.size();
 }
 
-std::vector<int> SurrogateHeatDriver::fluid_mask() const
+void SurrogateHeatDriver::fluid_mask(gsl::span<int> mask) const
 {
-  std::vector<int> fluid_mask;
-  if (this->has_coupling_data()) {
-    std::fill_n(std::back_inserter(fluid_mask), n_solid_ * n_assem_, 0);
-    std::fill_n(std::back_inserter(fluid_mask), n_fluid_ * n_assem_, 1);
-  }
-  return fluid_mask;
+  Expects(mask.size() == n_local_elem());
+  auto n_solid = n_solid_ * local_assemblies_.size();
+  std::fill_n(mask.data(), n_solid, 0);
+  std::fill(mask.data() + n_solid, mask.data() + mask.size(), 1);
 }
 
-std::vector<double> SurrogateHeatDriver::volume() const
+void SurrogateHeatDriver::volume(gsl::span<double> volumes) const
 {
-  std::vector<double> volumes;
-
-  if (this->has_coupling_data()) {
-    // get volume of solid regions first
-    for (gsl::index arow = 0; arow < n_assem_y_; ++arow) {
-      for (gsl::index acol = 0; acol < n_assem_x_; ++acol) {
-        std::size_t assem_index = arow * n_assem_x_ + acol;
-        const auto& assembly = assembly_drivers_[assem_index];
-        if (!assembly.skip_assembly_) {
-          // Volume of solid regions
-          for (gsl::index i = 0; i < n_pins_; ++i) {
-            for (gsl::index j = 0; j < n_axial_; ++j) {
-              double dz = z_(j + 1) - z_(j);
-              for (gsl::index k = 0; k < n_rings(); ++k) {
-                for (gsl::index m = 0; m < n_azimuthal_; ++m) {
-                  volumes.push_back(assembly.solid_areas_(k) * dz / n_azimuthal_);
-                }
-              }
-            }
-          }
+  Expects(volumes.size() == n_local_elem());
+
+  // get volume of solid regions first
+  double* out = volumes.data();
+  for (auto assem_index : local_assemblies_) {
+    const auto& assembly = assembly_drivers_[assem_index];
+    // Volume of solid regions
+    for (gsl::index i = 0; i < n_pins_; ++i) {
+      for (gsl::index j = 0; j < n_axial_; ++j) {
+        double dz = z_(j + 1) - z_(j);
+        for (gsl::index k = 0; k < n_rings(); ++k) {
+          std::fill_n(out, n_azimuthal_, assembly.solid_areas_(k) * dz / n_azimuthal_);
+          out += n_azimuthal_;
         }
       }
     }
+  }
 
-    // volume of fluid regions
-    for (gsl::index arow = 0; arow < n_assem_y_; ++arow) {
-      for (gsl::index acol = 0; acol < n_assem_x_; ++acol) {
-        std::size_t assem_index = arow * n_assem_x_ + acol;
-        const auto& assembly = assembly_drivers_[assem_index];
-        if (!assembly.skip_assembly_) {
-          // Volume of fluid regions
-          for (gsl::index i = 0; i < n_pins_; ++i) {
-            for (gsl::index j = 0; j < n_axial_; ++j) {
-              double dz = z_(j + 1) - z_(j);
-              double area =
-                pin_pitch_ * pin_pitch_ - M_PI * clad_outer_radius_ * clad_outer_radius_;
-              volumes.push_back(area * dz);
-            }
-          }
-        }
+  // volume of fluid regions
+  double area = pin_pitch_ * pin_pitch_ - M_PI * clad_outer_radius_ * clad_outer_radius_;
+  for (gsl::index a = 0; a < local_assemblies_.size(); ++a) {
+    for (gsl::index i = 0; i < n_pins_; ++i) {
+      for (gsl::index j = 0; j < n_axial_; ++j) {
+        *out++ = area * (z_(j + 1) - z_(j));
       }
     }
   }
-
-  return volumes;
 }
 
 int SurrogateHeatDriver::set_heat_source_at(int32_t local_elem, double heat)
 {
-  if (local_elem >= n_solid_ * n_assem_)
+  if (local_elem >= n_solid_ * local_assemblies_.size())
     return 0;
 
-  // get assembly index:
-  // calculated index is relative to active assemblies, so need to account
-  // for any skipped assemblies in the full core. Add 1 for each skipped assembly.
-  gsl::index assem = (local_elem / (n_pins_ * n_axial_ * n_rings() * n_azimuthal_));
-  if (n_skip_ > 0) {
-    for (gsl::index i = 0; i < skip_assemblies_.size(); ++i) {
-      if (skip_assemblies_[i] <= assem) {
-        ++assem;
-      }
-    }
-  }
-
-  if (assembly_drivers_[assem].skip_assembly_) {
-    return 0;
-  }
+  // The solid elements are numbered assembly by assembly in the order of the
+  // assemblies owned by this rank
+  gsl::index assem = local_assemblies_[local_elem / n_solid_];
 
   // Determine indices within assembly
-  gsl::index assem_local_elem =
-    local_elem % (n_pins_ * n_axial_ * n_rings() * n_azimuthal_);
+  gsl::index assem_local_elem = local_elem % n_solid_;
   gsl::index pin = assem_local_elem / (n_axial_ * n_rings() * n_azimuthal_);
   gsl::index axial = (assem_local_elem / (n_rings() * n_azimuthal_)) % n_axial_;
   gsl::index ring = (assem_local_elem / n_azimuthal_) % n_rings();
@@ -409,23 +390,36 @@ int SurrogateHeatDriver::set_heat_source_at(int32_t local_elem, double heat)
   return 0;
 }
 
+void SurrogateHeatDriver::set_heat_sources(gsl::span<const double> heat)
+{
+  Expects(heat.size() == n_local_elem());
+  const double* in = heat.data();
+  for (auto assem_index : local_assemblies_) {
+    auto& source = assembly_drivers_[assem_index].source_;
+    Expects(source.size() == n_solid_);
+    std::copy(in, in + n_solid_, source.data());
+    in += n_solid_;
+  }
+}
+
 void SurrogateHeatDriver::solve_step()
 {
   timer_solve_step.start();
-  if (has_coupling_data()) {
-    // iterate over each assembly for each solve step
-    for (gsl::index row = 0; row < n_assem_y_; ++row) {
-      for (gsl::index col = 0; col < n_assem_x_; ++col) {
-        int assem_index = row * n_assem_x_ + col;
-        if (!assembly_drivers_[assem_index].skip_assembly_) {
-          comm_.message("Solving fluid equation for assembly " +
-                        std::to_string(assem_index) + " ...");
-          assembly_drivers_[assem_index].solve_fluid();
-          comm_.message("Solving heat equation for assembly " +
-                        std::to_string(assem_index) + " ...");
-          assembly_drivers_[assem_index].solve_heat();
-        }
-      }
+  // iterate over each owned assembly for each solve step. The assemblies are
+  // independent, so each one is solved as a task; solve_fluid() and solve_heat() split
+  // their channel and pin loops into further tasks, which keeps all threads busy
+  // whether a rank owns one assembly or many.
+#pragma omp parallel default(none)
+#pragma omp single
+  for (auto assem_index : local_assemblies_) {
+    comm_.message("Solving fluid and heat equations for assembly " +
+                  std::to_string(assem_index) + " ...");
+#pragma omp task default(none) firstprivate(assem_index)
+    {
+      auto& assembly = assembly_drivers_[assem_index];
+      assembly.mark_changed_pins();
+      assembly.solve_fluid();
+      assembly.solve_heat();
     }
   }
   timer_solve_step.stop();
@@ -452,19 +446,72 @@ void SurrogateHeatDriver::write_step(int timestep, int iteration)
     filename_base << "_t" << timestep << "_i" << iteration;
   }
 
-  // write one file per assembly
-  for (gsl::index assem = 0; assem < n_assem_ + n_skip_; ++assem) {
-    if (!assembly_drivers_[assem].skip_assembly_) {
-      SurrogateVtkWriter vtk_writer(
-        assembly_drivers_[assem], vtk_radial_res_, viz_regions_, viz_data_);
+  // The files of the previous call must be written before new ones are started; this
+  // also reports any error in writing them
+  if (viz_output_.valid()) {
+    viz_output_.get();
+  }
 
-      std::stringstream filename;
-      filename << filename_base.str() << "_" << assem << ".vtk";
+  // The writers are kept between calls, since building the geometry of an assembly
+  // takes longer than gathering its fields
+  if (vtk_writers_.empty()) {
+    for (auto assem : local_assemblies_) {
+      vtk_writers_.emplace_back(new SurrogateVtkWriter(
+        assembly_drivers_[assem], vtk_radial_res_, viz_regions_, viz_data_));
+    }
+  }
+
+  // write one file per assembly; each rank writes the assemblies it owns. The fields
+  // are copied now and written in the background, so that the next solve does not
+  // wait for the files.
+  struct VizFile {
+    const SurrogateVtkWriter* writer;
+    std::string filename;
+    SurrogateVtkWriter::Fields fields;
+  };
+  bool vtu = viz_format_ == "vtu";
+  std::vector<VizFile> files;
+  for (gsl::index i = 0; i < local_assemblies_.size(); ++i) {
+    std::stringstream filename;
+    filename << filename_base.str() << "_" << local_assemblies_[i]
+             << (vtu ? ".vtu" : ".vtk");
+    comm_.message("Writing VTK file: " + filename.str());
+    const auto* writer = vtk_writers_[i].get();
+    files.push_back({writer, filename.str(), writer->cell_fields()});
+  }
 
-      comm_.message("Writing VTK file: " + filename.str());
-      vtk_writer.write(filename.str());
+  // The first rank also writes the index of the files of all assemblies, which are
+  // named relative to it
+  std::string index_filename;
+  std::vector<std::string> pieces;
+  if (vtu && comm_.rank == 0) {
+    index_filename = filename_base.str() + ".pvtu";
+    std::string prefix = filename_base.str();
+    prefix = prefix.substr(prefix.find_last_of('/') + 1);
+    for (const auto& assembly : assembly_drivers_) {
+      if (!assembly.skip_assembly_) {
+        pieces.push_back(prefix + "_" + std::to_string(assembly.index) + ".vtu");
+      }
     }
+    comm_.message("Writing VTK file: " + index_filename);
   }
+
+  viz_output_ = std::async(std::launch::async,
+                           [vtu,
+                            files = std::move(files),
+                            index_filename = std::move(index_filename),
+                            pieces = std::move(pieces)]() {
+                             for (const auto& file : files) {
+                               if (vtu) {
+                                 file.writer->write_vtu(file.filename, file.fields);
+                               } else {
+                                 file.writer->write(file.filename, file.fields);
+                               }
+                             }
+                             if (!index_filename.empty()) {
+                               files.front().writer->write_pvtu(index_filename, pieces);
+                             }
+                           });
   // timer_write_step.stop();
   return;
 }
@@ -502,6 +549,7 @@ SurrogateHeatDriverAssembly::SurrogateHeatDriverAssembly(pugi::xml_node node,
   }
 
   // check if this assembly should be skipped and do not do any other setup
+  this->index = index;
   skip_assembly_ = skip_assembly;
   if (skip_assembly_) {
     return;
@@ -521,6 +569,8 @@ SurrogateHeatDriverAssembly::SurrogateHeatDriverAssembly(pugi::xml_node node,
     subchannel_tol_p_ = node.child("subchannel_tol_p").text().as_double();
   if (node.child("heat_tol"))
     heat_tol_ = node.child("heat_tol").text().as_double();
+  if (node.child("source_change_tol"))
+    source_change_tol_ = node.child("source_change_tol").text().as_double();
 
   verbosity_ = verbose::NONE;
   if (node.child("verbosity")) {
@@ -552,6 +602,7 @@ SurrogateHeatDriverAssembly::SurrogateHeatDriverAssembly(pugi::xml_node node,
   Expects(subchannel_tol_h_ > 0.0);
   Expects(subchannel_tol_p_ > 0.0);
   Expects(heat_tol_ > 0.0);
+  Expects(source_change_tol_ >= 0.0);
   Expects(n_assem_x_ > 0);
   Expects(n_assem_y_ > 0);
   Expects(assembly_width_x_ >= pin_pitch_ * n_pins_x_);
@@ -669,9 +720,93 @@ void SurrogateHeatDriverAssembly::generate_arrays()
     source_ = xt::empty<double>({n_pins_, n_axial_, n_rings(), n_azimuthal_});
     solid_temperature_ = xt::empty<double>({n_pins_, n_axial_, n_rings()});
 
+    // Create arrays for the conduction solver
+    r_grid_fuel_m_ = 0.01 * r_grid_fuel_;
+    r_grid_clad_m_ = 0.01 * r_grid_clad_;
+    ring_source_ = xt::empty<double>({n_pins_, n_axial_, n_rings()});
+    heat_iterations_ = xt::zeros<int>({n_pins_, n_axial_});
+
     // Create empty arrays for temperature and density in the fluid phase
     fluid_temperature_ = xt::empty<double>({n_pins_, n_axial_});
     fluid_density_ = xt::empty<double>({n_pins_, n_axial_});
+
+    // Create the scratch arrays of the subchannel solver
+    channel_areas_.resize({n_channels_});
+    for (gsl::index i = 0; i < n_channels_; ++i)
+      channel_areas_(i) = channels_[i].area_;
+    channel_powers_.resize({n_axial_, n_channels_});
+    for (auto* face : {&h_, &p_, &u_, &h_old_, &p_old_})
+      face->resize({n_axial_ + 1, n_channels_});
+    std::fill(u_.begin(), u_.end(), 0.0);
+    for (auto* cell : {&h_cell_, &p_cell_, &T_cell_, &rho_cell_})
+      cell->resize({n_axial_, n_channels_});
+    rho_high_.resize({n_channels_});
+    rho_low_.resize({n_channels_});
+
+    // Until a first solve, every pin and channel needs to be solved
+    source_solved_ = xt::zeros<double>({n_pins_, n_axial_, n_rings(), n_azimuthal_});
+    pin_solve_.assign(n_pins_, 1);
+    channel_solve_.assign(n_channels_, 1);
+    block_solve_.assign((n_channels_ + channel_block - 1) / channel_block, 1);
+  }
+}
+
+void SurrogateHeatDriverAssembly::mark_changed_pins()
+{
+  // Without a previous solution to keep, or without a threshold, everything is solved
+  if (!has_solid_solution_ || source_change_tol_ <= 0.0) {
+    std::copy(source_.cbegin(), source_.cend(), source_solved_.begin());
+    std::fill(pin_solve_.begin(), pin_solve_.end(), 1);
+    std::fill(channel_solve_.begin(), channel_solve_.end(), 1);
+    std::fill(block_solve_.begin(), block_solve_.end(), 1);
+    return;
+  }
+
+  // A pin has changed when the largest change in its source exceeds the threshold
+  // relative to the largest value of the source it was last solved with. Only then is
+  // its reference source updated, so that small changes over several steps add up.
+  std::size_t n_pin_source = n_axial_ * n_rings() * n_azimuthal_;
+  std::vector<char> changed(n_pins_, 0);
+  for (gsl::index pin = 0; pin < n_pins_; ++pin) {
+    const double* q = &source_(pin, 0, 0, 0);
+    double* q_solved = &source_solved_(pin, 0, 0, 0);
+    double change = 0.0;
+    double scale = 0.0;
+    for (std::size_t k = 0; k < n_pin_source; ++k) {
+      change = std::max(change, std::abs(q[k] - q_solved[k]));
+      scale = std::max(scale, std::abs(q_solved[k]));
+    }
+
+    if (change > source_change_tol_ * scale) {
+      changed[pin] = 1;
+      std::copy(q, q + n_pin_source, q_solved);
+    }
+  }
+
+  // A channel is solved again when any rod it touches has changed
+  for (gsl::index chan = 0; chan < n_channels_; ++chan) {
+    const auto& rod_ids = channels_[chan].rod_ids_;
+    channel_solve_[chan] =
+      std::any_of(rod_ids.begin(), rod_ids.end(), [&changed](std::size_t rod) {
+        return changed[rod];
+      });
+  }
+
+  // A pin is solved again when any channel around it is, since its cladding surface
+  // temperature then changes too
+  for (gsl::index pin = 0; pin < n_pins_; ++pin) {
+    const auto& channel_ids = rods_[pin].channel_ids_;
+    pin_solve_[pin] =
+      std::any_of(channel_ids.begin(), channel_ids.end(), [this](std::size_t chan) {
+        return channel_solve_[chan];
+      });
+  }
+
+  for (gsl::index b = 0; b < block_solve_.size(); ++b) {
+    auto first = channel_solve_.begin() + b * channel_block;
+    auto last = channel_solve_.begin() + std::min<gsl::index>((b + 1) * channel_block,
+                                                               n_channels_);
+    block_solve_[b] = std::any_of(first, last, [](char solve) { return solve; });
   }
 }
 
@@ -683,8 +818,8 @@ bool SurrogateHeatDriverAssembly::is_mass_conserved(const xt::xtensor<double, 2>
   for (gsl::index axial = 0; axial < n_axial_; ++axial) {
     double mass_flowrate = 0.0;
     for (gsl::index chan = 0; chan < n_channels_; ++chan) {
-      double u_cell_centered = 0.5 * (u(chan, axial) + u(chan, axial + 1));
-      mass_flowrate += u_cell_centered * channels_[chan].area_ * rho(chan, axial);
+      double u_cell_centered = 0.5 * (u(axial, chan) + u(axial + 1, chan));
+      mass_flowrate += u_cell_centered * channels_[chan].area_ * rho(axial, chan);
     }
 
     double tol = std::abs(mass_flowrate - mass_flowrate_) / mass_flowrate_;
@@ -712,14 +847,14 @@ bool SurrogateHeatDriverAssembly::is_energy_conserved(
 
   for (gsl::index axial = 0; axial < n_axial_; ++axial) {
     for (gsl::index chan = 0; chan < n_channels_; ++chan) {
-      double u_cell_centered = 0.5 * (u(chan, axial) + u(chan, axial + 1));
-      double mass_flowrate = rho(chan, axial) * channels_[chan].area_ * u_cell_centered;
+      double u_cell_centered = 0.5 * (u(axial, chan) + u(axial + 1, chan));
+      double mass_flowrate = rho(axial, chan) * channels_[chan].area_ * u_cell_centered;
 
       // conversion factor of 1e3 to convert enthalpy from kJ/kg to J/kg
       double channel_energy_change =
-        mass_flowrate * (h(chan, axial + 1) - h(chan, axial)) * 1.0e3;
+        mass_flowrate * (h(axial + 1, chan) - h(axial, chan)) * 1.0e3;
 
-      double tol = std::abs(channel_energy_change - q(chan, axial)) / q(chan, axial);
+      double tol = std::abs(channel_energy_change - q(axial, chan)) / q(axial, chan);
 
       if (tol > 1e-3) {
         energy_conserved = false;
@@ -752,66 +887,141 @@ double SurrogateHeatDriverAssembly::rod_axial_node_power(const int pin,
   return power;
 }
 
+void SurrogateHeatDriverAssembly::T_from_p_h(std::size_t n,
+                                             const double* p,
+                                             const double* h,
+                                             double* T) const
+{
+  if (T_table_) {
+    T_table_->evaluate(n, p, h, T);
+  } else {
+    for (std::size_t i = 0; i < n; ++i) {
+      T[i] = iapws::T_from_p_h(p[i], h[i]);
+    }
+  }
+}
+
+void SurrogateHeatDriverAssembly::rho_from_p_h(std::size_t n,
+                                               const double* p,
+                                               const double* h,
+                                               double* rho) const
+{
+  if (rho_table_) {
+    rho_table_->evaluate(n, p, h, rho);
+  } else {
+    for (std::size_t i = 0; i < n; ++i) {
+      rho[i] = iapws::rho_from_p_h(p[i], h[i]);
+    }
+  }
+}
+
+void SurrogateHeatDriverAssembly::march_channels(gsl::index first, gsl::index last)
+{
+  gsl::index n = last - first;
+  const double* w = channel_flowrates_.data() + first;
+  const double* area = channel_areas_.data() + first;
+
+  // solve for enthalpy by simple energy balance q = mdot * dh by marching from
+  // inlet; divide term on RHS by 1e3 to convert from J/kg to kJ/kg
+  double* h0 = &h_(0, first);
+  const double* p0 = &p_(0, first);
+  for (gsl::index c = 0; c < n; ++c) {
+    h0[c] = iapws::h1(p0[c], inlet_temperature_);
+  }
+  for (gsl::index axial = 0; axial < n_axial_; ++axial) {
+    const double* h_lo = &h_(axial, first);
+    const double* q = &channel_powers_(axial, first);
+    double* h_hi = &h_(axial + 1, first);
+#pragma omp simd
+    for (gsl::index c = 0; c < n; ++c) {
+      h_hi[c] = h_lo[c] + 1e-3 * q[c] / w[c];
+    }
+  }
+
+  // solve for pressure using one-sided finite difference approximation by
+  // marching from outlet and solving the axial momentum equation.
+  double* rho_high = &rho_high_(first);
+  double* rho_low = &rho_low_(first);
+  std::fill_n(&p_(n_axial_, first), n, pressure_bc_);
+  for (gsl::index axial = n_axial_; axial > 0; axial--) {
+    this->rho_from_p_h(n, &p_(axial, first), &h_(axial, first), rho_high);
+    this->rho_from_p_h(n, &p_(axial - 1, first), &h_(axial - 1, first), rho_low);
+
+    double* u_hi = &u_(axial, first);
+    double* u_lo = &u_(axial - 1, first);
+    const double* p_hi = &p_(axial, first);
+    double* p_lo = &p_(axial - 1, first);
+    double gdz = g_ * (z_(axial) - z_(axial - 1));
+#pragma omp simd
+    for (gsl::index c = 0; c < n; ++c) {
+      u_hi[c] = w[c] / (rho_high[c] * area[c]);
+      u_lo[c] = w[c] / (rho_low[c] * area[c]);
+
+      // factor of 1e-6 needed for convert from Pa to MPa
+      p_lo[c] =
+        p_hi[c] + 1.0e-6 * (w[c] / area[c] * (u_hi[c] - u_lo[c]) + gdz * rho_low[c]);
+    }
+  }
+}
+
 void SurrogateHeatDriverAssembly::solve_fluid()
 {
+  // channels are solved in blocks, each marched with vector operations across its
+  // channels; the blocks are independent tasks. Blocks whose channels have not been
+  // marked by mark_changed_pins() keep their previous solution.
+  gsl::index n_blocks = block_solve_.size();
+  if (std::none_of(block_solve_.begin(), block_solve_.end(), [](char s) { return s; }))
+    return;
+
   // determine the power deposition in each channel; the target applications will
   // always be steady-state or pseudo-steady-state cases with no axial conduction such
   // that the power deposition in each channel is independent of a convective heat
   // transfer coefficient and only depends on the rod power at that axial elevation.
-  // The channel powers are indexed by channel ID, axial ID
-  xt::xtensor<double, 2> channel_powers({n_channels_, n_axial_}, 0.0);
+  // The channel powers are indexed by axial ID, channel ID
+#pragma omp taskloop default(none)
   for (int i = 0; i < n_channels_; ++i) {
+    if (!channel_solve_[i])
+      continue;
     for (int j = 0; j < n_axial_; ++j) {
+      channel_powers_(j, i) = 0.0;
       for (const auto& rod : channels_[i].rod_ids_)
-        channel_powers(i, j) += 0.25 * rod_axial_node_power(rod, j);
+        channel_powers_(j, i) += 0.25 * rod_axial_node_power(rod, j);
     }
   }
 
   // initial guesses for the fluid solution are uniform temperature (set to the inlet
   // temperature) and uniform pressure  (set to the outlet pressure). These solution
-  // fields are defined on channel axial faces. The units used throughout this section
-  // are h (kJ/kg), P (MPa), u (m/s), rho (kg/m^3). Unit conversions are performed as
-  // necessary on the converged results before being used in the Monte Carlo solver.
-  // Enthalpy here requires a factor of 1e-3 to convert from J/kg to kJ/kg.
-  xt::xtensor<double, 2> h({n_channels_, n_axial_ + 1},
-                           iapws::h1(pressure_bc_, inlet_temperature_));
-  xt::xtensor<double, 2> p({n_channels_, n_axial_ + 1}, pressure_bc_);
-
-  // for certain verbosity settings, we will need to save the velocity solutions
-  xt::xtensor<double, 2> u = xt::zeros<double>({n_channels_, n_axial_ + 1});
+  // fields are defined on channel axial faces and stored with the channel index
+  // varying fastest, so that all channels are marched together along the axial
+  // direction. The units used throughout this section are h (kJ/kg), P (MPa),
+  // u (m/s), rho (kg/m^3). Unit conversions are performed as necessary on the
+  // converged results before being used in the Monte Carlo solver. Enthalpy here
+  // requires a factor of 1e-3 to convert from J/kg to kJ/kg.
+  double h_inlet = iapws::h1(pressure_bc_, inlet_temperature_);
+  for (gsl::index b = 0; b < n_blocks; ++b) {
+    if (!block_solve_[b])
+      continue;
+    gsl::index first = b * channel_block;
+    gsl::index n = std::min<gsl::index>(channel_block, n_channels_ - first);
+    for (gsl::index axial = 0; axial <= n_axial_; ++axial) {
+      std::fill_n(&h_(axial, first), n, h_inlet);
+      std::fill_n(&p_(axial, first), n, pressure_bc_);
+    }
+  }
 
   bool converged = false;
   for (gsl::index iter = 0; iter < max_subchannel_its_; ++iter) {
     // save the previous solution
-    xt::xtensor<double, 2> h_old = h;
-    xt::xtensor<double, 2> p_old = p;
+    std::copy(h_.begin(), h_.end(), h_old_.begin());
+    std::copy(p_.begin(), p_.end(), p_old_.begin());
 
     // solve each channel independently
-    for (gsl::index chan = 0; chan < n_channels_; ++chan) {
-      const auto& c = channels_[chan];
-
-      // solve for enthalpy by simple energy balance q = mdot * dh by marching from
-      // inlet; divide term on RHS by 1e3 to convert from J/kg to kJ/kg
-      h(chan, 0) = iapws::h1(p(chan, 0), inlet_temperature_);
-      for (gsl::index axial = 0; axial < n_axial_; ++axial)
-        h(chan, axial + 1) =
-          h(chan, axial) + 1e-3 * channel_powers(chan, axial) / channel_flowrates_(chan);
-
-      // solve for pressure using one-sided finite difference approximation by
-      // marching from outlet and solving the axial momentum equation.
-      p(chan, n_axial_) = pressure_bc_;
-      for (gsl::index axial = n_axial_; axial > 0; axial--) {
-        double rho_high = iapws::rho_from_p_h(p(chan, axial), h(chan, axial));
-        double rho_low = iapws::rho_from_p_h(p(chan, axial - 1), h(chan, axial - 1));
-
-        u(chan, axial) = channel_flowrates_(chan) / (rho_high * c.area_);
-        u(chan, axial - 1) = channel_flowrates_(chan) / (rho_low * c.area_);
-
-        // factor of 1e-6 needed for convert from Pa to MPa
-        p[axial - 1] = p[axial] + 1.0e-6 * (channel_flowrates_(chan) / c.area_ *
-                                              (u(chan, axial) - u(chan, axial - 1)) +
-                                            g_ * (z_(axial) - z_(axial - 1)) * rho_low);
-      }
+#pragma omp taskloop default(none) shared(n_blocks)
+    for (gsl::index b = 0; b < n_blocks; ++b) {
+      if (!block_solve_[b])
+        continue;
+      gsl::index first = b * channel_block;
+      this->march_channels(first, std::min<gsl::index>(first + channel_block, n_channels_));
     }
 
     // after solving all channels, check for convergence; although all channels are
@@ -819,8 +1029,14 @@ void SurrogateHeatDriverAssembly::solve_fluid()
     // convergence check is performed on all channels together, rather than each
     // separately, since in a more sophisticated solver the channels would all be
     // linked
-    auto h_norm = xt::norm_l1(h - h_old)();
-    auto p_norm = xt::norm_l1(p - p_old)();
+    double h_norm = 0.0;
+    double p_norm = 0.0;
+    std::size_t n_faces = h_.size();
+#pragma omp simd reduction(+ : h_norm, p_norm)
+    for (std::size_t i = 0; i < n_faces; ++i) {
+      h_norm += std::abs(h_.data()[i] - h_old_.data()[i]);
+      p_norm += std::abs(p_.data()[i] - p_old_.data()[i]);
+    }
 
     converged = (h_norm < subchannel_tol_h_) && (p_norm < subchannel_tol_p_);
 
@@ -838,16 +1054,25 @@ void SurrogateHeatDriverAssembly::solve_fluid()
 
   // compute temperature and density from enthalpy and pressure in a cell-centered
   // basis
-  xt::xtensor<double, 2> T({n_channels_, n_axial_});
-  xt::xtensor<double, 2> rho({n_channels_, n_axial_});
-
-  for (gsl::index chan = 0; chan < n_channels_; ++chan) {
+  for (gsl::index b = 0; b < n_blocks; ++b) {
+    if (!block_solve_[b])
+      continue;
+    gsl::index first = b * channel_block;
+    gsl::index n = std::min<gsl::index>(channel_block, n_channels_ - first);
     for (gsl::index axial = 0; axial < n_axial_; ++axial) {
-      double h_mean = 0.5 * (h(chan, axial) + h(chan, axial + 1));
-      double p_mean = 0.5 * (p(chan, axial) + p(chan, axial + 1));
-
-      T(chan, axial) = iapws::T_from_p_h(p_mean, h_mean);
-      rho(chan, axial) = iapws::rho_from_p_h(p_mean, h_mean);
+      const double* h_lo = &h_(axial, first);
+      const double* h_hi = &h_(axial + 1, first);
+      const double* p_lo = &p_(axial, first);
+      const double* p_hi = &p_(axial + 1, first);
+      double* h = &h_cell_(axial, first);
+      double* p = &p_cell_(axial, first);
+#pragma omp simd
+      for (gsl::index c = 0; c < n; ++c) {
+        h[c] = 0.5 * (h_lo[c] + h_hi[c]);
+        p[c] = 0.5 * (p_lo[c] + p_hi[c]);
+      }
+      this->T_from_p_h(n, p, h, &T_cell_(axial, first));
+      this->rho_from_p_h(n, p, h, &rho_cell_(axial, first));
     }
   }
 
@@ -861,18 +1086,18 @@ void SurrogateHeatDriverAssembly::solve_fluid()
       fluid_density_(rod, axial) = 0.0;
 
       for (const auto& c : rods_[rod].channel_ids_) {
-        fluid_temperature_(rod, axial) += 0.25 * T(c, axial);
+        fluid_temperature_(rod, axial) += 0.25 * T_cell_(axial, c);
 
         // factor of 1e-3 to convert from kg/m^3 to g/cm^3
-        fluid_density_(rod, axial) += 0.25 * rho(c, axial) * 1.0e-3;
+        fluid_density_(rod, axial) += 0.25 * rho_cell_(axial, c) * 1.0e-3;
       }
     }
   }
 
   // Perform diagnostic checks if verbosity is sufficiently high
   if (verbosity_ >= verbose::LOW) {
-    bool mass_conserved = is_mass_conserved(rho, u);
-    bool energy_conserved = is_energy_conserved(rho, u, h, channel_powers);
+    bool mass_conserved = is_mass_conserved(rho_cell_, u_);
+    bool energy_conserved = is_energy_conserved(rho_cell_, u_, h_, channel_powers_);
 
     Expects(mass_conserved);
     Expects(energy_conserved);
@@ -881,32 +1106,61 @@ void SurrogateHeatDriverAssembly::solve_fluid()
 
 void SurrogateHeatDriverAssembly::solve_heat()
 {
-  // Convert source to [W/m^3] as expected by Magnolia
-  xt::xtensor<double, 3> q = 1e6 * xt::mean(source_, 3);
-
-  // Convert radial grids to [m] as expected by Magnolia
-  xt::xtensor<double, 1> r_fuel = 0.01 * r_grid_fuel_;
-  xt::xtensor<double, 1> r_clad = 0.01 * r_grid_clad_;
-
+  // each (pin, axial) conduction problem is independent; pins that have not been
+  // marked by mark_changed_pins() keep their previous solution
+  bool warm_start = has_solid_solution_;
+#pragma omp taskloop default(none) shared(warm_start) collapse(2)
   for (gsl::index i = 0; i < n_pins_; ++i) {
     for (gsl::index j = 0; j < n_axial_; ++j) {
+      if (warm_start && !pin_solve_[i]) {
+        heat_iterations_(i, j) = 0;
+        continue;
+      }
+
+      // Average the source over the azimuthal segments of each ring and convert it
+      // to [W/m^3] as expected by Magnolia
+      double* q = &ring_source_(i, j, 0);
+      for (gsl::index k = 0; k < n_rings(); ++k) {
+        const double* q_azimuthal = &source_(i, j, k, 0);
+        double sum = 0.0;
+        for (gsl::index m = 0; m < n_azimuthal_; ++m) {
+          sum += q_azimuthal[m];
+        }
+        q[k] = 1e6 * sum / n_azimuthal_;
+      }
+
       // approximate cladding surface temperature as equal to the fluid
       // temperature, i.e. this neglects any heat transfer resistance
       double T_co = fluid_temperature_(i, j);
 
-      // Set initial temperature to surface temperature
-      xt::view(solid_temperature_, i, j) = T_co;
+      // The first solve starts from the surface temperature; later ones start from
+      // the previous Picard iterate, which is close to converged
+      double* T = &solid_temperature_(i, j, 0);
+      if (!warm_start) {
+        std::fill_n(T, n_rings(), T_co);
+      }
 
-      solve_steady_nonlin(&q(i, j, 0),
-                          T_co,
-                          r_fuel.data(),
-                          r_clad.data(),
-                          n_fuel_rings_,
-                          n_clad_rings_,
-                          heat_tol_,
-                          &solid_temperature_(i, j, 0));
+      heat_iterations_(i, j) = solve_steady_nonlin(q,
+                                                   T_co,
+                                                   r_grid_fuel_m_.data(),
+                                                   r_grid_clad_m_.data(),
+                                                   n_fuel_rings_,
+                                                   n_clad_rings_,
+                                                   heat_tol_,
+                                                   T);
     }
   }
+  has_solid_solution_ = true;
+
+  if (verbosity_ >= verbose::LOW) {
+    auto n_pins_solved = std::count(pin_solve_.begin(), pin_solve_.end(), 1);
+    auto n_solves = std::max<std::size_t>(n_pins_solved * n_axial_, 1);
+    auto total = std::accumulate(heat_iterations_.cbegin(), heat_iterations_.cend(), 0);
+    auto max = std::max_element(heat_iterations_.cbegin(), heat_iterations_.cend());
+    std::cout << "Conduction solve in assembly " << index << ": " << n_pins_solved
+              << " of " << n_pins_ << " pins solved, " << *max << " iterations at most, "
+              << double(total) / n_solves << " on average" << std::endl;
+  }
 }
 
 double SurrogateHeatDriverAssembly::solid_temperature(std::size_t pin,
@@ -0,0 +1,392 @@
+#include "enrico/surrogate_neutronics_driver.h"
+
+#include "openmc/xml_interface.h"
+
+#include <gsl/gsl-lite.hpp>     // for Expects
+#include <xtensor/xbuilder.hpp> // for zeros
+
+#include <algorithm> // for max, min
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace enrico {
+
+SurrogateNeutronicsDriver::SurrogateNeutronicsDriver(MPI_Comm comm,
+                                                     pugi::xml_node node,
+                                                     pugi::xml_node heat_node)
+  : NeutronicsDriver{comm}
+{
+  timer_driver_setup.start();
+
+  // The pin lattice is the one of the surrogate heat-fluids driver
+  if (std::string{heat_node.child_value("driver")} != "surrogate") {
+    throw std::runtime_error{
+      "The surrogate neutronics driver requires the surrogate heat-fluids driver"};
+  }
+  clad_inner_radius_ = heat_node.child("clad_inner_radius").text().as_double();
+  clad_outer_radius_ = heat_node.child("clad_outer_radius").text().as_double();
+  pin_pitch_ = heat_node.child("pin_pitch").text().as_double();
+  n_pins_x_ = heat_node.child("n_pins_x").text().as_int();
+  n_pins_y_ = heat_node.child("n_pins_y").text().as_int();
+  inlet_temperature_ = heat_node.child("inlet_temperature").text().as_double();
+  if (heat_node.child("n_assem_x") || heat_node.child("n_assem_y") ||
+      heat_node.child("assembly_width_x") || heat_node.child("assembly_width_y")) {
+    n_assem_x_ = heat_node.child("n_assem_x").text().as_int();
+    n_assem_y_ = heat_node.child("n_assem_y").text().as_int();
+    assembly_width_x_ = heat_node.child("assembly_width_x").text().as_double();
+    assembly_width_y_ = heat_node.child("assembly_width_y").text().as_double();
+  } else {
+    n_assem_x_ = 1;
+    n_assem_y_ = 1;
+    assembly_width_x_ = n_pins_x_ * pin_pitch_;
+    assembly_width_y_ = n_pins_y_ * pin_pitch_;
+  }
+  z_ = openmc::get_node_xarray<double>(heat_node, "z");
+
+  // Parameters of the model
+  if (node.child("power_shape")) {
+    power_shape_ = node.child("power_shape").text().as_string();
+    if (power_shape_ != "cosine" && power_shape_ != "flat") {
+      throw std::runtime_error{"Invalid value for <power_shape>: " + power_shape_};
+    }
+  }
+  if (node.child("axial_power")) {
+    auto axial_power = openmc::get_node_array<double>(node, "axial_power");
+    if (axial_power.size() != z_.size() - 1) {
+      throw std::runtime_error{"<axial_power> must have one value per axial segment"};
+    }
+    axial_power_ = axial_power;
+  }
+  if (node.child("k_ref"))
+    k_ref_ = node.child("k_ref").text().as_double();
+  if (node.child("doppler_coefficient"))
+    doppler_coefficient_ = node.child("doppler_coefficient").text().as_double();
+  if (node.child("density_coefficient"))
+    density_coefficient_ = node.child("density_coefficient").text().as_double();
+  if (node.child("boron_coefficient"))
+    boron_coefficient_ = node.child("boron_coefficient").text().as_double();
+  if (node.child("reference_temperature"))
+    reference_temperature_ = node.child("reference_temperature").text().as_double();
+  if (node.child("reference_density"))
+    reference_density_ = node.child("reference_density").text().as_double();
+
+  Expects(clad_inner_radius_ > 0.0);
+  Expects(clad_outer_radius_ > clad_inner_radius_);
+  Expects(pin_pitch_ > 2.0 * clad_outer_radius_);
+  Expects(n_pins_x_ > 0 && n_pins_y_ > 0);
+  Expects(n_assem_x_ > 0 && n_assem_y_ > 0);
+  Expects(assembly_width_x_ >= pin_pitch_ * n_pins_x_);
+  Expects(assembly_width_y_ >= pin_pitch_ * n_pins_y_);
+  Expects(z_.size() > 1);
+  Expects(k_ref_ > 0.0);
+
+  k_eff_ = k_ref_;
+
+  timer_driver_setup.stop();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NeutronicsDriver interface
+
+xt::xtensor<double, 1> SurrogateNeutronicsDriver::heat_source(double power) const
+{
+  // The relative power densities are scaled so that they integrate to the power
+  double total = 0.0;
+  for (gsl::index i = 0; i < cells_.size(); ++i) {
+    total += power_.at(i) * cells_[i].volume;
+  }
+
+  xt::xtensor<double, 1> heat = xt::zeros<double>({cells_.size()});
+  if (total > 0.0) {
+    for (gsl::index i = 0; i < cells_.size(); ++i) {
+      heat(i) = power * power_[i] / total;
+    }
+  }
+  return heat;
+}
+
+std::vector<CellHandle> SurrogateNeutronicsDriver::find(
+  const std::vector<Position>& positions)
+{
+  // Locating a position is cheap, so the root locates all of them.  If a cell hasn't
+  // been saved yet, the root adds it to cells_, and the new handles are then sent to
+  // the other ranks, which add them in the same order.
+  std::vector<CellHandle> handles;
+  std::vector<CellHandle> new_handles;
+  if (comm_.is_root() || !comm_.active()) {
+    handles.reserve(positions.size());
+    for (const auto& r : positions) {
+      auto h = this->locate(r);
+      if (cell_index_.find(h) == cell_index_.end()) {
+        new_handles.push_back(h);
+        cell_index_.emplace(h, cells_.size());
+        cells_.push_back(this->make_cell(h));
+      }
+      handles.push_back(h);
+    }
+  }
+  comm_.broadcast(new_handles);
+  if (!comm_.is_root() && comm_.active()) {
+    for (auto h : new_handles) {
+      cell_index_.emplace(h, cells_.size());
+      cells_.push_back(this->make_cell(h));
+    }
+  }
+
+  // The new cells start at the reference state, with the coolant at the inlet
+  // temperature
+  for (auto i = temperature_.size(); i < cells_.size(); ++i) {
+    bool coolant = cells_[i].region == Region::coolant;
+    temperature_.push_back(coolant ? inlet_temperature_ : reference_temperature_);
+    density_.push_back(reference_density_);
+    power_.push_back(cells_[i].region == Region::fuel ? this->shape(cells_[i]) : 0.0);
+  }
+
+  return handles;
+}
+
+void SurrogateNeutronicsDriver::set_density(CellHandle cell, double rho) const
+{
+  density_.at(this->cell_index(cell)) = rho;
+}
+
+void SurrogateNeutronicsDriver::set_temperature(CellHandle cell, double T) const
+{
+  temperature_.at(this->cell_index(cell)) = T;
+}
+
+double SurrogateNeutronicsDriver::get_density(CellHandle cell) const
+{
+  return density_.at(this->cell_index(cell));
+}
+
+double SurrogateNeutronicsDriver::get_temperature(CellHandle cell) const
+{
+  return temperature_.at(this->cell_index(cell));
+}
+
+void SurrogateNeutronicsDriver::set_temperatures(gsl::span<const gsl::index> indices,
+                                                 gsl::span<const double> T) const
+{
+  Expects(indices.size() == T.size());
+  for (gsl::index i = 0; i < indices.size(); ++i) {
+    temperature_.at(indices[i]) = T[i];
+  }
+}
+
+void SurrogateNeutronicsDriver::set_densities(gsl::span<const gsl::index> indices,
+                                              gsl::span<const double> rho) const
+{
+  Expects(indices.size() == rho.size());
+  for (gsl::index i = 0; i < indices.size(); ++i) {
+    density_.at(indices[i]) = rho[i];
+  }
+}
+
+void SurrogateNeutronicsDriver::get_temperatures(gsl::span<const gsl::index> indices,
+                                                 gsl::span<double> T) const
+{
+  Expects(indices.size() == T.size());
+  for (gsl::index i = 0; i < indices.size(); ++i) {
+    T[i] = temperature_.at(indices[i]);
+  }
+}
+
+void SurrogateNeutronicsDriver::get_densities(gsl::span<const gsl::index> indices,
+                                              gsl::span<double> rho) const
+{
+  Expects(indices.size() == rho.size());
+  for (gsl::index i = 0; i < indices.size(); ++i) {
+    rho[i] = density_.at(indices[i]);
+  }
+}
+
+double SurrogateNeutronicsDriver::get_volume(CellHandle cell) const
+{
+  return cells_.at(this->cell_index(cell)).volume;
+}
+
+bool SurrogateNeutronicsDriver::is_fissionable(CellHandle cell) const
+{
+  return cells_.at(this->cell_index(cell)).region == Region::fuel;
+}
+
+std::string SurrogateNeutronicsDriver::cell_label(CellHandle cell) const
+{
+  // Decompose the handle as in locate()
+  auto n_axial = z_.size() - 1;
+  auto region = cell % 3;
+  auto axial = (cell / 3) % n_axial;
+  auto pin = (cell / 3 / n_axial) % (n_pins_x_ * n_pins_y_);
+  auto assembly = cell / 3 / n_axial / (n_pins_x_ * n_pins_y_);
+
+  const char* names[] = {"fuel", "clad", "coolant"};
+  std::stringstream label;
+  label << names[region] << " (assembly " << assembly << ", pin " << pin << ", axial "
+        << axial << ")";
+  return label.str();
+}
+
+gsl::index SurrogateNeutronicsDriver::cell_index(CellHandle cell) const
+{
+  return cell_index_.at(cell);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Driver interface
+
+void SurrogateNeutronicsDriver::solve_step()
+{
+  timer_solve_step.start();
+
+  // Average fuel temperature and coolant density, weighted by volume
+  double T_sum = 0.0;
+  double V_fuel = 0.0;
+  double rho_sum = 0.0;
+  double V_coolant = 0.0;
+  for (gsl::index i = 0; i < cells_.size(); ++i) {
+    const auto& c = cells_[i];
+    if (c.region == Region::fuel) {
+      T_sum += temperature_[i] * c.volume;
+      V_fuel += c.volume;
+    } else if (c.region == Region::coolant) {
+      rho_sum += density_[i] * c.volume;
+      V_coolant += c.volume;
+    }
+  }
+  double T_fuel = V_fuel > 0.0 ? T_sum / V_fuel : reference_temperature_;
+  double rho_coolant = V_coolant > 0.0 ? rho_sum / V_coolant : reference_density_;
+
+  k_eff_ = k_ref_ + doppler_coefficient_ * (T_fuel - reference_temperature_) +
+           density_coefficient_ * (rho_coolant - reference_density_) +
+           boron_coefficient_ * ppm_;
+
+  // The power of each fuel cell follows the shape, tilted by the Doppler feedback on
+  // its own temperature
+  for (gsl::index i = 0; i < cells_.size(); ++i) {
+    const auto& c = cells_[i];
+    if (c.region == Region::fuel) {
+      double feedback =
+        1.0 + doppler_coefficient_ / k_ref_ * (temperature_[i] - reference_temperature_);
+      power_[i] = this->shape(c) * std::max(feedback, 0.0);
+    }
+  }
+
+  comm_.message("k-effective = " + std::to_string(k_eff_));
+
+  timer_solve_step.stop();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Private member functions
+
+CellHandle SurrogateNeutronicsDriver::locate(const Position& r) const
+{
+  // The core is centered on the origin; assemblies and the pins within them are
+  // numbered in rows from the top left corner, as in SurrogateHeatDriver
+  double core_left = -0.5 * n_assem_x_ * assembly_width_x_;
+  double core_top = 0.5 * n_assem_y_ * assembly_width_y_;
+  double u = (r.x - core_left) / assembly_width_x_;
+  double v = (core_top - r.y) / assembly_width_y_;
+  auto n_axial = z_.size() - 1;
+  if (u < 0.0 || u >= n_assem_x_ || v < 0.0 || v >= n_assem_y_ || r.z < z_(0) ||
+      r.z > z_(n_axial)) {
+    std::stringstream msg;
+    msg << "Position (" << r.x << ", " << r.y << ", " << r.z
+        << ") is outside of the surrogate neutronics lattice";
+    throw std::runtime_error{msg.str()};
+  }
+  auto acol = static_cast<std::size_t>(u);
+  auto arow = static_cast<std::size_t>(v);
+
+  // Pins start at the top left corner of their assembly; a position in the gap
+  // around the pins belongs to the nearest pin
+  double x = r.x - (core_left + acol * assembly_width_x_);
+  double y = (core_top - arow * assembly_width_y_) - r.y;
+  auto col = static_cast<std::size_t>(
+    std::min(std::max(x / pin_pitch_, 0.0), n_pins_x_ - 1.0));
+  auto row = static_cast<std::size_t>(
+    std::min(std::max(y / pin_pitch_, 0.0), n_pins_y_ - 1.0));
+
+  std::size_t axial = 0;
+  while (axial < n_axial - 1 && r.z >= z_(axial + 1)) {
+    ++axial;
+  }
+
+  // Region from the distance to the pin center
+  double dx = x - (col + 0.5) * pin_pitch_;
+  double dy = y - (row + 0.5) * pin_pitch_;
+  double d = std::sqrt(dx * dx + dy * dy);
+  Region region = d < clad_inner_radius_
+                    ? Region::fuel
+                    : (d < clad_outer_radius_ ? Region::clad : Region::coolant);
+
+  auto assembly = arow * n_assem_x_ + acol;
+  auto pin = row * n_pins_x_ + col;
+  return ((assembly * n_pins_x_ * n_pins_y_ + pin) * n_axial + axial) * 3 +
+         static_cast<std::size_t>(region);
+}
+
+SurrogateNeutronicsDriver::Cell SurrogateNeutronicsDriver::make_cell(
+  CellHandle handle) const
+{
+  auto n_axial = z_.size() - 1;
+  auto n_pins = n_pins_x_ * n_pins_y_;
+  auto region = static_cast<Region>(handle % 3);
+  auto axial = (handle / 3) % n_axial;
+  auto pin = (handle / 3 / n_axial) % n_pins;
+  auto assembly = handle / 3 / n_axial / n_pins;
+
+  double core_left = -0.5 * n_assem_x_ * assembly_width_x_;
+  double core_top = 0.5 * n_assem_y_ * assembly_width_y_;
+  Position center{
+    core_left + (assembly % n_assem_x_) * assembly_width_x_ +
+      (pin % n_pins_x_ + 0.5) * pin_pitch_,
+    core_top - (assembly / n_assem_x_) * assembly_width_y_ -
+      (pin / n_pins_x_ + 0.5) * pin_pitch_,
+    0.5 * (z_(axial) + z_(axial + 1))};
+
+  double dz = z_(axial + 1) - z_(axial);
+  double ri2 = clad_inner_radius_ * clad_inner_radius_;
+  double ro2 = clad_outer_radius_ * clad_outer_radius_;
+  double area;
+  switch (region) {
+  case Region::fuel:
+    area = M_PI * ri2;
+    break;
+  case Region::clad:
+    area = M_PI * (ro2 - ri2);
+    break;
+  default:
+    area = pin_pitch_ * pin_pitch_ - M_PI * ro2;
+  }
+
+  return {handle, region, center, area * dz};
+}
+
+double SurrogateNeutronicsDriver::shape(const Cell& cell) const
+{
+  // The cosine shape vanishes one pin pitch outside of the core along each direction,
+  // and the tabulated axial shape replaces it along z
+  auto n_axial = z_.size() - 1;
+  double s = 1.0;
+  if (power_shape_ == "cosine") {
+    double width_x = n_assem_x_ * assembly_width_x_ + 2.0 * pin_pitch_;
+    double width_y = n_assem_y_ * assembly_width_y_ + 2.0 * pin_pitch_;
+    s = std::cos(M_PI * cell.center.x / width_x) *
+        std::cos(M_PI * cell.center.y / width_y);
+  }
+  if (!axial_power_.empty()) {
+    gsl::index axial = (cell.handle / 3) % n_axial;
+    s *= axial_power_[axial];
+  } else if (power_shape_ == "cosine") {
+    double height = z_(n_axial) - z_(0) + 2.0 * pin_pitch_;
+    double z_mid = 0.5 * (z_(0) + z_(n_axial));
+    s *= std::cos(M_PI * (cell.center.z - z_mid) / height);
+  }
+  return s;
+}
+
+} // namespace enrico
@@ -6,6 +6,8 @@
 
 namespace enrico {
 
+bool Timer::record_samples_ = false;
+
 void Timer::start()
 {
   if (comm_.active()) {
@@ -18,7 +20,16 @@ void Timer::start()
 void Timer::stop()
 {
   if (comm_.active()) {
-    elapsed_ = elapsed();
+    if (running_) {
+      double busy = MPI_Wtime();
+      comm_.Barrier();
+      double stop = MPI_Wtime();
+      elapsed_ += stop - start_;
+      busy_ += busy - start_;
+      if (record_samples_) {
+        samples_.push_back({start_, busy, stop});
+      }
+    }
     running_ = false;
   }
 }
@@ -28,6 +39,8 @@ void Timer::reset()
   if (comm_.active()) {
     running_ = false;
     elapsed_ = 0.0;
+    busy_ = 0.0;
+    samples_.clear();
   }
 }
 
@@ -1,4 +1,5 @@
 #include <cmath>
+#include <cstring> // for memcpy
 
 #include "enrico/vtk_viz.h"
 
@@ -24,6 +25,28 @@ using std::ofstream;
 using xt::xtensor;
 using xt::placeholders::_;
 
+namespace {
+
+//! Byte order of this machine, as named in XML VTK files
+const char* byte_order()
+{
+  const std::uint16_t one = 1;
+  unsigned char first;
+  std::memcpy(&first, &one, 1);
+  return first == 1 ? "LittleEndian" : "BigEndian";
+}
+
+//! Write one array of appended data, preceded by its size in bytes
+template<typename T>
+void write_appended(ofstream& fh, const std::vector<T>& values)
+{
+  std::uint64_t n_bytes = values.size() * sizeof(T);
+  fh.write(reinterpret_cast<const char*>(&n_bytes), sizeof(n_bytes));
+  fh.write(reinterpret_cast<const char*>(values.data()), n_bytes);
+}
+
+} // namespace
+
 xtensor<double, 2> create_ring(double radius, size_t t_resolution)
 {
   xtensor<double, 1> x({t_resolution}, 0.0);
@@ -140,6 +163,18 @@ SurrogateVtkWriter::SurrogateVtkWriter(const SurrogateHeatDriverAssembly& surrog
   points_ = points();
   conn_ = conn();
   types_ = types();
+
+  // the geometry of the assembly never changes, so it is generated once for all
+  // writes
+  assembly_points_.reserve(3 * surrogate_.n_pins_ * n_points_);
+  cell_types_.reserve(surrogate_.n_pins_ * n_sections_);
+  for (size_t pin = 0; pin < surrogate_.n_pins_; pin++) {
+    xtensor<double, 1> pin_pnts =
+      points_for_pin(surrogate_.pin_centers_(pin, 0), surrogate_.pin_centers_(pin, 1));
+    assembly_points_.insert(assembly_points_.end(), pin_pnts.cbegin(), pin_pnts.cend());
+    cell_types_.insert(cell_types_.end(), types_.cbegin(), types_.cend());
+  }
+  element_connectivity(connectivity_, offsets_);
 }
 
 void SurrogateVtkWriter::set_number_of_sections()
@@ -202,6 +237,11 @@ void SurrogateVtkWriter::set_number_of_entries()
 }
 
 void SurrogateVtkWriter::write(std::string filename)
+{
+  write(filename, cell_fields());
+}
+
+void SurrogateVtkWriter::write(const std::string& filename, const Fields& fields) const
 {
   // open file
   ofstream fh(filename, std::ofstream::out);
@@ -219,199 +259,258 @@ void SurrogateVtkWriter::write(std::string filename)
   write_element_types(fh);
 
   // write specified data to the vtk file
-  write_data(fh);
+  write_data(fh, fields);
 
   // close the file
   fh.close();
 
 } // write_vtk
 
-void SurrogateVtkWriter::write_header(ofstream& vtk_file)
+void SurrogateVtkWriter::write_vtu(const std::string& filename)
+{
+  write_vtu(filename, cell_fields());
+}
+
+void SurrogateVtkWriter::write_vtu(const std::string& filename,
+                                   const Fields& fields) const
+{
+  ofstream fh(filename, std::ofstream::out | std::ofstream::binary);
+  fh << "<?xml version=\"1.0\"?>\n"
+     << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\""
+     << byte_order() << "\" header_type=\"UInt64\">\n"
+     << "  <UnstructuredGrid>\n"
+     << "    <Piece NumberOfPoints=\"" << surrogate_.n_pins_ * n_points_
+     << "\" NumberOfCells=\"" << surrogate_.n_pins_ * n_sections_ << "\">\n";
+
+  // each array in the appended data is preceded by its size as a UInt64
+  std::uint64_t offset = 0;
+  auto data_array = [&fh, &offset](const std::string& attributes, std::size_t n_bytes) {
+    fh << "        <DataArray " << attributes << " format=\"appended\" offset=\""
+       << offset << "\"/>\n";
+    offset += sizeof(std::uint64_t) + n_bytes;
+  };
+
+  fh << "      <Points>\n";
+  data_array("type=\"Float64\" NumberOfComponents=\"3\"",
+             assembly_points_.size() * sizeof(double));
+  fh << "      </Points>\n"
+     << "      <Cells>\n";
+  data_array("type=\"Int32\" Name=\"connectivity\"",
+             connectivity_.size() * sizeof(std::int32_t));
+  data_array("type=\"Int32\" Name=\"offsets\"", offsets_.size() * sizeof(std::int32_t));
+  data_array("type=\"UInt8\" Name=\"types\"", cell_types_.size());
+  fh << "      </Cells>\n"
+     << "      <CellData>\n";
+  for (const auto& field : fields) {
+    data_array("type=\"Float64\" Name=\"" + field.first + "\"",
+               field.second.size() * sizeof(double));
+  }
+  fh << "      </CellData>\n"
+     << "    </Piece>\n"
+     << "  </UnstructuredGrid>\n"
+     << "  <AppendedData encoding=\"raw\">\n"
+     << "_";
+
+  write_appended(fh, assembly_points_);
+  write_appended(fh, connectivity_);
+  write_appended(fh, offsets_);
+  write_appended(fh, cell_types_);
+  for (const auto& field : fields) {
+    write_appended(fh, field.second);
+  }
+
+  fh << "\n  </AppendedData>\n"
+     << "</VTKFile>\n";
+  fh.close();
+}
+
+void SurrogateVtkWriter::write_pvtu(const std::string& filename,
+                                    const std::vector<std::string>& pieces) const
+{
+  ofstream fh(filename, std::ofstream::out);
+  fh << "<?xml version=\"1.0\"?>\n"
+     << "<VTKFile type=\"PUnstructuredGrid\" version=\"1.0\" byte_order=\""
+     << byte_order() << "\" header_type=\"UInt64\">\n"
+     << "  <PUnstructuredGrid GhostLevel=\"0\">\n"
+     << "    <PPoints>\n"
+     << "      <PDataArray type=\"Float64\" NumberOfComponents=\"3\"/>\n"
+     << "    </PPoints>\n"
+     << "    <PCells>\n"
+     << "      <PDataArray type=\"Int32\" Name=\"connectivity\"/>\n"
+     << "      <PDataArray type=\"Int32\" Name=\"offsets\"/>\n"
+     << "      <PDataArray type=\"UInt8\" Name=\"types\"/>\n"
+     << "    </PCells>\n"
+     << "    <PCellData>\n";
+  if (output_includes_temp_) {
+    fh << "      <PDataArray type=\"Float64\" Name=\"TEMPERATURE\"/>\n";
+  }
+  if (output_includes_density_) {
+    fh << "      <PDataArray type=\"Float64\" Name=\"DENSITY\"/>\n";
+  }
+  if (output_includes_source_) {
+    fh << "      <PDataArray type=\"Float64\" Name=\"SOURCE\"/>\n";
+  }
+  fh << "    </PCellData>\n";
+  for (const auto& piece : pieces) {
+    fh << "    <Piece Source=\"" << piece << "\"/>\n";
+  }
+  fh << "  </PUnstructuredGrid>\n"
+     << "</VTKFile>\n";
+  fh.close();
+}
+
+void SurrogateVtkWriter::write_header(ofstream& vtk_file) const
 {
   vtk_file << "# vtk DataFile Version 2.0\n";
   vtk_file << "No comment\nASCII\nDATASET UNSTRUCTURED_GRID\n";
 }
 
-void SurrogateVtkWriter::write_points(ofstream& vtk_file)
+void SurrogateVtkWriter::write_points(ofstream& vtk_file) const
 {
   vtk_file << "POINTS " << surrogate_.n_pins_ * n_points_ << " float\n";
 
-  for (size_t pin = 0; pin < surrogate_.n_pins_; pin++) {
-    // translate pin template to pin center
-    xtensor<double, 1> pnts =
-      points_for_pin(surrogate_.pin_centers_(pin, 0), surrogate_.pin_centers_(pin, 1));
-
-    for (auto val = pnts.cbegin(); val != pnts.cend(); val += 3) {
-      vtk_file << *val << " " << *(val + 1) << " " << *(val + 2) << "\n";
-    }
+  for (auto val = assembly_points_.cbegin(); val != assembly_points_.cend(); val += 3) {
+    vtk_file << *val << " " << *(val + 1) << " " << *(val + 2) << "\n";
   }
 }
 
-void SurrogateVtkWriter::write_element_connectivity(ofstream& vtk_file)
+void SurrogateVtkWriter::write_element_connectivity(ofstream& vtk_file) const
 {
   // write number of connectivity entries
   vtk_file << "\nCELLS " << surrogate_.n_pins_ * n_sections_ << " "
            << surrogate_.n_pins_ * n_entries_ << "\n";
 
-  for (size_t pin = 0; pin < surrogate_.n_pins_; pin++) {
-    // get the connectivity for a given pin, using an
-    // offset to get the connectivity values correct
-    xtensor<int, 1> conn = conn_for_pin(pin * n_points_);
-    // write the connectivity values to file for this pin
-    for (auto val = conn.cbegin(); val != conn.cend(); val += CONN_STRIDE_) {
-      for (size_t i = 0; i < CONN_STRIDE_; i++) {
-        auto v = *(val + i);
-        // mask out any negative connectivity values
-        if (v != INVALID_CONN_) {
-          vtk_file << v << " ";
-        }
-      }
-      vtk_file << "\n";
+  // each element is written as its number of points followed by the points
+  std::int32_t first = 0;
+  for (auto last : offsets_) {
+    vtk_file << last - first << " ";
+    for (auto i = first; i < last; i++) {
+      vtk_file << connectivity_[i] << " ";
     }
+    vtk_file << "\n";
+    first = last;
   }
 } // write_element_connectivity
 
-void SurrogateVtkWriter::write_element_types(ofstream& vtk_file)
+void SurrogateVtkWriter::write_element_types(ofstream& vtk_file) const
 {
   // write number of cell type entries
   vtk_file << "\nCELL_TYPES " << surrogate_.n_pins_ * n_sections_ << "\n";
-  // pin loop
-  for (size_t pin = 0; pin < surrogate_.n_pins_; pin++) {
-    // write the template for each pin
-    for (auto v : types_) {
-      vtk_file << v << "\n";
-    }
+  for (auto v : cell_types_) {
+    vtk_file << int(v) << "\n";
   }
   vtk_file << "\n";
 } // write_element_types
 
-void SurrogateVtkWriter::write_data(ofstream& vtk_file)
+void SurrogateVtkWriter::write_data(ofstream& vtk_file, const Fields& fields) const
 {
-  // fuel mesh elements are written first, followed by cladding elements
-  // the data needs to be written in a similar matter
-
-  // for each radial section, the data point for that radial ring
-  // is repeated azimuthal_res times
   vtk_file << "CELL_DATA " << surrogate_.n_pins_ * n_sections_ << "\n";
 
-  // write temperatures
-  if (output_includes_temp_) {
-    vtk_file << "SCALARS TEMPERATURE double 1\n";
+  for (const auto& field : fields) {
+    vtk_file << "SCALARS " << field.first << " double 1\n";
     vtk_file << "LOOKUP_TABLE default\n";
-
-    // write data for each pin
-    for (size_t pin = 0; pin < surrogate_.n_pins_; pin++) {
-      if (output_includes_solid_) {
-        // write all fuel data first
-        for (size_t i = 0; i < n_axial_sections_; i++) {
-          for (size_t j = 0; j < n_radial_fuel_sections_; j++) {
-            for (size_t k = 0; k < azimuthal_res_; k++) {
-              vtk_file << surrogate_.solid_temperature(pin, i, j) << "\n";
-            }
-          }
-        }
-
-        // then write cladding data
-        for (size_t i = 0; i < n_axial_sections_; i++) {
-          for (size_t j = 0; j < n_radial_clad_sections_; j++) {
-            for (size_t k = 0; k < azimuthal_res_; k++) {
-              vtk_file << surrogate_.solid_temperature(
-                            pin, i, j + n_radial_fuel_sections_)
-                       << "\n";
-            }
-          }
-        }
-      } // end of solid writing
-
-      // then write fluid data
-      if (output_includes_fluid_) {
-        for (size_t i = 0; i < n_axial_sections_; ++i) {
-          for (size_t j = 0; j < n_fluid_sections_; ++j) {
-            vtk_file << surrogate_.fluid_temperature(pin, i) << "\n";
-          }
-        }
-      }
-    } // end pin loop
+    for (auto v : field.second) {
+      vtk_file << v << "\n";
+    }
   }
+} // write_data
 
+SurrogateVtkWriter::Fields SurrogateVtkWriter::cell_fields() const
+{
+  Fields fields;
+  if (output_includes_temp_) {
+    fields.emplace_back("TEMPERATURE", cell_field(VizDataType::temp));
+  }
   if (output_includes_density_) {
-    vtk_file << "SCALARS DENSITY double 1\n";
-    vtk_file << "LOOKUP_TABLE default\n";
-
-    // write data for each pin
-    for (size_t pin = 0; pin < surrogate_.n_pins_; pin++) {
-      if (output_includes_solid_) {
-        // write all fuel data first
-        for (size_t i = 0; i < n_axial_sections_; i++) {
-          for (size_t j = 0; j < n_radial_fuel_sections_; j++) {
-            for (size_t k = 0; k < azimuthal_res_; k++) {
-              vtk_file << 0.0 << "\n";
-            }
-          }
-        }
-
-        // then write cladding data
-        for (size_t i = 0; i < n_axial_sections_; i++) {
-          for (size_t j = 0; j < n_radial_clad_sections_; j++) {
-            for (size_t k = 0; k < azimuthal_res_; k++) {
-              vtk_file << 0.0 << "\n";
-            }
-          }
-        }
-      } // end of solid writing
-
-      // then write fluid data
-      if (output_includes_fluid_) {
-        for (size_t i = 0; i < n_axial_sections_; ++i) {
-          for (size_t j = 0; j < n_fluid_sections_; ++j) {
-            vtk_file << surrogate_.fluid_density(pin, i) << "\n";
-          }
-        }
-      }
-    } // end pin loop
+    fields.emplace_back("DENSITY", cell_field(VizDataType::density));
   }
-
   if (output_includes_source_) {
-    vtk_file << "SCALARS SOURCE double 1\n";
-    vtk_file << "LOOKUP_TABLE default\n";
-
-    // Average over the azimuthal sectors for each radial ring.
-    // This is consistent with how the source term is used by the surrogate solver.
-    xt::xtensor<double, 3> q = xt::mean(surrogate_.source_, 3);
+    fields.emplace_back("SOURCE", cell_field(VizDataType::source));
+  }
+  return fields;
+}
 
-    for (size_t pin = 0; pin < surrogate_.n_pins_; pin++) {
+std::vector<double> SurrogateVtkWriter::cell_field(VizDataType field) const
+{
+  // Average over the azimuthal sectors for each radial ring.
+  // This is consistent with how the source term is used by the surrogate solver.
+  xt::xtensor<double, 3> q;
+  if (field == VizDataType::source) {
+    q = xt::mean(surrogate_.source_, 3);
+  }
+
+  // value of the field in a solid ring and in the fluid around a pin; the solid has
+  // no density and the fluid no source
+  auto solid_value = [&](size_t pin, size_t axial, size_t ring) -> double {
+    if (field == VizDataType::temp)
+      return surrogate_.solid_temperature(pin, axial, ring);
+    if (field == VizDataType::source)
+      return q(pin, axial, ring);
+    return 0.0;
+  };
+  auto fluid_value = [&](size_t pin, size_t axial) -> double {
+    if (field == VizDataType::temp)
+      return surrogate_.fluid_temperature(pin, axial);
+    if (field == VizDataType::density)
+      return surrogate_.fluid_density(pin, axial);
+    return 0.0;
+  };
+
+  // fuel mesh elements are written first, followed by cladding elements; for each
+  // radial section, the data point for that radial ring is repeated azimuthal_res
+  // times
+  std::vector<double> values;
+  values.reserve(surrogate_.n_pins_ * n_sections_);
+  for (size_t pin = 0; pin < surrogate_.n_pins_; pin++) {
+    if (output_includes_solid_) {
       // write all fuel data first
-      if (output_includes_solid_) {
-        for (size_t i = 0; i < n_axial_sections_; i++) {
-          for (size_t j = 0; j < n_radial_fuel_sections_; j++) {
-            for (size_t k = 0; k < azimuthal_res_; k++) {
-              vtk_file << q(pin, i, j) << "\n";
-            }
-          }
+      for (size_t i = 0; i < n_axial_sections_; i++) {
+        for (size_t j = 0; j < n_radial_fuel_sections_; j++) {
+          values.insert(values.end(), azimuthal_res_, solid_value(pin, i, j));
         }
+      }
 
-        // then write the cladding data
-        for (size_t i = 0; i < n_axial_sections_; i++) {
-          for (size_t j = 0; j < n_radial_clad_sections_; j++) {
-            for (size_t k = 0; k < azimuthal_res_; k++) {
-              vtk_file << q(pin, i, j + n_radial_fuel_sections_) << "\n";
-            }
-          }
+      // then write cladding data
+      for (size_t i = 0; i < n_axial_sections_; i++) {
+        for (size_t j = 0; j < n_radial_clad_sections_; j++) {
+          double v = solid_value(pin, i, j + n_radial_fuel_sections_);
+          values.insert(values.end(), azimuthal_res_, v);
         }
       }
+    }
 
-      // then write fluid data
-      if (output_includes_fluid_) {
-        for (size_t i = 0; i < n_axial_sections_; ++i) {
-          for (size_t j = 0; j < n_fluid_sections_; ++j) {
-            vtk_file << 0.0 << "\n";
-          }
-        }
+    // then write fluid data
+    if (output_includes_fluid_) {
+      for (size_t i = 0; i < n_axial_sections_; ++i) {
+        values.insert(values.end(), n_fluid_sections_, fluid_value(pin, i));
       }
-    } // end pin loop
+    }
   }
+  return values;
+}
 
-} // write_data
+void SurrogateVtkWriter::element_connectivity(std::vector<std::int32_t>& connectivity,
+                                              std::vector<std::int32_t>& offsets)
+{
+  connectivity.clear();
+  offsets.clear();
+  connectivity.reserve(surrogate_.n_pins_ * (n_entries_ - n_sections_));
+  offsets.reserve(surrogate_.n_pins_ * n_sections_);
+
+  for (size_t pin = 0; pin < surrogate_.n_pins_; pin++) {
+    xtensor<int, 1> conn = conn_for_pin(pin * n_points_);
+    for (auto val = conn.cbegin(); val != conn.cend(); val += CONN_STRIDE_) {
+      // the first entry is the number of points, and the unused ones are negative
+      for (size_t i = 1; i < CONN_STRIDE_; i++) {
+        auto v = *(val + i);
+        if (v != INVALID_CONN_) {
+          connectivity.push_back(v);
+        }
+      }
+      offsets.push_back(connectivity.size());
+    }
+  }
+}
 
 xtensor<double, 1> SurrogateVtkWriter::points_for_pin(double x, double y)
 {
@@ -0,0 +1,435 @@
+//===========================================================================
+// Benchmark of the coupling transfers of CoupledDriver between synthetic
+// neutronics and heat-fluids drivers, without OpenMC, Nek or any input files.
+//
+// The synthetic drivers are given to CoupledDriver in place of the ones named
+// in the input, so the transfers timed are the ones of a coupled run: the
+// setup, which finds the element-to-cell mapping (init_mapping), the scatter of
+// the heat source from the neutronics root to the heat ranks
+// (update_heat_source) and the gather of the cell-averaged temperature and
+// density back (update_thermal_state).
+//
+// Usage:
+//   mpirun -np <n> ./coupling_benchmark [options]
+//
+// Options:
+//   --cells <n>[,<n>...]             Numbers of neutronics cells to run
+//                                    (default 10000)
+//   --elems-per-cell <n>             Heat-fluids elements in each cell (default 8)
+//   --neutronics-nodes <n>           <nodes> of the neutronics driver (default 0)
+//   --neutronics-procs-per-node <n>  <procs_per_node> of the neutronics driver
+//                                    (default 1)
+//   --heat-nodes <n>                 <nodes> of the heat-fluids driver (default 0)
+//   --heat-procs-per-node <n>        <procs_per_node> of the heat-fluids driver
+//                                    (default 0)
+//   --iterations <n>                 Timed repetitions of each update (default 20)
+//
+//   As in the input of a coupled run, a value of 0 gives a driver all nodes or
+//   all procs per node.
+//
+// Output:
+//   Once all runs are done, for each number of cells and each part, the time of
+//   the slowest rank (min, mean and max over the repetitions) and the messages and
+//   bytes of the rank that moves the most data at the part's call site.
+//===========================================================================
+
+#include "enrico/comm.h"
+#include "enrico/comm_stats.h"
+#include "enrico/coupled_driver.h"
+#include "enrico/heat_fluids_driver.h"
+#include "enrico/neutronics_driver.h"
+
+#include <gsl/gsl-lite.hpp>
+#include <mpi.h>
+#include <pugixml.hpp>
+#include <xtensor/xbuilder.hpp>
+#include <xtensor/xtensor.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace enrico;
+
+namespace {
+
+//! Cells are laid out on a square grid in the xy plane, one unit apart
+int grid_width(std::size_t n_cells)
+{
+  return static_cast<int>(std::ceil(std::sqrt(static_cast<double>(n_cells))));
+}
+
+//! Neutronics driver with one cell per grid point and a cosine power shape
+class MockNeutronicsDriver : public NeutronicsDriver {
+public:
+  MockNeutronicsDriver(MPI_Comm comm, std::size_t n_cells)
+    : NeutronicsDriver(comm)
+    , n_cells_(n_cells)
+    , width_(grid_width(n_cells))
+    , temperature_(n_cells, 293.6)
+    , density_(n_cells, 1.0)
+  {}
+
+  xt::xtensor<double, 1> heat_source(double power) const override
+  {
+    xt::xtensor<double, 1> q = xt::empty<double>({n_cells_});
+    double sum = 0.0;
+    for (gsl::index i = 0; i < n_cells_; ++i) {
+      q(i) = 1.0 + std::cos(3.0 * i / n_cells_);
+      sum += q(i);
+    }
+    for (auto& v : q) {
+      v *= power / sum;
+    }
+    return q;
+  }
+
+  UncertainDouble get_k_effective() const override { return {1.0, 0.0}; }
+
+  double get_boron_ppm(const std::vector<CellHandle>&) const override { return 0.0; }
+
+  void set_boron_ppm(const std::vector<CellHandle>&, double, double) const override {}
+
+  //! The positions on the root are split among the ranks, each rank finds the
+  //! cells of its share, and the cells are gathered on the root, as with OpenMC
+  std::vector<CellHandle> find(const std::vector<Position>& positions) override
+  {
+    auto n = positions.size();
+    comm_.broadcast(n);
+    auto counts = partition_counts(n, comm_.size);
+    std::vector<Position> local_positions(counts[comm_.rank]);
+    comm_.scatterv(positions, local_positions, counts);
+
+    std::vector<CellHandle> local_cells(local_positions.size());
+    for (gsl::index k = 0; k < local_positions.size(); ++k) {
+      auto ix = static_cast<CellHandle>(std::floor(local_positions[k].x));
+      auto iy = static_cast<CellHandle>(std::floor(local_positions[k].y));
+      local_cells[k] = ix + width_ * iy;
+    }
+    std::vector<CellHandle> cells;
+    comm_.gatherv(local_cells, cells, counts);
+    return cells;
+  }
+
+  void set_density(CellHandle cell, double rho) const override {}
+
+  void set_temperature(CellHandle cell, double T) const override {}
+
+  double get_density(CellHandle cell) const override { return density_[cell]; }
+
+  double get_temperature(CellHandle cell) const override { return temperature_[cell]; }
+
+  void set_temperatures(gsl::span<const gsl::index> indices,
+                        gsl::span<const double> T) const override
+  {
+    for (gsl::index k = 0; k < indices.size(); ++k) {
+      temperature_[indices[k]] = T[k];
+    }
+  }
+
+  void set_densities(gsl::span<const gsl::index> indices,
+                     gsl::span<const double> rho) const override
+  {
+    for (gsl::index k = 0; k < indices.size(); ++k) {
+      density_[indices[k]] = rho[k];
+    }
+  }
+
+  void get_temperatures(gsl::span<const gsl::index> indices,
+                        gsl::span<double> T) const override
+  {
+    for (gsl::index k = 0; k < indices.size(); ++k) {
+      T[k] = temperature_[indices[k]];
+    }
+  }
+
+  void get_densities(gsl::span<const gsl::index> indices,
+                     gsl::span<double> rho) const override
+  {
+    for (gsl::index k = 0; k < indices.size(); ++k) {
+      rho[k] = density_[indices[k]];
+    }
+  }
+
+  double get_volume(CellHandle cell) const override { return 1.0; }
+
+  bool is_fissionable(CellHandle cell) const override { return true; }
+
+  std::size_t n_cells() const override { return n_cells_; }
+
+  void create_tallies() override {}
+
+  std::string cell_label(CellHandle cell) const override { return std::to_string(cell); }
+
+  gsl::index cell_index(CellHandle cell) const override { return cell; }
+
+private:
+  std::size_t n_cells_; //!< Number of cells
+  int width_;           //!< Number of cells along x of the grid
+  mutable std::vector<double> temperature_; //!< Temperature of each cell in [K]
+  mutable std::vector<double> density_;     //!< Density of each cell in [g/cm^3]
+};
+
+//! Heat-fluids driver whose elements are split evenly among its ranks, with a fixed
+//! number of elements inside each cell of the neutronics grid
+class MockHeatFluidsDriver : public HeatFluidsDriver {
+public:
+  MockHeatFluidsDriver(MPI_Comm comm,
+                       pugi::xml_node node,
+                       std::size_t n_cells,
+                       int elems_per_cell)
+    : HeatFluidsDriver(comm, node)
+    , n_global_(n_cells * elems_per_cell)
+    , elems_per_cell_(elems_per_cell)
+    , width_(grid_width(n_cells))
+  {
+    if (comm_.active()) {
+      auto counts = partition_counts(n_global_, comm_.size);
+      first_ = displacements(counts)[comm_.rank];
+      heat_.resize(counts[comm_.rank]);
+    }
+  }
+
+  bool has_coupling_data() const override { return true; }
+
+  int set_heat_source_at(int32_t local_elem, double heat) override
+  {
+    heat_[local_elem] = heat;
+    return 0;
+  }
+
+  void set_heat_sources(gsl::span<const double> heat) override
+  {
+    std::copy(heat.begin(), heat.end(), heat_.begin());
+  }
+
+  int in_fluid_at(int32_t local_elem) const override
+  {
+    return this->cell(local_elem) % 4 == 0;
+  }
+
+  int n_local_elem() const override { return heat_.size(); }
+
+  std::size_t n_global_elem() const override { return n_global_; }
+
+  void temperature(gsl::span<double> T) const override
+  {
+    for (gsl::index e = 0; e < T.size(); ++e) {
+      T[e] = 565.0 + 1.0e-6 * heat_[e];
+    }
+  }
+
+  void density(gsl::span<double> rho) const override
+  {
+    for (gsl::index e = 0; e < rho.size(); ++e) {
+      rho[e] = 0.7 - 1.0e-9 * heat_[e];
+    }
+  }
+
+  void fluid_mask(gsl::span<int> mask) const override
+  {
+    for (gsl::index e = 0; e < mask.size(); ++e) {
+      mask[e] = this->in_fluid_at(e);
+    }
+  }
+
+  //! The elements of a cell are spread along its diagonal
+  void centroid(gsl::span<Position> centroids) const override
+  {
+    for (gsl::index e = 0; e < centroids.size(); ++e) {
+      auto c = this->cell(e);
+      double offset = (((first_ + e) % elems_per_cell_) + 0.5) / elems_per_cell_;
+      centroids[e] = {c % width_ + offset, c / width_ + offset, 0.0};
+    }
+  }
+
+  void volume(gsl::span<double> volumes) const override
+  {
+    std::fill(volumes.begin(), volumes.end(), 1.0 / elems_per_cell_);
+  }
+
+private:
+  //! Cell of the neutronics grid that contains a local element
+  std::size_t cell(gsl::index local_elem) const
+  {
+    return (first_ + local_elem) / elems_per_cell_;
+  }
+
+  std::size_t n_global_;     //!< Number of elements on all ranks
+  int elems_per_cell_;       //!< Number of elements in each cell
+  int width_;                //!< Number of cells along x of the grid
+  std::size_t first_ = 0;    //!< Global index of the first local element
+  std::vector<double> heat_; //!< Heat source of each local element
+};
+
+//! Time a part of the coupling, repeated a number of times, and add its report to
+//! rows.  The communication is the one CoupledDriver counts at the call site.
+void benchmark(const Comm& comm,
+               const char* name,
+               const char* site,
+               int iterations,
+               std::size_t n_cells,
+               const std::function<void()>& update,
+               std::vector<std::string>& rows)
+{
+  CommStats::reset();
+  std::vector<double> times;
+  for (int i = 0; i < iterations; ++i) {
+    comm.Barrier();
+    double start = MPI_Wtime();
+    update();
+    double time = MPI_Wtime() - start;
+    MPI_Allreduce(MPI_IN_PLACE, &time, 1, MPI_DOUBLE, MPI_MAX, comm.comm);
+    times.push_back(time);
+  }
+
+  auto counts = CommStats::counts(site);
+  double traffic[] = {static_cast<double>(counts.messages) / iterations,
+                      static_cast<double>(counts.bytes) / iterations};
+  MPI_Allreduce(MPI_IN_PLACE, traffic, 2, MPI_DOUBLE, MPI_MAX, comm.comm);
+
+  double mean = std::accumulate(times.cbegin(), times.cend(), 0.0) / times.size();
+  std::stringstream msg;
+  msg << std::setw(12) << n_cells << "  " << std::setw(20) << std::left << name
+      << std::right << std::scientific << std::setprecision(3) << std::setw(12)
+      << *std::min_element(times.cbegin(), times.cend()) << std::setw(12) << mean
+      << std::setw(12) << *std::max_element(times.cbegin(), times.cend())
+      << std::fixed << std::setprecision(0) << std::setw(10) << traffic[0]
+      << std::setw(14) << traffic[1];
+  rows.push_back(msg.str());
+}
+
+//! Parse a comma-separated list of numbers
+std::vector<std::size_t> parse_list(const std::string& s)
+{
+  std::vector<std::size_t> values;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    values.push_back(std::stoul(item));
+  }
+  return values;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  MPI_Init(&argc, &argv);
+
+  std::vector<std::size_t> cell_counts{10000};
+  int elems_per_cell = 8;
+  int neutronics_nodes = 0;
+  int neutronics_procs_per_node = 1;
+  int heat_nodes = 0;
+  int heat_procs_per_node = 0;
+  int iterations = 20;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (i + 1 < argc && arg == "--cells") {
+      cell_counts = parse_list(argv[++i]);
+    } else if (i + 1 < argc && arg == "--elems-per-cell") {
+      elems_per_cell = std::stoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--neutronics-nodes") {
+      neutronics_nodes = std::stoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--neutronics-procs-per-node") {
+      neutronics_procs_per_node = std::stoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--heat-nodes") {
+      heat_nodes = std::stoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--heat-procs-per-node") {
+      heat_procs_per_node = std::stoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--iterations") {
+      iterations = std::stoi(argv[++i]);
+    } else {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+      MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+  }
+
+  Comm world(MPI_COMM_WORLD);
+  if (elems_per_cell < 1 || iterations < 1) {
+    world.message("Invalid benchmark options");
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  // Input of a coupled run with one Picard iteration; the drivers are the synthetic
+  // ones, so their <driver> is not set
+  pugi::xml_document doc;
+  auto root = doc.append_child("enrico");
+  auto coupling = root.append_child("coupling");
+  coupling.append_child("power").text().set(1.0e6);
+  coupling.append_child("max_timesteps").text().set(1);
+  coupling.append_child("max_picard_iter").text().set(1);
+  auto neutronics_node = root.append_child("neutronics");
+  neutronics_node.append_child("nodes").text().set(neutronics_nodes);
+  neutronics_node.append_child("procs_per_node").text().set(neutronics_procs_per_node);
+  auto heat_node = root.append_child("heat_fluids");
+  heat_node.append_child("nodes").text().set(heat_nodes);
+  heat_node.append_child("procs_per_node").text().set(heat_procs_per_node);
+  heat_node.append_child("pressure_bc").text().set(15.5);
+
+  CommStats::enable(true);
+
+  // CoupledDriver reports its progress as it goes, so the results are printed once
+  // all runs are done
+  std::vector<std::string> rows;
+  for (auto n_cells : cell_counts) {
+    auto make_neutronics = [n_cells](MPI_Comm comm, pugi::xml_node) {
+      return std::unique_ptr<NeutronicsDriver>(
+        std::make_unique<MockNeutronicsDriver>(comm, n_cells));
+    };
+    auto make_heat = [n_cells, elems_per_cell](MPI_Comm comm, pugi::xml_node node) {
+      return std::unique_ptr<HeatFluidsDriver>(
+        std::make_unique<MockHeatFluidsDriver>(comm, node, n_cells, elems_per_cell));
+    };
+
+    // The setup is the construction of the coupled driver, whose communication is
+    // mostly that of init_mapping
+    std::unique_ptr<CoupledDriver> driver;
+    benchmark(
+      world,
+      "setup",
+      "init_mapping",
+      1,
+      n_cells,
+      [&] {
+        driver =
+          std::make_unique<CoupledDriver>(world.comm, root, make_neutronics, make_heat);
+      },
+      rows);
+    benchmark(world,
+              "update_heat_source",
+              "update_heat_source",
+              iterations,
+              n_cells,
+              [&] { driver->update_heat_source(false); },
+              rows);
+    benchmark(world,
+              "update_thermal_state",
+              "update_thermal_state",
+              iterations,
+              n_cells,
+              [&] { driver->update_thermal_state(false); },
+              rows);
+  }
+
+  std::stringstream header;
+  header << "Coupling benchmark: " << world.size << " ranks, " << elems_per_cell
+         << " elements per cell";
+  world.message(header.str());
+  world.message("       cells  update                       min        mean         max"
+                "  messages         bytes");
+  for (const auto& row : rows) {
+    world.message(row);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
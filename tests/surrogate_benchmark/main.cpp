@@ -0,0 +1,283 @@
+//===========================================================================
+// Benchmark of the surrogate heat-fluids driver on full-core layouts, without
+// any input files.
+//
+// A square core of assemblies is built in memory, with a uniform heat source in
+// the fuel, and the parts of a Picard iteration that depend on the size of the
+// core are timed separately: the fluid and conduction solve (solve_step), the
+// field accessors used by the coupling, which fill buffers allocated once as the
+// coupled driver's do, and, if requested, the visualization output (write_step).
+//
+// Usage:
+//   mpirun -np <n> ./surrogate_benchmark [options]
+//
+// Options:
+//   --assemblies <n>[,<n>...]  Cores of n x n assemblies to run (default 15)
+//   --pins <n>                 Assemblies of n x n pins (default 17)
+//   --axial <n>                Number of axial segments (default 50)
+//   --fuel-rings <n>           Number of fuel rings (default 10)
+//   --clad-rings <n>           Number of clad rings (default 3)
+//   --iterations <n>           Timed repetitions of each part (default 5)
+//   --viz <resolution>         Also time write_step with VTK files of the given
+//                              radial resolution (default: no output)
+//
+// Output:
+//   For each core and each part, the time of the slowest rank (min, mean and max
+//   over the repetitions) and the number of elements processed per second at the
+//   mean time. For each core, the peak resident memory of the largest rank and
+//   of all ranks so far, measured once the core is built and after the run.
+//===========================================================================
+
+#include "enrico/comm.h"
+#include "enrico/heat_fluids_driver.h"
+#include "enrico/surrogate_heat_driver.h"
+
+#include <gsl/gsl-lite.hpp>
+#include <mpi.h>
+#include <pugixml.hpp>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace enrico;
+
+namespace {
+
+//! Input of the surrogate heat-fluids driver for a core of n x n assemblies
+void build_core(pugi::xml_node node,
+                int n_assemblies,
+                int n_pins,
+                int n_axial,
+                int n_fuel_rings,
+                int n_clad_rings,
+                int viz_resolution)
+{
+  double pitch = 1.26;
+  node.append_child("driver").text().set("surrogate");
+  node.append_child("pressure_bc").text().set(15.5);
+  node.append_child("pellet_radius").text().set(0.406);
+  node.append_child("clad_inner_radius").text().set(0.414);
+  node.append_child("clad_outer_radius").text().set(0.475);
+  node.append_child("fuel_rings").text().set(n_fuel_rings);
+  node.append_child("clad_rings").text().set(n_clad_rings);
+  node.append_child("pin_pitch").text().set(pitch);
+  node.append_child("n_pins_x").text().set(n_pins);
+  node.append_child("n_pins_y").text().set(n_pins);
+  node.append_child("n_assem_x").text().set(n_assemblies);
+  node.append_child("n_assem_y").text().set(n_assemblies);
+  node.append_child("assembly_width_x").text().set(n_pins * pitch);
+  node.append_child("assembly_width_y").text().set(n_pins * pitch);
+  node.append_child("mass_flowrate").text().set(0.3);
+  node.append_child("inlet_temperature").text().set(565.0);
+
+  std::stringstream z;
+  for (int j = 0; j <= n_axial; ++j) {
+    z << (j == 0 ? "" : " ") << 366.0 * j / n_axial;
+  }
+  node.append_child("z").text().set(z.str().c_str());
+
+  if (viz_resolution > 0) {
+    auto viz = node.append_child("viz");
+    viz.append_attribute("filename").set_value("surrogate_benchmark");
+    viz.append_child("iterations").text().set("all");
+    viz.append_child("resolution").text().set(viz_resolution);
+  }
+}
+
+//! Peak resident memory of the calling process in [MB]
+double peak_memory()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0; // kilobytes on Linux
+}
+
+//! Time a part of the iteration, repeated a number of times, and report it from the
+//! root of comm
+void benchmark(const Comm& comm,
+               int n_assemblies,
+               const char* name,
+               int iterations,
+               double n_elements,
+               const std::function<void()>& part)
+{
+  std::vector<double> times;
+  for (int i = 0; i < iterations; ++i) {
+    comm.Barrier();
+    double start = MPI_Wtime();
+    part();
+    double time = MPI_Wtime() - start;
+    MPI_Allreduce(MPI_IN_PLACE, &time, 1, MPI_DOUBLE, MPI_MAX, comm.comm);
+    times.push_back(time);
+  }
+
+  double mean = std::accumulate(times.cbegin(), times.cend(), 0.0) / times.size();
+  std::stringstream core;
+  core << n_assemblies << "x" << n_assemblies;
+  std::stringstream msg;
+  msg << std::setw(8) << core.str() << "  " << std::setw(14) << std::left << name
+      << std::right << std::scientific << std::setprecision(3) << std::setw(12)
+      << *std::min_element(times.cbegin(), times.cend()) << std::setw(12) << mean
+      << std::setw(12) << *std::max_element(times.cbegin(), times.cend())
+      << std::setw(14) << n_elements / mean;
+  comm.message(msg.str());
+}
+
+//! Report the peak resident memory of the largest rank and of all ranks
+void report_memory(const Comm& comm, int n_assemblies, const char* when)
+{
+  double peak = peak_memory();
+  double peaks[2];
+  MPI_Reduce(&peak, &peaks[0], 1, MPI_DOUBLE, MPI_MAX, 0, comm.comm);
+  MPI_Reduce(&peak, &peaks[1], 1, MPI_DOUBLE, MPI_SUM, 0, comm.comm);
+
+  std::stringstream core;
+  core << n_assemblies << "x" << n_assemblies;
+  std::stringstream msg;
+  msg << std::setw(8) << core.str() << "  peak memory " << when << ": " << std::fixed
+      << std::setprecision(1) << peaks[0] << " MB per rank, " << peaks[1] << " MB total";
+  comm.message(msg.str());
+}
+
+//! Parse a comma-separated list of numbers
+std::vector<int> parse_list(const std::string& s)
+{
+  std::vector<int> values;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    values.push_back(std::stoi(item));
+  }
+  return values;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  MPI_Init(&argc, &argv);
+
+  std::vector<int> core_sizes{15};
+  int n_pins = 17;
+  int n_axial = 50;
+  int n_fuel_rings = 10;
+  int n_clad_rings = 3;
+  int iterations = 5;
+  int viz_resolution = 0;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (i + 1 < argc && arg == "--assemblies") {
+      core_sizes = parse_list(argv[++i]);
+    } else if (i + 1 < argc && arg == "--pins") {
+      n_pins = std::stoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--axial") {
+      n_axial = std::stoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--fuel-rings") {
+      n_fuel_rings = std::stoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--clad-rings") {
+      n_clad_rings = std::stoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--iterations") {
+      iterations = std::stoi(argv[++i]);
+    } else if (i + 1 < argc && arg == "--viz") {
+      viz_resolution = std::stoi(argv[++i]);
+    } else {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+      MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+  }
+
+  Comm world(MPI_COMM_WORLD);
+  bool valid_cores = std::all_of(
+    core_sizes.cbegin(), core_sizes.cend(), [](int n) { return n > 0; });
+  if (!valid_cores || n_pins < 1 || n_axial < 1 || n_fuel_rings < 1 ||
+      n_clad_rings < 1 || iterations < 1 || viz_resolution < 0) {
+    world.message("Invalid benchmark options");
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  std::stringstream header;
+  header << "Surrogate benchmark: " << world.size << " ranks, " << n_pins << "x"
+         << n_pins << " pins, " << n_axial << " axial segments, " << n_fuel_rings
+         << " fuel rings, " << n_clad_rings << " clad rings";
+  world.message(header.str());
+  world.message("    core  part                   min        mean         max"
+                "  elements/s");
+
+  // Cores are run in the given order; the peak memory only grows, so it reflects the
+  // largest core run so far
+  for (auto n_assemblies : core_sizes) {
+    pugi::xml_document doc;
+    auto node = doc.append_child("heat_fluids");
+    build_core(
+      node, n_assemblies, n_pins, n_axial, n_fuel_rings, n_clad_rings, viz_resolution);
+
+    SurrogateHeatDriver driver(world.comm, node);
+    HeatFluidsDriver& heat = driver;
+    report_memory(world, n_assemblies, "after setup");
+
+    // Uniform heat source in the fuel, none in the clad
+    std::vector<double> q(heat.n_local_elem(), 0.0);
+    auto n_azimuthal = driver.n_azimuthal_;
+    auto n_rings = driver.n_rings();
+    for (gsl::index e = 0; e < driver.n_solid_ * driver.local_assemblies_.size(); ++e) {
+      if ((e / n_azimuthal) % n_rings < driver.n_fuel_rings()) {
+        q[e] = 200.0;
+      }
+    }
+    heat.set_heat_sources(q);
+
+    double n_elements = heat.n_global_elem();
+
+    // Without a <source_change_tol>, every solve starts over on all pins and channels
+    benchmark(world, n_assemblies, "solve_step", iterations, n_elements, [&] {
+      driver.solve_step();
+    });
+
+    // The accessors fill buffers of the local elements, as in the coupled driver
+    auto n_local = heat.n_local_elem();
+    std::vector<double> T(n_local);
+    std::vector<double> rho(n_local);
+    std::vector<int> mask(n_local);
+    std::vector<Position> centroids(n_local);
+    std::vector<double> volumes(n_local);
+    benchmark(world, n_assemblies, "temperature", iterations, n_elements, [&] {
+      heat.temperature(T);
+    });
+    benchmark(world, n_assemblies, "density", iterations, n_elements, [&] {
+      heat.density(rho);
+    });
+    benchmark(world, n_assemblies, "thermal_state", iterations, n_elements, [&] {
+      heat.thermal_state(T, rho);
+    });
+    benchmark(world, n_assemblies, "fluid_mask", iterations, n_elements, [&] {
+      heat.fluid_mask(mask);
+    });
+    benchmark(world, n_assemblies, "centroid", iterations, n_elements, [&] {
+      heat.centroid(centroids);
+    });
+    benchmark(world, n_assemblies, "volume", iterations, n_elements, [&] {
+      heat.volume(volumes);
+    });
+
+    // The files are written in the background, and each call waits for the files of
+    // the previous one, so the mean over several calls approaches the cost of writing
+    if (viz_resolution > 0) {
+      int iteration = 0;
+      benchmark(world, n_assemblies, "write_step", iterations, n_elements, [&] {
+        driver.write_step(0, iteration++);
+      });
+    }
+
+    report_memory(world, n_assemblies, "after run");
+  }
+
+  MPI_Finalize();
+  return 0;
+}
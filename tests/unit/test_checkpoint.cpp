@@ -0,0 +1,38 @@
+/**
+ * \file test_checkpoint.cpp
+ * \brief Unit tests for resuming a coupled run from a checkpoint.
+ */
+
+#include "catch.hpp"
+#include "enrico/coupled_driver.h"
+
+using enrico::resume_point;
+
+TEST_CASE("Resume after a checkpointed Picard iteration", "[checkpoint]")
+{
+  SECTION("An unconverged time step resumes at its next Picard iteration")
+  {
+    auto resume = resume_point(2, 3, false, 10);
+    CHECK(resume.i_timestep == 2);
+    CHECK(resume.i_picard == 4);
+  }
+
+  SECTION("A converged time step resumes at the start of the next one")
+  {
+    auto resume = resume_point(2, 3, true, 10);
+    CHECK(resume.i_timestep == 3);
+    CHECK(resume.i_picard == 0);
+  }
+
+  SECTION("A time step that ran its last Picard iteration resumes at the next one")
+  {
+    auto resume = resume_point(2, 9, false, 10);
+    CHECK(resume.i_timestep == 3);
+    CHECK(resume.i_picard == 0);
+
+    // The restarted input may allow fewer iterations than the checkpointed run
+    resume = resume_point(2, 9, false, 5);
+    CHECK(resume.i_timestep == 3);
+    CHECK(resume.i_picard == 0);
+  }
+}
@@ -0,0 +1,74 @@
+/**
+ * \file test_comm_split.cpp
+ * \brief Unit tests for planning the layout of the driver communicators.
+ */
+
+#include "catch.hpp"
+#include "enrico/comm_split.h"
+
+#include <cmath>
+
+using enrico::CommLayout;
+using enrico::fit_strong_scaling;
+using enrico::plan_driver_comms;
+
+TEST_CASE("Strong scaling fit", "[comm_split]")
+{
+  CHECK(fit_strong_scaling({{1, 8.0}, {2, 4.0}, {4, 2.0}}) == Approx(1.0));
+  CHECK(fit_strong_scaling({{1, 8.0}, {4, 4.0}}) == Approx(0.5));
+
+  // Superlinear and non-scaling samples are bounded
+  CHECK(fit_strong_scaling({{1, 8.0}, {2, 2.0}}) == Approx(1.0));
+  CHECK(fit_strong_scaling({{1, 8.0}, {2, 9.0}}) == Approx(0.0));
+
+  // Ideal scaling without enough samples
+  CHECK(fit_strong_scaling({}) == Approx(1.0));
+  CHECK(fit_strong_scaling({{2, 8.0}, {2, 6.0}}) == Approx(1.0));
+}
+
+TEST_CASE("Concurrent drivers get balanced disjoint nodes", "[comm_split]")
+{
+  // Neutronics on 2 nodes takes 3x longer than heat/fluids on 2 nodes
+  CommLayout current{{2, 2}, {0, 0}};
+  auto plan = plan_driver_comms(4, 32, current, {30.0, 10.0}, {0.5, 0.5}, true);
+  CHECK(plan.num_nodes[0] == 3);
+  CHECK(plan.num_nodes[1] == 1);
+  CHECK(plan.procs_per_node[0] == 32);
+  CHECK(plan.procs_per_node[1] == 32);
+  CHECK(plan.time == Approx(30.0 * std::sqrt(2.0 / 3.0)));
+}
+
+TEST_CASE("Sequential drivers share all nodes", "[comm_split]")
+{
+  CommLayout current{{2, 2}, {32, 8}};
+  auto plan = plan_driver_comms(4, 32, current, {30.0, 10.0}, {1.0, 1.0}, false);
+  CHECK(plan.num_nodes[0] == 4);
+  CHECK(plan.num_nodes[1] == 4);
+  CHECK(plan.procs_per_node[1] == 8);
+  CHECK(plan.time == Approx(20.0));
+}
+
+TEST_CASE("Overlapping drivers are split when they run concurrently", "[comm_split]")
+{
+  // Both drivers on all nodes, as when <nodes> is not given
+  CommLayout current{{0, 0}, {0, 0}};
+  auto plan = plan_driver_comms(8, 16, current, {6.0, 2.0}, {0.5, 0.5}, true);
+  CHECK(plan.num_nodes[0] == 7);
+  CHECK(plan.num_nodes[1] == 1);
+  CHECK(plan.time == Approx(6.0 * std::sqrt(8.0 / 7.0)));
+}
+
+TEST_CASE("The current layout is kept when nothing is faster", "[comm_split]")
+{
+  CommLayout current{{3, 1}, {0, 0}};
+  auto plan = plan_driver_comms(4, 32, current, {10.0, 10.0}, {1.0, 1.0}, true);
+  CHECK(plan.num_nodes[0] == 3);
+  CHECK(plan.num_nodes[1] == 1);
+  CHECK(plan.time == Approx(10.0));
+
+  // A single node can only be shared
+  auto single = plan_driver_comms(1, 32, {{0, 0}, {0, 0}}, {5.0, 1.0}, {1.0, 1.0}, true);
+  CHECK(single.num_nodes[0] == 1);
+  CHECK(single.num_nodes[1] == 1);
+  CHECK(single.time == Approx(6.0));
+}
@@ -0,0 +1,46 @@
+/**
+ * \file test_coupling_scheme.cpp
+ * \brief Unit tests for planning the Picard iterations of a coupling scheme.
+ */
+
+#include "catch.hpp"
+#include "enrico/coupled_driver.h"
+
+using enrico::picard_step;
+
+TEST_CASE("Gauss-Seidel iterations always run both solvers", "[coupling_scheme]")
+{
+  for (bool heat_source_solved : {false, true}) {
+    auto step = picard_step(false, false, heat_source_solved);
+    CHECK_FALSE(step.jacobi);
+    CHECK(step.solve_heat);
+    CHECK(step.check_convergence);
+  }
+
+  // The first iteration of a Jacobi run, or of a resumed one
+  auto step = picard_step(true, true, false);
+  CHECK_FALSE(step.jacobi);
+  CHECK(step.solve_heat);
+  CHECK(step.check_convergence);
+}
+
+TEST_CASE("Jacobi iterations need a new heat source", "[coupling_scheme]")
+{
+  SECTION("A Jacobi iteration after a Jacobi one runs both solvers")
+  {
+    auto step = picard_step(true, false, false);
+    CHECK(step.jacobi);
+    CHECK(step.solve_heat);
+    CHECK(step.check_convergence);
+  }
+
+  SECTION("A Jacobi iteration after a Gauss-Seidel one cannot converge")
+  {
+    // The heat/fluids solver already ran with the latest heat source, so the
+    // temperature would be compared with itself
+    auto step = picard_step(true, false, true);
+    CHECK(step.jacobi);
+    CHECK_FALSE(step.solve_heat);
+    CHECK_FALSE(step.check_convergence);
+  }
+}
@@ -0,0 +1,75 @@
+/**
+ * \file test_property_table.cpp
+ * \brief Unit tests for tabulated water properties.
+ */
+
+#include "catch.hpp"
+#include "enrico/property_table.h"
+#include "iapws/iapws.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Bilinear function, which the table reproduces exactly
+double bilinear(double x, double y)
+{
+  return 1.0 + 2.0 * x - 3.0 * y + 0.5 * x * y;
+}
+
+} // namespace
+
+TEST_CASE("Property table reproduces a bilinear function", "[property_table]")
+{
+  enrico::PropertyTable table(bilinear, 0.0, 2.0, -1.0, 1.0, 1e-12);
+  CHECK(table.max_error() < 1e-12);
+  CHECK(table(0.3, 0.7) == Approx(bilinear(0.3, 0.7)));
+  CHECK(table(2.0, 1.0) == Approx(bilinear(2.0, 1.0)));
+
+  // Outside the table, the exact function is used
+  CHECK(table(5.0, -3.0) == Approx(bilinear(5.0, -3.0)));
+
+  std::vector<double> x = {0.0, 1.5, 3.0, 0.25};
+  std::vector<double> y = {-1.0, 0.2, 0.0, 2.0};
+  std::vector<double> out(x.size());
+  table.evaluate(x.size(), x.data(), y.data(), out.data());
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    CHECK(out[i] == Approx(bilinear(x[i], y[i])));
+  }
+}
+
+TEST_CASE("Property table meets its tolerance for water", "[property_table]")
+{
+  double tol = 1e-5;
+  double p = 15.5;
+  double h_min = iapws::h1(p, 500.0);
+  double h_max = iapws::h1(p, 600.0);
+  enrico::PropertyTable T_table(iapws::T_from_p_h, 0.95 * p, 1.05 * p, h_min, h_max, tol);
+  enrico::PropertyTable rho_table(
+    iapws::rho_from_p_h, 0.95 * p, 1.05 * p, h_min, h_max, tol);
+
+  for (int i = 0; i <= 100; ++i) {
+    double h = h_min + 0.01 * i * (h_max - h_min);
+    double p_i = p * (0.96 + 0.0008 * i);
+    CHECK(T_table(p_i, h) == Approx(iapws::T_from_p_h(p_i, h)).epsilon(tol));
+    CHECK(rho_table(p_i, h) == Approx(iapws::rho_from_p_h(p_i, h)).epsilon(tol));
+  }
+}
+
+TEST_CASE("Property table at a fixed pressure", "[property_table]")
+{
+  double p = 15.5;
+  enrico::PropertyTable table(iapws::nu1, p, p, 300.0, 600.0, 1e-6);
+  CHECK(table.n_x() == 1);
+  CHECK(table(p, 550.0) == Approx(iapws::nu1(p, 550.0)).epsilon(1e-6));
+  CHECK(table(p + 1.0, 550.0) == iapws::nu1(p + 1.0, 550.0));
+}
+
+TEST_CASE("Property table rejects an unreachable tolerance", "[property_table]")
+{
+  auto steep = [](double x, double y) { return std::exp(50.0 * x * y); };
+  CHECK_THROWS_AS(enrico::PropertyTable(steep, 0.0, 1.0, 0.0, 1.0, 1e-14),
+                  std::runtime_error);
+}
@@ -0,0 +1,225 @@
+/**
+ * \file test_relaxation.cpp
+ * \brief Unit tests for relaxation of Picard iterates.
+ */
+
+#include "catch.hpp"
+#include "enrico/relaxation.h"
+
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Linear fixed-point map G(x) = D x + c with a different contraction rate in each
+// component, whose fixed point is c / (1 - D)
+xt::xtensor<double, 1> picard_map(const xt::xtensor<double, 1>& x)
+{
+  xt::xtensor<double, 1> rates = {0.5, 0.9, 0.95};
+  xt::xtensor<double, 1> c = {1.0, 2.0, 3.0};
+  return rates * x + c;
+}
+
+// Run a number of relaxed Picard iterations from x = 1 and return the final error
+double iterate(enrico::Relaxation& relaxation, int n)
+{
+  xt::xtensor<double, 1> x = {1.0, 1.0, 1.0};
+  xt::xtensor<double, 1> x_exact = {2.0, 20.0, 60.0};
+  for (int i = 0; i < n; ++i) {
+    auto x_next = picard_map(x);
+    relaxation.relax(x_next, x, i);
+    x = x_next;
+  }
+  double err = 0.0;
+  for (int i = 0; i < 3; ++i) {
+    err = std::max(err, std::abs(x(i) - x_exact(i)));
+  }
+  return err;
+}
+
+// Sums over relaxations that run on threads standing in for the ranks of a
+// communicator.  A rank that waits too long for the others, as when the ranks do not
+// make the same reductions, throws.
+class ThreadReduction {
+public:
+  explicit ThreadReduction(int n_ranks)
+    : n_ranks_(n_ranks)
+  {}
+
+  double sum(double local)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto generation = generation_;
+    partial_ += local;
+    if (++arrived_ == n_ranks_) {
+      result_ = partial_;
+      partial_ = 0.0;
+      arrived_ = 0;
+      ++generation_;
+      done_.notify_all();
+    } else if (!done_.wait_for(lock, std::chrono::seconds(5), [&] {
+                 return generation_ != generation;
+               })) {
+      throw std::runtime_error("Ranks made different reductions");
+    }
+    return result_;
+  }
+
+private:
+  int n_ranks_;
+  int arrived_ = 0;
+  int generation_ = 0;
+  double partial_ = 0.0;
+  double result_ = 0.0;
+  std::mutex mutex_;
+  std::condition_variable done_;
+};
+
+// Relaxation whose reductions are over the threads of a ThreadReduction
+template<typename R>
+class ThreadRelaxation : public R {
+public:
+  template<typename... Args>
+  ThreadRelaxation(ThreadReduction& reduction, Args... args)
+    : R(enrico::Comm{}, args...)
+    , reduction_(reduction)
+  {}
+
+  // Number of reductions so far
+  int reductions() const { return reductions_; }
+
+protected:
+  double sum(double local) const override
+  {
+    ++reductions_;
+    return reduction_.sum(local);
+  }
+
+  bool any(bool local) const override { return this->sum(local ? 1.0 : 0.0) > 0.0; }
+
+private:
+  ThreadReduction& reduction_;
+  mutable int reductions_ = 0;
+};
+
+// Run relaxed Picard iterations over two timesteps on a rank that holds either all
+// of the field or none of it, calling a function after each one, and return the
+// final field
+template<typename F>
+xt::xtensor<double, 1>
+iterate_timesteps(enrico::Relaxation& relaxation, bool holds_field, F after_relax)
+{
+  xt::xtensor<double, 1> x = holds_field ? xt::xtensor<double, 1>{1.0, 1.0, 1.0}
+                                         : xt::xtensor<double, 1>{};
+  for (int timestep = 0; timestep < 2; ++timestep) {
+    for (int i = 0; i < 6; ++i) {
+      xt::xtensor<double, 1> x_next = holds_field ? picard_map(x) : x;
+      relaxation.relax(x_next, x, i);
+      after_relax();
+      x = x_next;
+    }
+  }
+  return x;
+}
+
+// Relax a field held by one of two ranks, check that both ranks make the same
+// reductions in each iteration and compare with the same relaxation on a single rank
+template<typename R, typename... Args>
+void check_empty_slice(Args... args)
+{
+  enrico::Comm comm;
+  R serial(comm, args...);
+  auto expected = iterate_timesteps(serial, true, [] {});
+
+  ThreadReduction reduction(2);
+  ThreadRelaxation<R> full(reduction, args...);
+  ThreadRelaxation<R> empty(reduction, args...);
+  xt::xtensor<double, 1> x_full;
+  xt::xtensor<double, 1> x_empty;
+  std::vector<int> full_reductions;
+  std::vector<int> empty_reductions;
+  bool full_failed = false;
+  bool empty_failed = false;
+  std::thread empty_rank([&] {
+    try {
+      x_empty = iterate_timesteps(
+        empty, false, [&] { empty_reductions.push_back(empty.reductions()); });
+    } catch (const std::runtime_error&) {
+      empty_failed = true;
+    }
+  });
+  try {
+    x_full = iterate_timesteps(
+      full, true, [&] { full_reductions.push_back(full.reductions()); });
+  } catch (const std::runtime_error&) {
+    full_failed = true;
+  }
+  empty_rank.join();
+
+  REQUIRE_FALSE(full_failed);
+  REQUIRE_FALSE(empty_failed);
+  CHECK(empty_reductions == full_reductions);
+  CHECK(x_empty.size() == 0);
+  REQUIRE(x_full.size() == expected.size());
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    CHECK(x_full(i) == Approx(expected(i)));
+  }
+}
+
+} // namespace
+
+TEST_CASE("Constant relaxation", "[relaxation]")
+{
+  enrico::Comm comm;
+  enrico::ConstantRelaxation relaxation(comm, 0.5);
+
+  xt::xtensor<double, 1> x_prev = {1.0, 2.0};
+  xt::xtensor<double, 1> x = {3.0, 6.0};
+  relaxation.relax(x, x_prev, 1);
+  CHECK(x(0) == Approx(2.0));
+  CHECK(x(1) == Approx(4.0));
+  CHECK(relaxation.residual() == Approx(std::sqrt(20.0)));
+}
+
+TEST_CASE("Robbins-Monro relaxation", "[relaxation]")
+{
+  enrico::Comm comm;
+  enrico::RobbinsMonroRelaxation relaxation(comm);
+
+  xt::xtensor<double, 1> x_prev = {1.0};
+  xt::xtensor<double, 1> x = {4.0};
+  relaxation.relax(x, x_prev, 2);
+  CHECK(x(0) == Approx(2.0));
+  CHECK(relaxation.factor() == Approx(1.0 / 3.0));
+}
+
+TEST_CASE("Accelerated relaxation beats plain Picard", "[relaxation]")
+{
+  enrico::Comm comm;
+  enrico::ConstantRelaxation picard(comm, 1.0);
+  double picard_err = iterate(picard, 10);
+
+  SECTION("Aitken")
+  {
+    enrico::AitkenRelaxation aitken(comm, 1.0);
+    CHECK(iterate(aitken, 10) < picard_err);
+  }
+
+  SECTION("Anderson")
+  {
+    enrico::AndersonRelaxation anderson(comm, 1.0, 5);
+    CHECK(iterate(anderson, 10) < 1e-6);
+  }
+}
+
+TEST_CASE("Accelerated relaxation with a rank that holds no values", "[relaxation]")
+{
+  SECTION("Aitken") { check_empty_slice<enrico::AitkenRelaxation>(1.0); }
+
+  SECTION("Anderson") { check_empty_slice<enrico::AndersonRelaxation>(1.0, 5); }
+}
@@ -0,0 +1,104 @@
+/**
+ * \file test_surrogate_neutronics.cpp
+ * \brief Unit tests for surrogate neutronics driver.
+ */
+
+#include "catch.hpp"
+#include "pugixml.hpp"
+#include "enrico/surrogate_heat_driver.h"
+#include "enrico/surrogate_neutronics_driver.h"
+
+#include <cmath>
+#include <vector>
+
+TEST_CASE("Verify surrogate neutronics driver on the surrogate T/H lattice", "[surrogate]") {
+  pugi::xml_document doc;
+  auto result = doc.load_file("inputs/test_surrogate_th_multi.xml");
+  CHECK(result);
+
+  auto root = doc.document_element();
+  auto heat_node = root.child("heat_fluids");
+  enrico::SurrogateHeatDriver heat(MPI_COMM_NULL, heat_node);
+  enrico::SurrogateNeutronicsDriver driver(
+    MPI_COMM_NULL, root.child("neutronics"), heat_node);
+
+  // One fuel, clad and coolant position per pin and axial segment, as in
+  // SurrogateHeatDriver::centroids()
+  double r_fuel = 0.2;
+  double r_clad = 0.5 * (0.414 + 0.475);
+  double r_coolant = 0.55;
+  std::vector<double> z{0.1, 0.5, 1.1, 1.4, 2.0, 2.1, 2.2};
+  std::vector<enrico::Position> positions;
+  for (const auto& assembly : heat.assembly_drivers_) {
+    for (std::size_t i = 0; i < assembly.pin_centers_.shape()[0]; ++i) {
+      double x = assembly.pin_centers_(i, 0);
+      double y = assembly.pin_centers_(i, 1);
+      for (std::size_t j = 0; j + 1 < z.size(); ++j) {
+        double zavg = 0.5 * (z[j] + z[j + 1]);
+        positions.emplace_back(x + r_fuel, y, zavg);
+        positions.emplace_back(x, y - r_clad, zavg);
+        positions.emplace_back(x + r_coolant, y + r_coolant, zavg);
+      }
+    }
+  }
+  auto handles = driver.find(positions);
+  auto n_expected = heat.assembly_drivers_.size() * 28 * 6 * 3;
+
+  SECTION("Verify that each position is in a distinct cell of the right region") {
+    REQUIRE(handles.size() == positions.size());
+    CHECK(driver.n_cells() == n_expected);
+    for (std::size_t k = 0; k < handles.size(); ++k) {
+      CHECK(driver.cell_index(handles[k]) == k);
+      CHECK(driver.is_fissionable(handles[k]) == (k % 3 == 0));
+    }
+
+    // Finding the same positions again doesn't add cells
+    auto again = driver.find(positions);
+    CHECK(again == handles);
+    CHECK(driver.n_cells() == n_expected);
+  }
+
+  SECTION("Verify cell volumes") {
+    double dz = z[1] - z[0];
+    CHECK(driver.get_volume(handles[0]) == Approx(M_PI * 0.414 * 0.414 * dz));
+    CHECK(driver.get_volume(handles[1]) ==
+          Approx(M_PI * (0.475 * 0.475 - 0.414 * 0.414) * dz));
+    CHECK(driver.get_volume(handles[2]) ==
+          Approx((1.26 * 1.26 - M_PI * 0.475 * 0.475) * dz));
+  }
+
+  SECTION("Verify normalization of the heat source") {
+    driver.solve_step();
+    double power = 820.0;
+    auto q = driver.heat_source(power);
+    REQUIRE(q.size() == n_expected);
+    double total = 0.0;
+    for (std::size_t k = 0; k < handles.size(); ++k) {
+      total += q(k) * driver.get_volume(handles[k]);
+      if (k % 3 != 0) {
+        CHECK(q(k) == 0.0);
+      } else {
+        CHECK(q(k) > 0.0);
+      }
+    }
+    CHECK(total == Approx(power));
+  }
+
+  SECTION("Verify temperature feedback on k-effective and on the power") {
+    driver.solve_step();
+    double k_ref = driver.get_k_effective().mean;
+    auto q_ref = driver.heat_source(1.0);
+
+    // Heating the fuel of the first cell lowers k and the power of that cell
+    driver.set_temperature(handles[0], 1500.0);
+    driver.solve_step();
+    CHECK(driver.get_k_effective().mean < k_ref);
+    CHECK(driver.heat_source(1.0)(0) < q_ref(0));
+
+    // Adding boron lowers k
+    driver.set_temperature(handles[0], 900.0);
+    driver.set_boron_ppm({}, 1000.0, 0.199);
+    driver.solve_step();
+    CHECK(driver.get_k_effective().mean < k_ref);
+  }
+}
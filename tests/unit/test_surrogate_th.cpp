@@ -6,6 +6,11 @@
 #include "catch.hpp"
 #include "pugixml.hpp"
 #include "enrico/surrogate_heat_driver.h"
+#include "heat_xfer_backend.h"
+#include "xtensor/xview.hpp"
+
+#include <algorithm>
+#include <vector>
 
 TEST_CASE("Verify construction of surrogate thermal-hydraulics driver - single assembly", "[construction]") {
   // load input file
@@ -609,4 +614,89 @@ TEST_CASE("Verify multi-assembly construction of surrogate model when assemblies
       }
     }
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Warm-started conduction solve", "[heat_xfer]")
+{
+  // One fuel rod segment with a flat source, radial grids in [m]
+  const int n_fuel = 10;
+  const int n_clad = 2;
+  std::vector<double> r_fuel(n_fuel + 1);
+  std::vector<double> r_clad(n_clad + 1);
+  for (int i = 0; i <= n_fuel; ++i)
+    r_fuel[i] = 0.00406 * i / n_fuel;
+  for (int i = 0; i <= n_clad; ++i)
+    r_clad[i] = 0.00414 + (0.00475 - 0.00414) * i / n_clad;
+
+  std::vector<double> q(n_fuel + n_clad, 0.0);
+  std::fill_n(q.begin(), n_fuel, 3.0e8);
+  double T_co = 580.0;
+  double tol = 1.0e-6;
+
+  std::vector<double> T(n_fuel + n_clad, T_co);
+  int cold = solve_steady_nonlin(
+    q.data(), T_co, r_fuel.data(), r_clad.data(), n_fuel, n_clad, tol, T.data());
+  auto T_cold = T;
+
+  // Starting from the converged solution, one iteration confirms convergence
+  int warm = solve_steady_nonlin(
+    q.data(), T_co, r_fuel.data(), r_clad.data(), n_fuel, n_clad, tol, T.data());
+  CHECK(cold > 2);
+  CHECK(warm == 1);
+  for (int i = 0; i < n_fuel + n_clad; ++i)
+    CHECK(T[i] == Approx(T_cold[i]).epsilon(1e-5));
+  CHECK(T[0] > T_co);
+}
+
+TEST_CASE("Incremental solve keeps unchanged pins", "[incremental]")
+{
+  pugi::xml_document doc;
+  auto result = doc.load_file("inputs/test_surrogate_th_single.xml");
+  CHECK(result);
+  auto node = doc.document_element().child("heat_fluids");
+  node.child("verbosity").text().set("none");
+  node.append_child("source_change_tol").text().set(0.01);
+
+  enrico::SurrogateHeatDriverAssembly assembly(node, true, 15.5, 0, false);
+  CHECK(assembly.source_change_tol_ == Approx(0.01));
+
+  std::fill(assembly.source_.begin(), assembly.source_.end(), 300.0);
+  auto solve = [&assembly]() {
+    assembly.mark_changed_pins();
+    assembly.solve_fluid();
+    assembly.solve_heat();
+  };
+  solve();
+  xt::xtensor<double, 3> T_solid = assembly.solid_temperature_;
+  xt::xtensor<double, 2> T_fluid = assembly.fluid_temperature_;
+
+  // A change below the threshold leaves every pin as it was
+  assembly.source_ *= 1.001;
+  solve();
+  for (std::size_t pin = 0; pin < assembly.n_pins_; ++pin)
+    CHECK(!assembly.pin_solved(pin));
+  CHECK(assembly.solid_temperature_ == T_solid);
+  CHECK(assembly.fluid_temperature_ == T_fluid);
+
+  // Raising the source of the corner pin only solves it and its neighbors again; in
+  // the 7 x 4 lattice, pins 0, 1, 7 and 8 share a channel with pin 0.  The other
+  // channels are in the same block of channels, so they are marched again, possibly
+  // with a different number of subchannel iterations, and only agree to within the
+  // subchannel tolerance.
+  xt::view(assembly.source_, 0) *= 1.1;
+  solve();
+  std::vector<std::size_t> neighbors{0, 1, 7, 8};
+  for (std::size_t pin = 0; pin < assembly.n_pins_; ++pin) {
+    bool neighbor = std::find(neighbors.begin(), neighbors.end(), pin) != neighbors.end();
+    CHECK(assembly.pin_solved(pin) == neighbor);
+    for (std::size_t axial = 0; axial < assembly.n_axial_; ++axial) {
+      if (neighbor) {
+        CHECK(assembly.solid_temperature(pin, axial, 0) > T_solid(pin, axial, 0));
+      } else {
+        CHECK(assembly.solid_temperature(pin, axial, 0) == T_solid(pin, axial, 0));
+        CHECK(assembly.fluid_temperature(pin, axial) ==
+              Approx(T_fluid(pin, axial)).margin(0.01));
+      }
+    }
+  }
+}